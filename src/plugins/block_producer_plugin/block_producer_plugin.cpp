@@ -59,7 +59,7 @@ public:
     auto ssig = json::get<string>(info, "sig").value();
     auto signer_cert = found->first.pk;
 
-    // TODO : verify support sig using MSG_REQ_SSIG info & ssig
+    // 받은 SSig는 block을 만들 때 한꺼번에 검증한다 (makeMsgBlock)
 
     SupportSigInfo ssig_info;
     ssig_info.id = signer_id;
@@ -292,7 +292,7 @@ private:
     partial_block.csroot = csroot;
 
     auto &tx_pool = dynamic_cast<ChainPlugin *>(app().getPlugin("ChainPlugin"))->transactionPool();
-    auto transactions = tx_pool.fetchAll();
+    auto transactions = tx_pool.fetchTop(config::MAX_COLLECT_TRANSACTION_SIZE);
 
     vector<hash_t> hashed_txagg_cbor_list;
 
@@ -379,6 +379,7 @@ private:
     certificate.push_back(my_cert_info);
 
     auto ssig_list = ssig_pool->fetchAll();
+    dropInvalidSupportSigs(TypeConverter::bytesToString(hash_data), ssig_list);
     vector<hash_t> hashed_ssig_list;
 
     for (auto &ssig : ssig_list) {
@@ -432,6 +433,27 @@ private:
     return msg_block;
   }
 
+  // signer들은 block 정보 hash(block id, txroot, usroot, csroot)에 서명한다. 같은 message이므로 한꺼번에 검증하고 틀린 것은 뺀다
+  void dropInvalidSupportSigs(const string &message, vector<SupportSigInfo> &ssig_list) {
+    vector<pair<string, string>> cert_sigs;
+    for (auto &ssig : ssig_list) {
+      cert_sigs.emplace_back(ssig.cert, ssig.sig);
+    }
+
+    auto &ssig_verifier = dynamic_cast<ChainPlugin *>(app().getPlugin("ChainPlugin"))->ssigVerifier();
+    vector<bool> results = ssig_verifier.verifyEach(message, cert_sigs);
+
+    size_t valid_num = 0;
+    for (size_t i = 0; i < ssig_list.size(); ++i) {
+      if (!results[i]) {
+        logger::ERROR("[BP] Invalid support sig : {}", ssig_list[i].id);
+        continue;
+      }
+      ssig_list[valid_num++] = move(ssig_list[i]);
+    }
+    ssig_list.resize(valid_num);
+  }
+
   string signMsgBlock(uint64_t btime, const string &hash, int tx_len, int signer_len, const string &sgroot) {
     BytesBuilder builder;
     builder.appendDec(btime);
@@ -0,0 +1,183 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+// 예전 backup 방식: 목록마다 숫자를 문자열로 바꾼 json 배열을 만들어 CBOR로 저장 (5개의 값)
+vector<string> serializeLegacy(const UnresolvedBlock &unresolved_block) {
+  vector<string> serialized_lists;
+
+  nlohmann::json user_ledgers = nlohmann::json::array();
+  for (auto &[pid, ledger] : unresolved_block.user_ledger_list) {
+    nlohmann::json json;
+    json["var_name"] = ledger.var_name;
+    json["var_value"] = ledger.var_value;
+    json["var_type"] = to_string(ledger.var_type);
+    json["uid"] = ledger.uid;
+    json["up_time"] = to_string(ledger.up_time);
+    json["up_block"] = to_string(ledger.up_block);
+    json["tag"] = ledger.tag;
+    json["pid"] = ledger.pid;
+    json["query_type"] = to_string(static_cast<int>(ledger.query_type));
+    json["is_empty"] = ledger.is_empty;
+    user_ledgers.push_back(json);
+  }
+  serialized_lists.emplace_back(TypeConverter::bytesToString(nlohmann::json::to_cbor(user_ledgers)));
+
+  nlohmann::json user_certs = nlohmann::json::array();
+  for (auto &[sn, cert] : unresolved_block.user_cert_list) {
+    nlohmann::json json;
+    json["uid"] = cert.uid;
+    json["sn"] = cert.sn;
+    json["nvbefore"] = to_string(cert.nvbefore);
+    json["nvafter"] = to_string(cert.nvafter);
+    json["x509"] = cert.x509;
+    user_certs.push_back(json);
+  }
+  serialized_lists.emplace_back(TypeConverter::bytesToString(nlohmann::json::to_cbor(user_certs)));
+
+  // 비어 있는 나머지 3개의 목록
+  for (int i = 0; i < 3; ++i)
+    serialized_lists.emplace_back(TypeConverter::bytesToString(nlohmann::json::to_cbor(nlohmann::json::array())));
+
+  return serialized_lists;
+}
+
+// 예전 Chain::restoreUserLedgerList / restoreUserCertList와 같은 방식
+void restoreLegacy(const vector<string> &serialized_lists, UnresolvedBlock &unresolved_block) {
+  for (auto &each_json : nlohmann::json::from_cbor(serialized_lists[0])) {
+    user_ledger_type ledger;
+    ledger.var_name = json::get<string>(each_json, "var_name").value();
+    ledger.var_value = json::get<string>(each_json, "var_value").value();
+    ledger.var_type = stoi(json::get<string>(each_json, "var_type").value());
+    ledger.uid = json::get<string>(each_json, "uid").value();
+    ledger.up_time = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_json, "up_time").value()));
+    ledger.up_block = stoi(json::get<string>(each_json, "up_block").value());
+    ledger.tag = json::get<string>(each_json, "tag").value();
+    ledger.pid = json::get<string>(each_json, "pid").value();
+    ledger.query_type = static_cast<tethys::QueryType>(stoi(json::get<string>(each_json, "query_type").value()));
+    ledger.is_empty = json::get<bool>(each_json, "is_empty").value();
+    unresolved_block.user_ledger_list[ledger.pid] = ledger;
+  }
+
+  for (auto &each_json : nlohmann::json::from_cbor(serialized_lists[1])) {
+    user_cert_type cert;
+    cert.uid = json::get<string>(each_json, "uid").value();
+    cert.sn = json::get<string>(each_json, "sn").value();
+    cert.nvbefore = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_json, "nvbefore").value()));
+    cert.nvafter = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_json, "nvafter").value()));
+    cert.x509 = json::get<string>(each_json, "x509").value();
+    unresolved_block.user_cert_list[cert.sn] = cert;
+  }
+
+  for (int i = 2; i < 5; ++i)
+    nlohmann::json::from_cbor(serialized_lists[i]);
+}
+
+UnresolvedBlock makeUnresolvedBlock(int ledger_num) {
+  UnresolvedBlock unresolved_block;
+  unresolved_block.block.setBlockId("bench_block");
+  unresolved_block.block.setHeight(1000);
+
+  for (int i = 0; i < ledger_num; ++i) {
+    user_ledger_type ledger;
+    ledger.var_name = "KEYC";
+    ledger.var_value = to_string(1000000 + i);
+    ledger.var_type = 1;
+    ledger.uid = "5g9CMGLSXbNAKJMbWqBNp7rm78BJCMK" + to_string(100000 + i);
+    ledger.up_time = 1556504054 + i;
+    ledger.up_block = 1000;
+    ledger.tag = "";
+    ledger.pid = TypeConverter::encodeBase<64>(Sha256::hash(ledger.uid));
+    ledger.query_type = QueryType::UPDATE;
+    ledger.is_empty = false;
+    unresolved_block.user_ledger_list[ledger.pid] = ledger;
+  }
+
+  for (int i = 0; i < ledger_num / 16; ++i) {
+    user_cert_type cert;
+    cert.uid = "5g9CMGLSXbNAKJMbWqBNp7rm78BJCMK" + to_string(100000 + i);
+    cert.sn = to_string(7000000 + i);
+    cert.nvbefore = 1556504054;
+    cert.nvafter = 1872124054;
+    cert.x509 = "-----BEGIN CERTIFICATE-----\n" + string(1600, 'M') + "\n-----END CERTIFICATE-----\n";
+    unresolved_block.user_cert_list[cert.sn] = cert;
+  }
+
+  return unresolved_block;
+}
+
+bool isSameResult(const UnresolvedBlock &a, const UnresolvedBlock &b) {
+  auto same_ledger = [](auto &x, auto &y) {
+    return x.first == y.first && x.second.var_value == y.second.var_value && x.second.uid == y.second.uid &&
+           x.second.up_time == y.second.up_time && x.second.query_type == y.second.query_type && x.second.is_empty == y.second.is_empty;
+  };
+  auto same_cert = [](auto &x, auto &y) { return x.first == y.first && x.second.x509 == y.second.x509; };
+
+  return std::equal(a.user_ledger_list.begin(), a.user_ledger_list.end(), b.user_ledger_list.begin(), b.user_ledger_list.end(),
+                    same_ledger) &&
+         std::equal(a.user_cert_list.begin(), a.user_cert_list.end(), b.user_cert_list.begin(), b.user_cert_list.end(), same_cert);
+}
+
+} // namespace
+
+// 블록 하나의 처리 결과 backup을 만들고(저장 시) 다시 읽는(restorePool) 시간과 크기. 예전 json/CBOR 방식 vs binary record
+int main() {
+  std::cout << "ledgers\tlegacy bytes\trecord bytes\tlegacy save (us)\trecord save (us)\tlegacy restore (us)\trecord restore (us)"
+            << std::endl;
+
+  for (int ledger_num : {16, 256, 4096}) {
+    UnresolvedBlock unresolved_block = makeUnresolvedBlock(ledger_num);
+
+    vector<string> legacy_lists;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < REPEAT_NUM; ++n)
+      legacy_lists = serializeLegacy(unresolved_block);
+    double legacy_save_us = elapsedUs(start) / REPEAT_NUM;
+
+    string record;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < REPEAT_NUM; ++n)
+      record = UnresolvedBlockPool::serializeBackupResult(unresolved_block);
+    double record_save_us = elapsedUs(start) / REPEAT_NUM;
+
+    UnresolvedBlock legacy_restored;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < REPEAT_NUM; ++n) {
+      legacy_restored = UnresolvedBlock();
+      restoreLegacy(legacy_lists, legacy_restored);
+    }
+    double legacy_restore_us = elapsedUs(start) / REPEAT_NUM;
+
+    UnresolvedBlock record_restored;
+    record_restored.block = unresolved_block.block;
+    bool decoded = true;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < REPEAT_NUM; ++n)
+      decoded &= UnresolvedBlockPool::deserializeBackupResult(record, record_restored);
+    double record_restore_us = elapsedUs(start) / REPEAT_NUM;
+
+    size_t legacy_bytes = 0;
+    for (auto &each_list : legacy_lists)
+      legacy_bytes += each_list.size();
+
+    std::cout << ledger_num << "\t" << legacy_bytes << "\t\t" << record.size() << "\t\t" << legacy_save_us << "\t\t\t" << record_save_us
+              << "\t\t\t" << legacy_restore_us << "\t\t\t" << record_restore_us << std::endl;
+
+    check(decoded && isSameResult(unresolved_block, record_restored), "restored record differs from the block result");
+    check(isSameResult(unresolved_block, legacy_restored), "restored legacy lists differ from the block result");
+
+    // 다른 블록의 record나 잘린 record는 받아들이지 않아야 한다
+    UnresolvedBlock other_block;
+    other_block.block.setBlockId("other_block");
+    other_block.block.setHeight(1000);
+    check(!UnresolvedBlockPool::deserializeBackupResult(record, other_block), "record of another block was accepted");
+    check(!UnresolvedBlockPool::deserializeBackupResult(record.substr(0, record.size() - 1), record_restored),
+          "truncated record was accepted");
+  }
+
+  return 0;
+}
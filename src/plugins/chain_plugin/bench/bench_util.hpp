@@ -0,0 +1,69 @@
+#ifndef TETHYS_PUBLIC_MERGER_BENCH_UTIL_HPP
+#define TETHYS_PUBLIC_MERGER_BENCH_UTIL_HPP
+
+#include "../structure/block.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// 여러 벤치마크에서 같이 쓰는 측정 / 데이터 생성 함수
+namespace tethys::bench {
+
+constexpr int REPEAT_NUM = 20; // 한 번의 측정이 너무 짧은 항목을 반복하는 기본 횟수
+
+inline double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline double elapsedSec(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 측정하는 동안 지켜져야 하는 조건. NDEBUG와 관계없이 확인하며, 깨지면 이유를 출력하고 바로 실패로 끝낸다
+inline void check(bool condition, const std::string &what) {
+  if (condition)
+    return;
+
+  std::cout << "CHECK FAILED: " << what << std::endl;
+  std::exit(1);
+}
+
+// height마다 여러 블록이 있는 pool에서 쓰는 block id. 분기가 없으면 fork는 0
+inline base58_type makeBlockId(int height, int fork = 0) {
+  return "bench_block_" + to_string(height) + "_" + to_string(fork);
+}
+
+// id와 hash가 makeBlockId(height, fork)이고 signer_num개의 SSig를 가진 블록
+inline Block makeBlock(int height, int fork, const base58_type &prev_id, int signer_num = 1) {
+  Block block;
+  block.setBlockId(makeBlockId(height, fork));
+  block.setBlockHash(makeBlockId(height, fork));
+  block.setHeight(height);
+  block.setBlockPrevId(prev_id);
+
+  vector<Signature> signers;
+  for (int i = 0; i < signer_num; ++i)
+    signers.emplace_back("bench_signer_" + to_string(i), "bench_sig");
+  block.setSigners(signers);
+  return block;
+}
+
+// 32 byte 임의 pid
+inline string makePid(std::mt19937_64 &rng) {
+  string pid(32, '\0');
+  for (auto &c : pid) {
+    c = static_cast<char>(rng() & 0xff);
+  }
+  return pid;
+}
+
+} // namespace tethys::bench
+
+#endif // TETHYS_PUBLIC_MERGER_BENCH_UTIL_HPP
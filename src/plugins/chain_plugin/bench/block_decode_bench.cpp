@@ -0,0 +1,96 @@
+#include "../structure/block.hpp"
+#include "bench_util.hpp"
+
+#include <fstream>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int TX_NUM = 4096;
+
+// 예전 Block::setTransaction: txagg마다 json DOM을 만든 뒤 inputMsgTxAgg로 옮긴다
+vector<Transaction> decodeLegacy(const Block &block) {
+  vector<Transaction> transactions;
+  for (auto &each_txagg : block.getTxaggs()) {
+    nlohmann::json each_txs_json;
+    each_txs_json = nlohmann::json::from_cbor(TypeConverter::decodeBase<64>(each_txagg));
+
+    Transaction each_tx;
+    block_info_type block_info(each_txagg, block.getBlockId());
+    each_tx.inputMsgTxAgg(each_txs_json, block_info);
+    transactions.emplace_back(each_tx);
+  }
+  return transactions;
+}
+
+bool isSameEndorsers(const vector<Endorser> &a, const vector<Endorser> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Endorser &x, const Endorser &y) {
+    return x.endorser_id == y.endorser_id && x.endorser_pk == y.endorser_pk && x.endorser_sig == y.endorser_sig &&
+           x.endorser_agga == y.endorser_agga && x.endorser_aggz == y.endorser_aggz;
+  });
+}
+
+bool isSameTransaction(const Transaction &a, const Transaction &b) {
+  return a.getTxId() == b.getTxId() && a.getTxTime() == b.getTxTime() && a.getContractId() == b.getContractId() &&
+         a.getReceiverId() == b.getReceiverId() && a.getFee() == b.getFee() && a.getTxInputCbor() == b.getTxInputCbor() &&
+         a.getUserId() == b.getUserId() && a.getTxUserPk() == b.getTxUserPk() && a.getUserAgga() == b.getUserAgga() &&
+         a.getUserAggz() == b.getUserAggz() && isSameEndorsers(a.getEndorsers(), b.getEndorsers()) && a.getTxAggCbor() == b.getTxAggCbor();
+}
+
+} // namespace
+
+// block_input_test.json의 첫 블록을 tx 4096개로 늘려 Block::initialize에서 txagg를 읽는 시간을 비교한다
+// usage: block_decode_bench [block_input_test.json]
+int main(int argc, char *argv[]) {
+  std::ifstream block_file((argc > 1) ? argv[1] : "block_input_test.json");
+  if (!block_file.is_open()) {
+    std::cout << "usage: " << argv[0] << " [block_input_test.json]" << std::endl;
+    return 1;
+  }
+
+  nlohmann::json block_json = nlohmann::json::parse(block_file)[0];
+  nlohmann::json tx_json = nlohmann::json::from_cbor(TypeConverter::decodeBase<64>(block_json["tx"][0].get<string>()));
+
+  block_json["tx"] = nlohmann::json::array();
+  for (int i = 0; i < TX_NUM; ++i) {
+    tx_json["txid"] = "bench_tx_" + to_string(i);
+    tx_json["time"] = to_string(1556504054 + i);
+    tx_json["body"]["fee"] = to_string(i % 100);
+    block_json["tx"].push_back(TypeConverter::encodeBase<64>(nlohmann::json::to_cbor(tx_json)));
+  }
+
+  Block block;
+  block.setBlockId(block_json["block"]["id"]);
+  block.setTxaggs(block_json["tx"]);
+
+  vector<Transaction> legacy_txs;
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < REPEAT_NUM; ++n)
+    legacy_txs = decodeLegacy(block);
+  double legacy_ms = elapsedMs(start) / REPEAT_NUM;
+
+  start = std::chrono::steady_clock::now();
+  for (int n = 0; n < REPEAT_NUM; ++n)
+    block.initialize(block_json);
+  double initialize_ms = elapsedMs(start) / REPEAT_NUM;
+
+  vector<Transaction> current_txs = block.getTransactions();
+  start = std::chrono::steady_clock::now();
+  for (int n = 0; n < REPEAT_NUM; ++n) {
+    vector<txagg_cbor_b64> txaggs = block.getTxaggs();
+    block.setTransaction(txaggs);
+  }
+  double current_ms = elapsedMs(start) / REPEAT_NUM;
+
+  bool matched = std::equal(legacy_txs.begin(), legacy_txs.end(), current_txs.begin(), current_txs.end(), isSameTransaction);
+  std::cout << "txs: " << TX_NUM << std::endl;
+  std::cout << "legacy txagg (ms)\tcurrent txagg (ms)\tBlock::initialize (ms)\ttransactions" << std::endl;
+  std::cout << legacy_ms << "\t\t\t" << current_ms << "\t\t\t" << initialize_ms << "\t\t\t" << (matched ? "matched" : "MISMATCHED")
+            << std::endl;
+
+  check(matched, "transactions decoded from txagg differ from the json DOM path");
+  check(current_txs.size() == TX_NUM, "Block::initialize decoded " + to_string(current_txs.size()) + " txs");
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+#include <set>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int HEIGHT_NUM = 200;
+constexpr int FORK_NUM = 50;        // height마다 들어오는 경쟁 블록 수
+constexpr int REORDER_INTERVAL = 8; // 이 간격마다 자식 height를 부모 height보다 먼저 push 한다
+
+// height마다 FORK_NUM개의 블록을 만들고, 각 블록은 이전 height의 블록 중 하나를 부모로 가진다
+vector<vector<Block>> makeBlocks() {
+  vector<vector<Block>> blocks(HEIGHT_NUM + 1);
+  for (int height = 1; height <= HEIGHT_NUM; ++height) {
+    for (int fork = 0; fork < FORK_NUM; ++fork) {
+      base58_type prev_id = (height == 1) ? makeBlockId(0, 0) : makeBlockId(height - 1, (fork * 7 + height) % FORK_NUM);
+      blocks[height].push_back(makeBlock(height, fork, prev_id));
+    }
+  }
+  return blocks;
+}
+
+vector<int> makePushOrder() {
+  vector<int> push_order;
+  for (int height = 1; height <= HEIGHT_NUM; ++height) {
+    if (height % REORDER_INTERVAL == 0 && height < HEIGHT_NUM) {
+      push_order.push_back(height + 1);
+      push_order.push_back(height);
+      ++height;
+    } else {
+      push_order.push_back(height);
+    }
+  }
+  return push_order;
+}
+
+// lowest_height 이상의 블록 중 버려지지 않은 블록은 모두 pool에서 찾을 수 있고, 버려진 블록은 찾을 수 없는지 확인한다
+bool isIndexed(UnresolvedBlockPool &pool, const vector<vector<Block>> &blocks, int lowest_height,
+               const std::set<base58_type> &dropped_ids) {
+  for (int height = lowest_height; height <= HEIGHT_NUM; ++height) {
+    for (auto &each_block : blocks[height]) {
+      block_pool_info_type pool_info;
+      bool found = pool.getBlockPoolInfo(each_block.getBlockId(), height, pool_info);
+      if (found == (dropped_ids.count(each_block.getBlockId()) > 0))
+        return false;
+    }
+  }
+  return true;
+}
+
+// 부모보다 먼저 들어온 블록까지 포함하여, 끝 height의 블록들이 모두 latest confirmed block까지 연결되어 있는지 확인한다
+bool isLinked(UnresolvedBlockPool &pool, const vector<vector<Block>> &blocks) {
+  for (auto &each_block : blocks[HEIGHT_NUM]) {
+    vector<int> path = pool.getPath(each_block.getBlockId(), HEIGHT_NUM);
+    if (path.size() != static_cast<size_t>(HEIGHT_NUM) || path.front() < 0)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+// height마다 50개의 fork가 있는 pool에 블록을 push 하고, block id로 블록과 경로를 찾는 시간
+int main() {
+  vector<vector<Block>> blocks = makeBlocks();
+  vector<int> push_order = makePushOrder();
+
+  UnresolvedBlockPool pool;
+  pool.setPool(makeBlockId(0, 0), 0, 0, "", "");
+  auto start = std::chrono::steady_clock::now();
+  for (int height : push_order) {
+    for (auto &each_block : blocks[height])
+      pool.pushBlock(each_block);
+  }
+  double push_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int height = 1; height <= HEIGHT_NUM; ++height) {
+    for (auto &each_block : blocks[height])
+      pool.getUnresolvedBlock(each_block.getBlockId(), height);
+  }
+  double lookup_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  for (auto &each_block : blocks[HEIGHT_NUM])
+    pool.getPath(each_block.getBlockId(), HEIGHT_NUM);
+  double path_ms = elapsedMs(start);
+
+  check(isIndexed(pool, blocks, 1, {}), "pushed block is not found by block id");
+  check(isLinked(pool, blocks), "tip block is not linked to the latest confirmed block");
+
+  // 확정하면서 pop_front 되고 이어지지 않는 branch가 지워진 뒤에도, 남은 블록들을 index로 찾을 수 있어야 한다
+  UnresolvedBlock resolved_result;
+  vector<base58_type> dropped_block_id;
+  std::set<base58_type> all_dropped_ids;
+  int resolved_num = 0;
+  while (pool.resolveBlock(blocks[HEIGHT_NUM][0], resolved_result, dropped_block_id)) {
+    ++resolved_num;
+    all_dropped_ids.insert(dropped_block_id.begin(), dropped_block_id.end());
+  }
+  check(resolved_num > 0, "no block was resolved");
+  check(isIndexed(pool, blocks, resolved_num + 1, all_dropped_ids), "block left in the pool is not found by block id after resolve");
+
+  std::cout << "heights: " << HEIGHT_NUM << ", forks/height: " << FORK_NUM << ", resolved: " << resolved_num << std::endl;
+  std::cout << "push (ms)	lookup (ms)	path (ms)" << std::endl;
+  std::cout << push_ms << "		" << lookup_ms << "		" << path_ms << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include "../include/multi_sha256.hpp"
+#include "../include/static_merkle_tree.hpp"
+#include "bench_util.hpp"
+
+#include <map>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int HASH_REPEAT_NUM = 200; // level 하나 / tree 하나는 짧으므로 기본보다 많이 반복한다
+
+// 예전 StaticMerkleTree의 lookup table: 두 empty hash를 붙인 것 -> 한 level 위의 empty hash (11개)
+std::map<bytes, hash_t> makeLegacyLookUpTable() {
+  std::map<bytes, hash_t> lookup_table;
+  for (int level = 0; level < 11; ++level) {
+    const auto &empty_hash = StaticMerkleTree::getEmptyHash(level);
+    const auto &parent_hash = StaticMerkleTree::getEmptyHash(level + 1);
+    bytes empty_pair(empty_hash.begin(), empty_hash.end());
+    empty_pair.insert(empty_pair.end(), empty_hash.begin(), empty_hash.end());
+    lookup_table.emplace(empty_pair, hash_t(parent_hash.begin(), parent_hash.end()));
+  }
+  return lookup_table;
+}
+
+const std::map<bytes, hash_t> LEGACY_LOOKUP = makeLegacyLookUpTable();
+
+// 예전 StaticMerkleTree::makeParent와 같은 방식: left를 복사해 right를 붙이고, lookup table을 찾은 뒤 Sha256::hash
+hash_t makeParentLegacy(hash_t left, hash_t &right) {
+  left.insert(left.cend(), right.cbegin(), right.cend());
+
+  auto it_map = LEGACY_LOOKUP.find(left);
+  if (it_map != LEGACY_LOOKUP.end()) {
+    return it_map->second;
+  } else {
+    return Sha256::hash(left);
+  }
+}
+
+// 예전 StaticMerkleTree::generate: 노드마다 vector를 따로 두고 dummy leaf까지 모든 노드를 계산한다
+vector<hash_t> generateLegacy(vector<hash_t> &merkle_contents) {
+  vector<hash_t> merkle_tree(MAX_MERKLE_LEAVES * 2 - 1);
+  for (int i = 0; i < MAX_MERKLE_LEAVES; ++i)
+    merkle_tree[i] = (i < merkle_contents.size()) ? merkle_contents[i] : bytes(32, 0);
+
+  int parent_pos = MAX_MERKLE_LEAVES;
+  for (int i = 0; i < MAX_MERKLE_LEAVES * 2 - 3; i += 2) {
+    merkle_tree[parent_pos] = makeParentLegacy(merkle_tree[i], merkle_tree[i + 1]);
+    ++parent_pos;
+  }
+  return merkle_tree;
+}
+
+} // namespace
+
+// StaticMerkleTree를 만들 때의 hashing 비교
+//  1. level별 처리량: 노드 하나씩 makeParent(예전 방식) vs MultiSha256 kernel별로 level 전체를 한꺼번에
+//  2. tx 수별 tree 생성(root까지) 시간과 모든 노드의 일치 여부
+int main() {
+  std::mt19937_64 rng(4096);
+
+  vector<MultiSha256::Kernel> kernels;
+  for (auto kernel : {MultiSha256::Kernel::SCALAR, MultiSha256::Kernel::AVX2, MultiSha256::Kernel::SHA_NI}) {
+    if (MultiSha256::isSupported(kernel))
+      kernels.push_back(kernel);
+  }
+  std::cout << "selected kernel: " << MultiSha256::getKernelName(MultiSha256::getKernel()) << std::endl;
+
+  std::cout << "per level throughput (Mhash/s)" << std::endl;
+  std::cout << "nodes\tlegacy";
+  for (auto kernel : kernels)
+    std::cout << "\t" << MultiSha256::getKernelName(kernel);
+  std::cout << std::endl;
+
+  for (size_t parent_num = MAX_MERKLE_LEAVES / 2; parent_num >= 1; parent_num /= 2) {
+    vector<uint8_t> children(parent_num * 64);
+    for (auto &c : children)
+      c = static_cast<uint8_t>(rng());
+    vector<hash_t> child_hashes(parent_num * 2);
+    for (size_t i = 0; i < child_hashes.size(); ++i)
+      child_hashes[i].assign(children.begin() + i * 32, children.begin() + (i + 1) * 32);
+
+    vector<hash_t> legacy_parents(parent_num);
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < HASH_REPEAT_NUM; ++n) {
+      for (size_t i = 0; i < parent_num; ++i)
+        legacy_parents[i] = makeParentLegacy(child_hashes[i * 2], child_hashes[i * 2 + 1]);
+    }
+    std::cout << parent_num << "\t" << (parent_num * HASH_REPEAT_NUM / elapsedUs(start));
+
+    for (auto kernel : kernels) {
+      vector<uint8_t> parents(parent_num * 32);
+      start = std::chrono::steady_clock::now();
+      for (int n = 0; n < HASH_REPEAT_NUM; ++n)
+        MultiSha256::hash64(kernel, children.data(), parent_num, parents.data());
+      double elapsed_us = elapsedUs(start);
+
+      for (size_t i = 0; i < parent_num; ++i) {
+        check(std::equal(legacy_parents[i].begin(), legacy_parents[i].end(), parents.begin() + i * 32),
+              string(MultiSha256::getKernelName(kernel)) + " parent differs from Sha256::hash");
+      }
+      std::cout << "\t" << (parent_num * HASH_REPEAT_NUM / elapsed_us);
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "whole tree (us per tree)" << std::endl;
+  std::cout << "txs\tlegacy\tcurrent\ttree" << std::endl;
+  for (size_t tx_num : {0, 5, 100, 1000, 4096}) {
+    vector<hash_t> merkle_contents(tx_num);
+    for (auto &each_content : merkle_contents) {
+      each_content.resize(32);
+      for (auto &c : each_content)
+        c = static_cast<uint8_t>(rng());
+    }
+
+    vector<hash_t> legacy_tree;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < HASH_REPEAT_NUM; ++n)
+      legacy_tree = generateLegacy(merkle_contents);
+    double legacy_us = elapsedUs(start) / HASH_REPEAT_NUM;
+
+    hash_t current_root;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < HASH_REPEAT_NUM; ++n) {
+      StaticMerkleTree merkle_tree(merkle_contents);
+      current_root.assign(merkle_tree.getRoot().begin(), merkle_tree.getRoot().end());
+    }
+    double current_us = elapsedUs(start) / HASH_REPEAT_NUM;
+
+    bool tree_matched = (legacy_tree == StaticMerkleTree(merkle_contents).getStaticMerkleTree() && legacy_tree.back() == current_root);
+    std::cout << tx_num << "\t" << legacy_us << "\t" << current_us << "\t" << (tree_matched ? "matched" : "MISMATCHED") << std::endl;
+    check(tree_matched, "tree of " + to_string(tx_num) + " txs differs from the legacy tree");
+  }
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int HEIGHT_NUM = 200;
+constexpr int FORK_NUM = 4;
+constexpr int MISSING_PARENT_NUM = 100; // 부모가 끝내 들어오지 않는 블록 수
+
+vector<Block> makeBlocks() {
+  vector<Block> blocks;
+  for (int height = 1; height <= HEIGHT_NUM; ++height) {
+    for (int fork = 0; fork < FORK_NUM; ++fork) {
+      base58_type prev_id = (height == 1) ? makeBlockId(0, 0) : makeBlockId(height - 1, (fork + height) % FORK_NUM);
+      blocks.push_back(makeBlock(height, fork, prev_id));
+    }
+  }
+  return blocks;
+}
+
+// 네트워크에서 순서가 뒤바뀐 것처럼, 각 블록이 원래 순서에서 최대 reorder_window개까지 밀려서 들어오게 한다
+vector<Block> reorder(const vector<Block> &blocks, int reorder_window) {
+  std::mt19937 rng(7);
+  vector<std::pair<size_t, size_t>> keys;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    keys.emplace_back(i + rng() % (reorder_window + 1), i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  vector<Block> reordered;
+  for (auto &[key, idx] : keys) {
+    reordered.push_back(blocks[idx]);
+  }
+  return reordered;
+}
+
+bool isAllLinked(UnresolvedBlockPool &pool, const vector<Block> &blocks) {
+  for (auto &each_block : blocks) {
+    if (pool.getUnresolvedBlock(each_block.getBlockId(), each_block.getHeight()).block.getBlockId() != each_block.getBlockId())
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+// 순서가 뒤바뀌어 들어온 블록이 부모를 기다렸다가 다시 요청하지 않고 pool에 연결되는지, 연결까지 걸린 시간과 orphan pool의 상한
+int main() {
+  vector<Block> blocks = makeBlocks();
+
+  std::cout << "reorder window\tpush (ms)\torphaned\tlinked\tavg link (ms)\tmax link (ms)\tresult" << std::endl;
+  for (int reorder_window : {0, 8, 16, 48}) {
+    UnresolvedBlockPool pool;
+    pool.setPool(makeBlockId(0, 0), 0, 0, "", "");
+
+    vector<Block> push_order = reorder(blocks, reorder_window);
+    int orphaned_num = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &each_block : push_order) {
+      if (!pool.pushBlock(each_block).linked)
+        ++orphaned_num;
+    }
+    double push_ms = elapsedMs(start);
+
+    nlohmann::json stats = pool.getOrphanStats();
+    bool linked = isAllLinked(pool, blocks) && stats["size"].get<size_t>() == 0 && stats["evicted"].get<uint64_t>() == 0;
+
+    std::cout << reorder_window << "\t\t" << push_ms << "\t\t" << orphaned_num << "\t\t" << stats["linked"] << "\t"
+              << stats["avg_time_to_link_ms"] << "\t" << stats["max_time_to_link_ms"] << "\t" << (linked ? "ok" : "NOT LINKED")
+              << std::endl;
+    check(linked, "blocks reordered within " + to_string(reorder_window) + " were not all linked");
+  }
+
+  // 부모가 오지 않는 블록은 상한까지만 기다리고, 확정된 height 아래로 내려가면 버린다
+  UnresolvedBlockPool pool;
+  pool.setPool(makeBlockId(0, 0), 0, 0, "", "");
+  for (int i = 0; i < MISSING_PARENT_NUM; ++i) {
+    Block orphan_block = makeBlock(3, 100 + i, makeBlockId(2, 100 + i));
+    pool.pushBlock(orphan_block);
+  }
+  for (int height = 1; height <= 5; ++height) {
+    Block chain_block = makeBlock(height, 0, makeBlockId(height - 1, 0));
+    pool.pushBlock(chain_block);
+  }
+  nlohmann::json full_stats = pool.getOrphanStats();
+
+  UnresolvedBlock resolved_result;
+  vector<base58_type> dropped_block_id;
+  Block tip_block = makeBlock(5, 0, makeBlockId(4, 0));
+  while (pool.resolveBlock(tip_block, resolved_result, dropped_block_id)) {
+  }
+  nlohmann::json resolved_stats = pool.getOrphanStats();
+
+  bool bounded = full_stats["size"].get<size_t>() == config::ORPHAN_POOL_MAX_SIZE &&
+                 full_stats["evicted"].get<uint64_t>() == MISSING_PARENT_NUM - config::ORPHAN_POOL_MAX_SIZE &&
+                 resolved_stats["size"].get<size_t>() == 0 && resolved_stats["expired"].get<uint64_t>() == config::ORPHAN_POOL_MAX_SIZE;
+
+  std::cout << "missing parents: " << full_stats.dump() << " -> after resolve: " << resolved_stats.dump() << " "
+            << (bounded ? "ok" : "NOT BOUNDED") << std::endl;
+  check(bounded, "orphan pool was not bounded or not expired");
+
+  return 0;
+}
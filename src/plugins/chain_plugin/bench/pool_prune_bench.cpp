@@ -0,0 +1,101 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int HEIGHT_NUM = 1000;
+constexpr int FORK_NUM = 8;
+constexpr int LEDGER_NUM = 256; // 블록마다 처리 결과로 가지는 user ledger 수
+
+// height마다 FORK_NUM개의 블록이 pool에 남아 있는 이전 height의 블록에 붙는다.
+// 앞쪽 절반의 블록에만 자식이 생기므로 나머지 branch는 이어지지 않는다
+void pushHeight(UnresolvedBlockPool &pool, int height) {
+  vector<base58_type> parent_ids;
+  for (int fork = 0; fork < FORK_NUM; ++fork) {
+    block_pool_info_type pool_info;
+    if (pool.getBlockPoolInfo(makeBlockId(height - 1, fork), height - 1, pool_info))
+      parent_ids.push_back(pool_info.block_id);
+  }
+  if (parent_ids.empty())
+    parent_ids.push_back(pool.getLatestConfirmedId());
+
+  for (int fork = 0; fork < FORK_NUM; ++fork) {
+    Block block = makeBlock(height, fork, parent_ids[((fork * 3 + height) % FORK_NUM / 2) % parent_ids.size()]);
+    if (!pool.pushBlock(block).linked)
+      continue;
+
+    UnresolvedBlock unresolved_block = pool.getUnresolvedBlock(block.getBlockId(), height);
+    for (int i = 0; i < LEDGER_NUM; ++i) {
+      user_ledger_type ledger;
+      ledger.pid = block.getBlockId() + "_" + to_string(i);
+      ledger.var_value = string(64, 'V');
+      ledger.is_empty = false;
+      unresolved_block.user_ledger_list[ledger.pid] = ledger;
+    }
+    check(pool.setUnresolvedBlock(unresolved_block), "cannot set the result of " + block.getBlockId());
+  }
+}
+
+// pool에 남은 모든 블록이 latest confirmed block까지 연결되어 있는지 확인한다
+bool isAllLinked(UnresolvedBlockPool &pool, int tip_height) {
+  int confirmed_height = static_cast<int>(pool.getLatestConfirmedHeight());
+  for (int height = confirmed_height + 1; height <= tip_height; ++height) {
+    for (int fork = 0; fork < FORK_NUM; ++fork) {
+      block_pool_info_type pool_info;
+      if (!pool.getBlockPoolInfo(makeBlockId(height, fork), height, pool_info))
+        continue;
+
+      vector<int> path = pool.getPath(pool_info.block_id, height);
+      if (path.size() != static_cast<size_t>(height - confirmed_height) || path.front() < 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// 분기가 계속 생기는 동안 resolveBlock이 걸리는 시간과 pool에 남는 블록 수
+int main() {
+  UnresolvedBlockPool pool;
+  pool.setPool(makeBlockId(0, 0), 0, 0, "", "");
+
+  UnresolvedBlock resolved_result;
+  vector<base58_type> dropped_block_id;
+  size_t resolved_num = 0;
+  size_t dropped_num = 0;
+  size_t pool_block_sum = 0;
+  size_t pool_block_max = 0;
+  double resolve_us = 0;
+
+  for (int height = 1; height <= HEIGHT_NUM; ++height) {
+    pushHeight(pool, height);
+
+    Block tip_block;
+    tip_block.setHeight(height);
+    auto start = std::chrono::steady_clock::now();
+    while (pool.resolveBlock(tip_block, resolved_result, dropped_block_id)) {
+      ++resolved_num;
+      dropped_num += dropped_block_id.size() - 1;
+    }
+    resolve_us += elapsedUs(start);
+
+    size_t pool_block_num = pool.getPoolBlockIds().size();
+    pool_block_sum += pool_block_num;
+    pool_block_max = std::max(pool_block_max, pool_block_num);
+
+    if (height % 100 == 0)
+      check(isAllLinked(pool, height), "block left in the pool is not linked at height " + to_string(height));
+  }
+
+  std::cout << "heights: " << HEIGHT_NUM << ", forks/height: " << FORK_NUM << ", ledgers/block: " << LEDGER_NUM << std::endl;
+  std::cout << "resolved\tdropped\tresolve (us/block)\tavg pool blocks\tmax pool blocks" << std::endl;
+  std::cout << resolved_num << "\t\t" << dropped_num << "\t" << resolve_us / std::max<size_t>(1, resolved_num) << "\t\t\t"
+            << (double)pool_block_sum / HEIGHT_NUM << "\t\t" << pool_block_max << std::endl;
+
+  check(resolved_num > 0, "no block was resolved");
+  return 0;
+}
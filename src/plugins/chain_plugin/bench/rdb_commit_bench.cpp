@@ -0,0 +1,118 @@
+// 로컬 MySQL/MariaDB에 대해 블록 확정 시의 RDB 쓰기 비용을 측정한다.
+// 기존의 apply*ToRDB 7회 호출과 commitResolvedBlock 한 번을 비교한다. tethys 스키마가 준비된 빈 DB를 사용할 것.
+//
+// usage: rdb_commit_bench <db_name> <db_user> <db_password> [tx_num] [block_num]
+
+#include "../include/rdb_controller.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+string makeTxAgg(const string &tx_id) {
+  nlohmann::json tx_json;
+  tx_json["txid"] = tx_id;
+  tx_json["time"] = to_string(TimeUtil::nowBigInt());
+  tx_json["body"]["cid"] = "VALUE-TRANSFER::5ZZSCQVBs6HpzqFfRo8F6PjjUB8cA8qdRcLn2d1jSDcW::SEOUL@KR::TETHYS19";
+  tx_json["body"]["receiver"] = "5ZZSCQVBs6HpzqFfRo8F6PjjUB8cA8qdRcLn2d1jSDcW";
+  tx_json["body"]["fee"] = "10";
+  tx_json["body"]["input"] = nlohmann::json::array({{{"amount", "100"}, {"unit", "KRW"}}});
+  tx_json["user"]["id"] = "5ZZSCQVBs6HpzqFfRo8F6PjjUB8cA8qdRcLn2d1jSDcW";
+  tx_json["user"]["pk"] = "";
+  tx_json["user"]["a"] = "";
+  tx_json["user"]["z"] = "";
+  tx_json["endorser"] = nlohmann::json::array();
+
+  return TypeConverter::encodeBase<64>(nlohmann::json::to_cbor(tx_json));
+}
+
+UnresolvedBlock makeResolvedBlock(int height, int tx_num) {
+  UnresolvedBlock resolved_block;
+  Block &block = resolved_block.block;
+
+  string block_id = makeBlockId(height, TimeUtil::nowBigInt() % 1000000000);
+  block.setBlockId(block_id);
+  block.setHeight(height);
+  block.setBlockHash(block_id);
+  block.setBlockPrevId(makeBlockId(height - 1));
+
+  nlohmann::json txaggs = nlohmann::json::array();
+  for (int i = 0; i < tx_num; ++i) {
+    txaggs.push_back(makeTxAgg(block_id + "_tx_" + to_string(i)));
+  }
+  block.setTxaggs(txaggs);
+  vector<txagg_cbor_b64> txagg_list = block.getTxaggs();
+  block.setTransaction(txagg_list);
+
+  // 트랜잭션 하나당 user_scope 변경 하나
+  for (int i = 0; i < tx_num; ++i) {
+    user_ledger_type ledger;
+    ledger.pid = block_id + "_pid_" + to_string(i);
+    ledger.var_name = "v" + to_string(i);
+    ledger.var_value = to_string(i);
+    ledger.var_type = 0;
+    ledger.uid = "5ZZSCQVBs6HpzqFfRo8F6PjjUB8cA8qdRcLn2d1jSDcW";
+    ledger.up_time = TimeUtil::nowBigInt();
+    ledger.up_block = height;
+    ledger.query_type = QueryType::INSERT;
+    resolved_block.user_ledger_list[ledger.pid] = ledger;
+  }
+
+  return resolved_block;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " <db_name> <db_user> <db_password> [tx_num] [block_num]" << std::endl;
+    return 1;
+  }
+
+  int tx_num = (argc > 4) ? std::max(1, stoi(argv[4])) : 4096;
+  int block_num = (argc > 5) ? stoi(argv[5]) : 5;
+
+  RdbController rdb_controller("mysql", argv[1], argv[2], argv[3]);
+
+  double apply_ms = 0;
+  double commit_ms = 0;
+
+  for (int i = 0; i < block_num; ++i) {
+    UnresolvedBlock per_table_block = makeResolvedBlock(2 * i + 1, tx_num);
+    auto start = std::chrono::steady_clock::now();
+    rdb_controller.applyBlockToRDB(per_table_block.block);
+    rdb_controller.applyTransactionToRDB(per_table_block.block);
+    rdb_controller.applyUserLedgerToRDB(per_table_block.user_ledger_list);
+    rdb_controller.applyContractLedgerToRDB(per_table_block.contract_ledger_list);
+    rdb_controller.applyUserAttributeToRDB(per_table_block.user_attribute_list);
+    rdb_controller.applyUserCertToRDB(per_table_block.user_cert_list);
+    rdb_controller.applyContractToRDB(per_table_block.contract_list);
+    apply_ms += elapsedMs(start);
+
+    UnresolvedBlock batched_block = makeResolvedBlock(2 * i + 2, tx_num);
+    start = std::chrono::steady_clock::now();
+    if (!rdb_controller.commitResolvedBlock(batched_block)) {
+      std::cerr << "commitResolvedBlock failed" << std::endl;
+      return 1;
+    }
+    commit_ms += elapsedMs(start);
+
+    // 두 방식 모두 블록과 ledger가 RDB에 그대로 남아 있어야 한다
+    for (auto *written_block : {&per_table_block, &batched_block}) {
+      auto &last_ledger = written_block->user_ledger_list.rbegin()->second;
+      check(rdb_controller.findUserScopeFromRDB(last_ledger.pid).var_value == last_ledger.var_value,
+            "user ledger of " + written_block->block.getBlockId() + " was not written");
+    }
+    auto latest_block = rdb_controller.getLatestResolvedBlock();
+    check(latest_block.has_value() && latest_block->getBlockId() == batched_block.block.getBlockId(),
+          "commitResolvedBlock did not write " + batched_block.block.getBlockId());
+  }
+
+  std::cout << "txs/block: " << tx_num << ", blocks: " << block_num << std::endl;
+  std::cout << "apply*ToRDB         : " << apply_ms / block_num << " ms/block" << std::endl;
+  std::cout << "commitResolvedBlock : " << commit_ms / block_num << " ms/block" << std::endl;
+
+  return 0;
+}
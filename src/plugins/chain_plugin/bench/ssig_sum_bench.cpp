@@ -0,0 +1,88 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+#include <map>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int HEIGHT_NUM = 125;
+constexpr int FORK_NUM = 8;    // HEIGHT_NUM * FORK_NUM = pool에 유지되는 1000개의 블록
+constexpr int STEP_NUM = 1000; // 한 height를 push 하고 한 height를 확정하는 횟수
+
+// height마다 FORK_NUM개의 블록이 모두 이전 height의 0번 블록에 붙는다. 0번 branch가 확정되므로 나머지는 잎으로 남았다가 지워진다
+void pushHeight(UnresolvedBlockPool &pool, int height) {
+  for (int fork = 0; fork < FORK_NUM; ++fork) {
+    Block block = makeBlock(height, fork, makeBlockId(height - 1, 0), fork % 3 + 1);
+    pool.pushBlock(block);
+  }
+}
+
+// pool에 남은 블록들의 ssig_sum이 자신과 모든 후손의 SSig 수 합과 같은지, 위 height부터 다시 계산하여 확인한다
+bool isSSigSumValid(UnresolvedBlockPool &pool, int tip_height) {
+  std::map<base58_type, int32_t> expected_sum;
+  for (int height = tip_height; height > static_cast<int>(pool.getLatestConfirmedHeight()); --height) {
+    for (int fork = 0; fork < FORK_NUM; ++fork) {
+      block_pool_info_type pool_info;
+      if (!pool.getBlockPoolInfo(makeBlockId(height, fork), height, pool_info))
+        return false;
+
+      bool valid = true;
+      pool.visitUnresolvedBlock(pool_info.deq_idx, pool_info.vec_idx, [&](const UnresolvedBlock &each_block) {
+        int32_t sum = expected_sum[each_block.block.getBlockId()] + each_block.block.getNumSigners();
+        valid = (each_block.ssig_sum == sum);
+        expected_sum[each_block.block.getPrevBlockId()] += sum;
+      });
+      if (!valid)
+        return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// 1000개의 블록이 유지되는 pool에 height를 하나씩 push 하고, 가장 많은 SSig를 받은 블록을 골라 확정하는 시간
+int main() {
+  UnresolvedBlockPool pool;
+  pool.setPool(makeBlockId(0, 0), 0, 0, "", "");
+
+  int tip_height = 0;
+  for (; tip_height < HEIGHT_NUM; ++tip_height)
+    pushHeight(pool, tip_height + 1);
+  check(isSSigSumValid(pool, tip_height), "ssig_sum differs from the recomputed sum after the initial push");
+
+  UnresolvedBlock resolved_result;
+  vector<base58_type> dropped_block_id;
+  int resolved_num = 0;
+  double push_us = 0;
+  double resolve_us = 0;
+
+  for (int step = 0; step < STEP_NUM; ++step) {
+    ++tip_height;
+    auto start = std::chrono::steady_clock::now();
+    pushHeight(pool, tip_height);
+    push_us += elapsedUs(start);
+
+    Block tip_block;
+    tip_block.setHeight(tip_height);
+    start = std::chrono::steady_clock::now();
+    bool resolved = pool.resolveBlock(tip_block, resolved_result, dropped_block_id);
+    resolve_us += elapsedUs(start);
+
+    if (resolved) {
+      ++resolved_num;
+      check(resolved_result.block.getBlockId() == makeBlockId(resolved_num, 0), "resolved a block off the branch with the most SSigs");
+    }
+  }
+  check(isSSigSumValid(pool, tip_height), "ssig_sum differs from the recomputed sum after resolving");
+  check(resolved_num == STEP_NUM, "resolved " + to_string(resolved_num) + " of " + to_string(STEP_NUM) + " steps");
+
+  std::cout << "pool blocks: " << pool.getPoolBlockIds().size() << ", steps: " << STEP_NUM << ", resolved: " << resolved_num << std::endl;
+  std::cout << "push (us/block)\tresolve (us/block)" << std::endl;
+  std::cout << push_us / (STEP_NUM * FORK_NUM) << "\t\t" << resolve_us / std::max(1, resolved_num) << std::endl;
+
+  return 0;
+}
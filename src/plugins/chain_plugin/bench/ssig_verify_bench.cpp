@@ -0,0 +1,80 @@
+#include "../../../../lib/tethys-utils/src/ags.hpp"
+#include "../../../../lib/tethys-utils/src/sha256.hpp"
+#include "../../../../lib/tethys-utils/src/type_converter.hpp"
+#include "../include/ssig_verifier.hpp"
+#include "../include/worker_pool.hpp"
+#include "bench_util.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int VERIFY_REPEAT_NUM = 5; // 서명 검증은 느리므로 기본보다 적게 반복한다
+
+std::string readFile(const std::string &path) {
+  std::ifstream file(path);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+} // namespace
+
+// block 하나의 SSig 검증 처리량 (signatures/sec). 순차 검증 vs SSigBatchVerifier를 thread 수별로
+// usage: ssig_verify_bench <signer_cert.pem> <signer_sk.pem> [signer_num]  (default signer_num: 200 = MAX_SIGNER_NUM)
+// 인증서 하나로 만든 서명을 signer_num개 검증한다. 서명 하나의 검증 비용은 key와 관계없으므로 처리량 측정에는 충분하다
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cout << "usage: " << argv[0] << " <signer_cert.pem> <signer_sk.pem> [signer_num]" << std::endl;
+    return 1;
+  }
+
+  std::string signer_cert = readFile(argv[1]);
+  std::string signer_sk = readFile(argv[2]);
+  size_t signer_num = (argc > 3) ? std::max<size_t>(1, std::stoull(argv[3])) : 200;
+
+  // verifySSigs와 같은 형태의 message: block 정보 hash
+  std::string message = TypeConverter::bytesToString(Sha256::hash(std::string("ssig_verify_bench block info")));
+
+  AGS ags;
+  std::string signer_sig = ags.sign(signer_sk, message);
+  check(ags.verifyPEM(signer_cert, message, signer_sig), "the signature does not verify with the given cert");
+  std::vector<std::pair<std::string, std::string>> cert_sigs(signer_num, {signer_cert, signer_sig});
+
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < VERIFY_REPEAT_NUM; ++n) {
+    for (auto &each_cert_sig : cert_sigs) {
+      ags.verifyPEM(each_cert_sig.first, message, each_cert_sig.second);
+    }
+  }
+  double sequential_rate = signer_num * VERIFY_REPEAT_NUM / elapsedSec(start);
+  std::cout << "signers: " << signer_num << std::endl;
+  std::cout << "threads\tsigs/sec\tsigs/sec/core" << std::endl;
+  std::cout << "seq\t" << sequential_rate << "\t" << sequential_rate << std::endl;
+
+  size_t max_thread_num = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t thread_num = 1; thread_num <= max_thread_num; thread_num *= 2) {
+    // parallelFor를 부른 thread도 함께 검증하므로 pool에는 하나 적게 만든다
+    WorkerPool worker_pool(thread_num - 1);
+    SSigBatchVerifier ssig_verifier(worker_pool);
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < VERIFY_REPEAT_NUM; ++n) {
+      check(ssig_verifier.verifyAll(message, cert_sigs), "batch verification failed");
+    }
+    double batch_rate = signer_num * VERIFY_REPEAT_NUM / elapsedSec(start);
+    std::cout << thread_num << "\t" << batch_rate << "\t" << batch_rate / thread_num << std::endl;
+
+    // 서명 하나가 틀리면 전체가 실패해야 한다
+    auto broken_cert_sigs = cert_sigs;
+    broken_cert_sigs[signer_num / 2].second = ags.sign(signer_sk, message + "x");
+    check(!ssig_verifier.verifyAll(message, broken_cert_sigs), "broken signature was accepted");
+  }
+
+  return 0;
+}
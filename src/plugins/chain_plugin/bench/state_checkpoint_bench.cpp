@@ -0,0 +1,137 @@
+#include "../include/kv_store.hpp"
+#include "../include/mem_ledger.hpp"
+#include "../include/state_checkpoint.hpp"
+#include "../include/worker_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr size_t BLOCK_LEDGER_NUM = 2000;
+
+} // namespace
+
+// 재시작 시 state tree를 만드는 시간 비교. rdb 전체로 다시 만드는 경우(rdb 조회 시간 제외) vs snapshot + diff 반영
+// usage: state_checkpoint_bench [ledger_num] [diff_block_num]  (default: 5000000 100)
+// 현재 디렉토리의 ./leveldb 에 checkpoint를 기록하므로 빈 디렉토리에서 실행한다
+int main(int argc, char *argv[]) {
+  size_t ledger_num = (argc > 1) ? std::stoull(argv[1]) : 5000000;
+  size_t diff_block_num = (argc > 2) ? std::stoull(argv[2]) : 100;
+  size_t contract_ledger_num = ledger_num / 5;
+  size_t user_ledger_num = ledger_num - contract_ledger_num;
+
+  std::mt19937_64 rng(ledger_num);
+  KvController kv_controller;
+  WorkerPool worker_pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+  vector<uint8_t> snapshot_us_root, snapshot_cs_root;
+  vector<uint8_t> expected_us_root, expected_cs_root;
+  double rebuild_ms, start_ms, save_ms;
+  {
+    vector<user_ledger_type> user_ledgers(user_ledger_num);
+    vector<contract_ledger_type> contract_ledgers(contract_ledger_num);
+    for (size_t i = 0; i < user_ledger_num; ++i) {
+      user_ledgers[i].pid = makePid(rng);
+      user_ledgers[i].var_name = "balance";
+      user_ledgers[i].var_value = to_string(i);
+      user_ledgers[i].uid = TypeConverter::encodeBase<64>(makePid(rng));
+      user_ledgers[i].is_empty = false;
+    }
+    for (size_t i = 0; i < contract_ledger_num; ++i) {
+      contract_ledgers[i].pid = makePid(rng);
+      contract_ledgers[i].var_name = "state";
+      contract_ledgers[i].var_value = to_string(i);
+      contract_ledgers[i].is_empty = false;
+    }
+
+    // Chain::setupStateTree의 전체 재구성과 같은 방식
+    StateTree us_tree, cs_tree;
+    us_tree.setWorkerPool(&worker_pool);
+    cs_tree.setWorkerPool(&worker_pool);
+
+    auto start = std::chrono::steady_clock::now();
+    worker_pool.parallelFor(2, [&](size_t tree_idx) {
+      if (tree_idx == 0)
+        us_tree.updateUserState(user_ledgers);
+      else
+        cs_tree.updateContractState(contract_ledgers);
+    });
+    rebuild_ms = elapsedMs(start);
+
+    us_tree.commitVersion("snapshot");
+    cs_tree.commitVersion("snapshot");
+    snapshot_us_root = us_tree.getRootValue();
+    snapshot_cs_root = cs_tree.getRootValue();
+
+    // Chain::resolveBlock처럼 기록을 시작한 뒤 version을 바로 회수하고, 기록하는 동안 이후 블록들을 반영한다
+    StateCheckpoint state_checkpoint(kv_controller);
+    std::shared_mutex tree_mutex;
+    start = std::chrono::steady_clock::now();
+    check(state_checkpoint.startSnapshot(us_tree, cs_tree, tree_mutex, "snapshot", 1), "failed to start snapshot");
+    start_ms = elapsedMs(start);
+    us_tree.releaseVersion("snapshot");
+    cs_tree.releaseVersion("snapshot");
+
+    // snapshot 이후에 확정된 블록들
+    for (size_t n = 0; n < diff_block_num; ++n) {
+      UnresolvedBlock resolved_block;
+      resolved_block.block.setHeight(2 + n);
+      while (resolved_block.user_ledger_list.size() < BLOCK_LEDGER_NUM) {
+        user_ledger_type ledger = user_ledgers[rng() % user_ledger_num];
+        ledger.var_value = to_string(rng());
+        resolved_block.user_ledger_list[ledger.pid] = ledger;
+      }
+
+      {
+        std::unique_lock<std::shared_mutex> lock(tree_mutex);
+        us_tree.updateUserState(resolved_block.user_ledger_list);
+      }
+      state_checkpoint.saveDiff(resolved_block);
+    }
+
+    state_checkpoint.waitSnapshot();
+    save_ms = elapsedMs(start);
+    check(state_checkpoint.hasSnapshot() && state_checkpoint.getSnapshotHeight() == 1, "snapshot was not saved");
+
+    expected_us_root = us_tree.getRootValue();
+    expected_cs_root = cs_tree.getRootValue();
+  }
+
+  // 재시작: snapshot을 올리고 diff를 반영한다 (Chain::loadStateCheckpoint와 같은 순서)
+  StateCheckpoint state_checkpoint(kv_controller);
+  StateTree us_tree, cs_tree;
+  us_tree.setWorkerPool(&worker_pool);
+  cs_tree.setWorkerPool(&worker_pool);
+
+  base58_type snapshot_block_id;
+  block_height_type snapshot_height;
+  auto start = std::chrono::steady_clock::now();
+  check(state_checkpoint.loadSnapshot(us_tree, cs_tree, worker_pool, snapshot_block_id, snapshot_height), "failed to load snapshot");
+  double load_ms = elapsedMs(start);
+
+  // snapshot을 그대로 올린 tree는 저장할 때의 root를 가져야 한다
+  check(snapshot_block_id == "snapshot" && snapshot_height == 1, "snapshot was loaded with a different block id or height");
+  check(us_tree.getRootValue() == snapshot_us_root && cs_tree.getRootValue() == snapshot_cs_root, "snapshot root changed after load");
+
+  start = std::chrono::steady_clock::now();
+  for (block_height_type diff_height = snapshot_height + 1; diff_height <= snapshot_height + diff_block_num; ++diff_height) {
+    vector<user_ledger_type> user_ledgers;
+    vector<contract_ledger_type> contract_ledgers;
+    state_checkpoint.loadDiff(diff_height, user_ledgers, contract_ledgers);
+    us_tree.updateUserState(user_ledgers);
+    cs_tree.updateContractState(contract_ledgers);
+  }
+  double replay_ms = elapsedMs(start);
+
+  std::cout << "user ledgers: " << user_ledger_num << ", contract ledgers: " << contract_ledger_num << ", nodes: "
+            << us_tree.getNodeCount() + cs_tree.getNodeCount() << std::endl;
+  std::cout << "full rebuild (without rdb select): " << rebuild_ms << " ms" << std::endl;
+  std::cout << "snapshot save: " << save_ms << " ms in background (blocking start " << start_ms << " ms)" << std::endl;
+  std::cout << "snapshot load: " << load_ms << " ms, replay " << diff_block_num << " blocks of " << BLOCK_LEDGER_NUM
+            << " ledgers: " << replay_ms << " ms, total " << (load_ms + replay_ms) << " ms" << std::endl;
+
+  check(us_tree.getRootValue() == expected_us_root && cs_tree.getRootValue() == expected_cs_root, "root changed after replaying diffs");
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "../include/mem_ledger.hpp"
+#include "../include/worker_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int BLOCK_NUM = 10;
+
+// Chain::updateStateTree와 같은 방식으로 user / contract tree를 동시에 갱신하는 데 걸리는 시간 (ms, 블록 평균).
+// 같은 변경을 worker pool 없이 반영한 ref tree와 root가 같아야 한다
+double measureRootLatency(StateTree &us_tree, StateTree &cs_tree, StateTree &ref_us_tree, StateTree &ref_cs_tree, vector<string> &user_pids,
+                          vector<string> &contract_pids, WorkerPool &worker_pool, size_t block_size, std::mt19937_64 &rng) {
+  double total_ms = 0;
+
+  for (int n = 0; n < BLOCK_NUM; ++n) {
+    // 변경의 3/4은 user, 1/4은 contract
+    map<string, user_ledger_type> user_ledgers;
+    map<string, contract_ledger_type> contract_ledgers;
+    while (user_ledgers.size() < block_size - block_size / 4) {
+      user_ledger_type ledger;
+      ledger.pid = user_pids[rng() % user_pids.size()];
+      ledger.var_value = to_string(rng());
+      user_ledgers[ledger.pid] = ledger;
+    }
+    while (contract_ledgers.size() < block_size / 4) {
+      contract_ledger_type ledger;
+      ledger.pid = contract_pids[rng() % contract_pids.size()];
+      ledger.var_value = to_string(rng());
+      contract_ledgers[ledger.pid] = ledger;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    worker_pool.parallelFor(2, [&](size_t tree_idx) {
+      if (tree_idx == 0)
+        us_tree.updateUserState(user_ledgers);
+      else
+        cs_tree.updateContractState(contract_ledgers);
+    });
+    total_ms += elapsedMs(start);
+
+    ref_us_tree.updateUserState(user_ledgers);
+    ref_cs_tree.updateContractState(contract_ledgers);
+    check(us_tree.getRootValue() == ref_us_tree.getRootValue() && cs_tree.getRootValue() == ref_cs_tree.getRootValue(),
+          "parallel root differs from the single-thread root with block size " + to_string(block_size));
+  }
+
+  return total_ms / BLOCK_NUM;
+}
+
+} // namespace
+
+// usage: state_root_bench [ledger_num] [binary(0|1)]  (default: 1000000 0)
+int main(int argc, char *argv[]) {
+  size_t ledger_num = (argc > 1) ? std::stoull(argv[1]) : 1000000;
+  StateHashVersion hash_version = (argc > 2 && string(argv[2]) == "1") ? StateHashVersion::BINARY : StateHashVersion::BASE64_CONCAT;
+
+  std::mt19937_64 rng(ledger_num);
+  vector<string> user_pids, contract_pids;
+  vector<user_ledger_type> user_ledgers;
+  vector<contract_ledger_type> contract_ledgers;
+
+  for (size_t i = 0; i < ledger_num; ++i) {
+    user_ledger_type ledger;
+    ledger.pid = makePid(rng);
+    ledger.var_value = to_string(i);
+    user_pids.emplace_back(ledger.pid);
+    user_ledgers.emplace_back(ledger);
+  }
+  for (size_t i = 0; i < ledger_num / 4; ++i) {
+    contract_ledger_type ledger;
+    ledger.pid = makePid(rng);
+    ledger.var_value = to_string(i);
+    contract_pids.emplace_back(ledger.pid);
+    contract_ledgers.emplace_back(ledger);
+  }
+
+  StateTree us_tree(hash_version), cs_tree(hash_version);
+  us_tree.updateUserState(user_ledgers);
+  cs_tree.updateContractState(contract_ledgers);
+
+  StateTree ref_us_tree(hash_version), ref_cs_tree(hash_version);
+  ref_us_tree.updateUserState(user_ledgers);
+  ref_cs_tree.updateContractState(contract_ledgers);
+
+  std::cout << "user ledgers: " << ledger_num << ", contract ledgers: " << ledger_num / 4 << ", hardware threads: "
+            << std::thread::hardware_concurrency() << std::endl;
+  std::cout << "threads\tblock size\troot latency (ms)" << std::endl;
+
+  for (size_t thread_num : {1, 2, 4, 8, 16}) {
+    // 호출한 thread도 참여하므로 worker는 하나 적게
+    WorkerPool worker_pool(thread_num - 1);
+    us_tree.setWorkerPool(&worker_pool);
+    cs_tree.setWorkerPool(&worker_pool);
+
+    for (size_t block_size : {256, 1024, 4096, 16384}) {
+      double latency_ms =
+          measureRootLatency(us_tree, cs_tree, ref_us_tree, ref_cs_tree, user_pids, contract_pids, worker_pool, block_size, rng);
+      std::cout << thread_num << "\t" << block_size << "\t\t" << latency_ms << std::endl;
+    }
+  }
+
+  us_tree.setWorkerPool(nullptr);
+  cs_tree.setWorkerPool(nullptr);
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include "../include/mem_ledger.hpp"
+#include "bench_util.hpp"
+
+#include <fstream>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+// /proc/self/status의 VmRSS (kB)
+long getResidentKb() {
+  std::ifstream status("/proc/self/status");
+  string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0)
+      return std::stol(line.substr(6));
+  }
+  return -1;
+}
+
+// 32 byte 임의 pid를 가진 user ledger들을 만든다
+vector<user_ledger_type> makeLedgers(size_t ledger_num) {
+  std::mt19937_64 rng(ledger_num);
+  vector<user_ledger_type> ledgers(ledger_num);
+
+  for (size_t i = 0; i < ledger_num; ++i) {
+    ledgers[i].pid = makePid(rng);
+    ledgers[i].var_value = to_string(i);
+    ledgers[i].is_empty = false;
+  }
+  return ledgers;
+}
+
+constexpr size_t BLOCK_LEDGER_NUM = 2000;
+constexpr int BLOCK_NUM = 20;
+
+const char *versionName(StateHashVersion hash_version) {
+  return hash_version == StateHashVersion::BINARY ? "binary" : "base64";
+}
+
+// root는 반영 순서와 관계없이 leaf들로만 정해져야 하고, 저장한 version의 root는 이후 블록을 반영해도 그대로여야 한다.
+// checkpoint처럼 마지막 version을 꺼내 다시 만든 tree도 같은 root를 가져야 한다
+void checkRoots(const StateTree &state_tree, vector<user_ledger_type> &ledgers, const vector<vector<uint8_t>> &block_roots) {
+  const char *version_name = versionName(state_tree.getHashVersion());
+  for (size_t n = 0; n < block_roots.size(); ++n) {
+    check(state_tree.getRootValue(makeBlockId(n + 1)) == block_roots[n],
+          string(version_name) + " root of version " + makeBlockId(n + 1) + " changed after later blocks");
+  }
+
+  StateTree rebuilt_tree(state_tree.getHashVersion());
+  rebuilt_tree.updateUserState(ledgers);
+  check(rebuilt_tree.getRootValue() == block_roots.back(), string(version_name) + " root depends on the update order");
+
+  vector<StateNode> nodes;
+  vector<user_ledger_type> user_ledgers;
+  vector<contract_ledger_type> contract_ledgers;
+  check(state_tree.exportVersion(
+            makeBlockId(block_roots.size()), [&](const StateNode &node) { nodes.push_back(node); },
+            [&](const user_ledger_type &ledger) { user_ledgers.push_back(ledger); },
+            [&](const contract_ledger_type &ledger) { contract_ledgers.push_back(ledger); }),
+        string(version_name) + " export failed");
+
+  StateTree imported_tree(state_tree.getHashVersion());
+  check(imported_tree.importTree(std::move(nodes), std::move(user_ledgers), std::move(contract_ledgers)) &&
+            imported_tree.getRootValue() == block_roots.back(),
+        string(version_name) + " root changed after export / import");
+  check(imported_tree.getUserLedger(ledgers.front().pid).value_or(user_ledger_type()).var_value == ledgers.front().var_value,
+        string(version_name) + " ledger changed after export / import");
+}
+
+void runBench(size_t ledger_num, StateHashVersion hash_version) {
+  vector<user_ledger_type> ledgers = makeLedgers(ledger_num);
+
+  long rss_before = getResidentKb();
+  StateTree state_tree(hash_version);
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto &each_ledger : ledgers) {
+    state_tree.insertNode(each_ledger);
+  }
+  double insert_sec = elapsedSec(start);
+
+  long rss_after = getResidentKb();
+
+  // 기존 값 갱신 (1/4)
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ledger_num; i += 4) {
+    ledgers[i].var_value += "_mod";
+    state_tree.insertNode(ledgers[i]);
+  }
+  double update_sec = elapsedSec(start);
+
+  start = std::chrono::steady_clock::now();
+  size_t found_num = 0;
+  for (size_t i = 0; i < ledger_num; i += 4) {
+    found_num += state_tree.getUserLedger(ledgers[i].pid).has_value();
+  }
+  double lookup_sec = elapsedSec(start);
+
+  size_t touched_num = (ledger_num + 3) / 4;
+  std::cout << versionName(hash_version) << "\t" << ledger_num << "\t" << state_tree.getNodeCount() << "\t"
+            << (ledger_num / insert_sec) << "\t" << (touched_num / update_sec) << "\t" << (touched_num / lookup_sec) << "\t"
+            << (state_tree.getMemoryUsage() / (1024 * 1024)) << "\t\t" << ((rss_after - rss_before) / 1024) << std::endl;
+
+  check(found_num == touched_num, "lookup found " + to_string(found_num) + " of " + to_string(touched_num) + " ledgers");
+
+  // 한 블록에서 BLOCK_LEDGER_NUM개의 ledger가 바뀌는 경우. ledger마다 root까지 re-hashing vs 한꺼번에 반영
+  std::mt19937_64 rng(ledger_num + 1);
+  double single_ms = 0, batch_ms = 0;
+  vector<vector<uint8_t>> block_roots;
+  for (int n = 0; n < BLOCK_NUM; ++n) {
+    map<string, user_ledger_type> block_ledgers;
+    vector<size_t> block_ledger_idxs;
+    for (size_t i = 0; i < BLOCK_LEDGER_NUM; ++i) {
+      block_ledger_idxs.push_back(rng() % ledger_num);
+      user_ledger_type &each_ledger = ledgers[block_ledger_idxs.back()];
+      each_ledger.var_value = to_string(rng());
+      block_ledgers[each_ledger.pid] = each_ledger;
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (auto &each_ledger : block_ledgers) {
+      state_tree.insertNode(each_ledger.second);
+    }
+    single_ms += elapsedMs(start);
+
+    for (auto &each_ledger : block_ledgers) {
+      each_ledger.second.var_value += "_batch";
+    }
+
+    start = std::chrono::steady_clock::now();
+    state_tree.updateUserState(block_ledgers);
+    batch_ms += elapsedMs(start);
+
+    for (auto idx : block_ledger_idxs)
+      ledgers[idx] = block_ledgers[ledgers[idx].pid];
+    state_tree.commitVersion(makeBlockId(n + 1));
+    block_roots.push_back(state_tree.getRootValue());
+  }
+
+  std::cout << "\tblock of " << BLOCK_LEDGER_NUM << " ledgers: per-ledger " << (single_ms / BLOCK_NUM) << " ms, batch "
+            << (batch_ms / BLOCK_NUM) << " ms" << std::endl;
+
+  checkRoots(state_tree, ledgers, block_roots);
+}
+
+} // namespace
+
+// usage: state_tree_bench [ledger_num ...]  (default: 1000000)
+int main(int argc, char *argv[]) {
+  vector<size_t> ledger_nums;
+  for (int i = 1; i < argc; ++i) {
+    ledger_nums.emplace_back(std::stoull(argv[i]));
+  }
+  if (ledger_nums.empty())
+    ledger_nums.emplace_back(1000000);
+
+  std::cout << "hash\tledgers\tnodes\tinsert/s\tupdate/s\tlookup/s\ttree (MB)\trss delta (MB)" << std::endl;
+  for (auto ledger_num : ledger_nums) {
+    runBench(ledger_num, StateHashVersion::BASE64_CONCAT);
+    runBench(ledger_num, StateHashVersion::BINARY);
+  }
+
+  return 0;
+}
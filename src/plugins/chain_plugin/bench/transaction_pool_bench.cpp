@@ -0,0 +1,126 @@
+#include "../include/transacton_pool.hpp"
+#include "bench_util.hpp"
+
+#include <map>
+#include <thread>
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int PRODUCER_NUM = 16;
+constexpr int TX_PER_PRODUCER = 2000;
+constexpr auto FETCH_PERIOD = std::chrono::milliseconds(5);
+
+// 예전 TransactionPool: map 하나를 shared_mutex 하나로 지키고, block을 만들 때 pool 전체를 복사한다
+class LegacyTransactionPool {
+public:
+  bool add(const Transaction &tx) {
+    unique_lock<shared_mutex> writerLock(pool_mutex);
+    return tx_pool.try_emplace(tx.getTxId(), tx).second;
+  }
+
+  vector<Transaction> fetchAll() {
+    shared_lock<shared_mutex> readerLock(pool_mutex);
+    vector<Transaction> v;
+    v.reserve(tx_pool.size());
+    std::transform(tx_pool.begin(), tx_pool.end(), std::back_inserter(v), [](auto &kv) { return kv.second; });
+    return v;
+  }
+
+private:
+  std::map<string, Transaction> tx_pool;
+  std::shared_mutex pool_mutex;
+};
+
+Transaction makeTransaction(int producer_idx, int tx_idx) {
+  nlohmann::json msg_tx = {{"txid", "bench_tx_" + to_string(producer_idx) + "_" + to_string(tx_idx)},
+                           {"world", "TETHYS19"},
+                           {"chain", "SEOUL@KR"},
+                           {"time", to_string(1500000000 + tx_idx)},
+                           {"body", {{"cid", "VALUE-TRANSFER::0::TETHYS19::SEOUL@KR"},
+                                     {"receiver", "bench_receiver"},
+                                     {"fee", to_string((producer_idx * 7 + tx_idx * 13) % 100)},
+                                     {"input", nlohmann::json::array({"bench_input", to_string(tx_idx)})}}},
+                           {"user", {{"id", "bench_user_" + to_string(producer_idx)}, {"pk", string(128, 'P')}, {"sig", string(88, 'S')}}},
+                           {"endorser", nlohmann::json::array()}};
+  Transaction tx;
+  tx.inputMsgTx(msg_tx);
+  return tx;
+}
+
+// PRODUCER_NUM개의 thread가 동시에 add 하고, 한 thread는 FETCH_PERIOD마다 block에 넣을 tx를 가져간다
+template <typename Pool, typename FetchFunc>
+void measure(const char *name, Pool &pool, const vector<vector<Transaction>> &txs, FetchFunc fetch) {
+  std::atomic<bool> done{false};
+  double fetch_ms = 0;
+  size_t fetch_num = 0;
+  size_t fetched_tx_num = 0;
+
+  std::thread block_producer([&]() {
+    while (!done) {
+      auto fetch_start = std::chrono::steady_clock::now();
+      fetched_tx_num = fetch(pool).size();
+      fetch_ms += elapsedMs(fetch_start);
+      ++fetch_num;
+      std::this_thread::sleep_for(FETCH_PERIOD);
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  vector<std::thread> producers;
+  for (int i = 0; i < PRODUCER_NUM; ++i) {
+    producers.emplace_back([&pool, &txs, i]() {
+      for (auto &each_tx : txs[i])
+        pool.add(each_tx);
+    });
+  }
+  for (auto &each_producer : producers)
+    each_producer.join();
+  double add_ms = elapsedMs(start);
+
+  done = true;
+  block_producer.join();
+
+  size_t total_tx_num = PRODUCER_NUM * TX_PER_PRODUCER;
+  std::cout << name << "\t" << (total_tx_num / add_ms * 1000) << "\t\t" << (fetch_num > 0 ? fetch_ms / fetch_num : 0) << "\t\t"
+            << fetched_tx_num << std::endl;
+}
+
+} // namespace
+
+// 16개 thread가 동시에 tx를 넣을 때의 add 처리량과, 그동안 block producer가 tx를 가져가는 데 걸리는 시간
+int main() {
+  vector<vector<Transaction>> txs(PRODUCER_NUM);
+  for (int i = 0; i < PRODUCER_NUM; ++i) {
+    txs[i].reserve(TX_PER_PRODUCER);
+    for (int j = 0; j < TX_PER_PRODUCER; ++j)
+      txs[i].push_back(makeTransaction(i, j));
+  }
+
+  std::cout << "producers: " << PRODUCER_NUM << ", txs: " << PRODUCER_NUM * TX_PER_PRODUCER << std::endl;
+  std::cout << "pool\tadds/sec\tfetch (ms)\tlast fetched txs" << std::endl;
+
+  {
+    LegacyTransactionPool pool;
+    measure("legacy", pool, txs, [](LegacyTransactionPool &p) { return p.fetchAll(); });
+  }
+  for (size_t shard_num : {1, 4, 16, 64}) {
+    TransactionPool pool(PRODUCER_NUM * TX_PER_PRODUCER, config::TX_POOL_MAX_AGE, shard_num);
+    string name = "shard " + to_string(shard_num);
+    measure(name.c_str(), pool, txs, [](TransactionPool &p) { return p.fetchTop(); });
+  }
+
+  // 확정된 블록의 tx를 지운 뒤에는 남은 tx만 가져가야 한다
+  TransactionPool pool(PRODUCER_NUM * TX_PER_PRODUCER);
+  for (auto &each_tx : txs[0])
+    pool.add(each_tx);
+  auto top_txs = pool.fetchTop();
+  pool.remove(top_txs);
+  for (auto &each_tx : pool.fetchTop())
+    check(each_tx.getFee() <= top_txs.back().getFee(), "fetchTop returned a higher fee after the top txs were removed");
+  check(pool.size() == TX_PER_PRODUCER - top_txs.size(), "remove left " + to_string(pool.size()) + " txs");
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include "../include/unresolved_block_pool.hpp"
+#include "bench_util.hpp"
+
+using namespace tethys;
+using namespace tethys::bench;
+
+namespace {
+
+constexpr int LOOKUP_COUNT = 2000;
+
+// 분기 없이 depth 개의 블록이 연결된 pool을 만든다. 각 블록은 ledger_num개의 user ledger와 txagg를 가진다.
+void fillPool(UnresolvedBlockPool &pool, int depth, int ledger_num) {
+  pool.setPool(makeBlockId(0), 0, 0, "", "");
+
+  nlohmann::json txaggs = nlohmann::json::array();
+  for (int i = 0; i < ledger_num; ++i) {
+    txaggs.push_back(string(256, 'A'));
+  }
+
+  for (int height = 1; height <= depth; ++height) {
+    Block block = makeBlock(height, 0, makeBlockId(height - 1), 0);
+    block.setTxaggs(txaggs);
+    pool.pushBlock(block);
+
+    UnresolvedBlock unresolved_block = pool.getUnresolvedBlock(block.getBlockId(), height);
+    for (int i = 0; i < ledger_num; ++i) {
+      user_ledger_type ledger;
+      ledger.pid = to_string(height) + "_" + to_string(i);
+      ledger.var_value = to_string(i);
+      ledger.is_empty = false;
+      unresolved_block.user_ledger_list[ledger.pid] = ledger;
+    }
+    pool.setUnresolvedBlock(unresolved_block);
+  }
+}
+
+// 찾을 수 없는 pid로 검색하여 항상 pool 전체를 거슬러 올라가게 한다
+double measureCopyWalk(UnresolvedBlockPool &pool, int depth) {
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < LOOKUP_COUNT; ++n) {
+    int pool_deq_idx = depth - 1;
+    int pool_vec_idx = 0;
+    while (pool_deq_idx >= 0) {
+      auto ledgers = pool.getUnresolvedBlock(pool_deq_idx, pool_vec_idx).user_ledger_list;
+      if (ledgers.find("not_exist") != ledgers.end())
+        break;
+      pool_vec_idx = pool.getUnresolvedBlock(pool_deq_idx, pool_vec_idx).prev_vec_idx;
+      --pool_deq_idx;
+    }
+  }
+  return elapsedUs(start) / LOOKUP_COUNT;
+}
+
+double measureTraverse(UnresolvedBlockPool &pool, int depth) {
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < LOOKUP_COUNT; ++n) {
+    pool.traverseFromPoint(depth - 1, 0, [](const UnresolvedBlock &each_block) {
+      return each_block.user_ledger_list.find("not_exist") == each_block.user_ledger_list.end();
+    });
+  }
+  return elapsedUs(start) / LOOKUP_COUNT;
+}
+
+double measureIndexLookup(UnresolvedBlockPool &pool, int depth) {
+  user_ledger_type found_ledger;
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < LOOKUP_COUNT; ++n) {
+    pool.findUserLedger(depth - 1, 0, "not_exist", found_ledger);
+  }
+  return elapsedUs(start) / LOOKUP_COUNT;
+}
+
+} // namespace
+
+int main() {
+  std::cout << "depth\tledgers/block\tcopy walk (us)\ttraverse (us)\tindex (us)" << std::endl;
+
+  for (int depth : {2, 4, 8, 16}) {
+    for (int ledger_num : {16, 256, 4096}) {
+      UnresolvedBlockPool pool;
+      fillPool(pool, depth, ledger_num);
+
+      double copy_us = measureCopyWalk(pool, depth);
+      double traverse_us = measureTraverse(pool, depth);
+      double index_us = measureIndexLookup(pool, depth);
+
+      // 가장 아래 블록에서 보면 모든 블록의 ledger가 보이고, 없는 pid는 찾지 못해야 한다
+      user_ledger_type found_ledger;
+      check(pool.findUserLedger(depth - 1, 0, "1_" + to_string(ledger_num - 1), found_ledger) &&
+                found_ledger.var_value == to_string(ledger_num - 1),
+            "ledger of the first block is not visible from the tip");
+      check(!pool.findUserLedger(depth - 1, 0, "not_exist", found_ledger), "unknown pid was found");
+
+      std::cout << depth << "\t" << ledger_num << "\t\t" << copy_us << "\t\t" << traverse_us << "\t\t" << index_us << std::endl;
+    }
+  }
+
+  return 0;
+}
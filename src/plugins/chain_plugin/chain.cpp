@@ -2,8 +2,10 @@
 #include "../../../lib/appbase/include/application.hpp"
 #include "../../../lib/tethys-utils/src/ags.hpp"
 #include "../../../lib/tinyxml/include/tinyxml2.h"
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <regex>
+#include <unordered_set>
 
 namespace tethys {
 
@@ -208,11 +210,25 @@ Chain::Chain(string_view dbms, string_view table_name, string_view db_user_id, s
   rdb_controller = make_unique<RdbController>(dbms, table_name, db_user_id, db_password);
   kv_controller = make_unique<KvController>();
   unresolved_block_pool = make_unique<UnresolvedBlockPool>();
-  m_us_tree = StateTree();
-  m_cs_tree = StateTree();
+  persistence_stage = make_unique<PersistenceStage>(
+      config::PERSISTENCE_QUEUE_SIZE, [this](const UnresolvedBlock &resolved_block) { return rdb_controller->commitResolvedBlock(resolved_block); },
+      getLatestResolvedHeight());
+  persistence_stage->start();
+
+  // parallelFor를 호출한 thread도 작업에 참여하므로 core 수보다 하나 적게 만든다
+  worker_pool = make_unique<WorkerPool>(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  m_us_tree = StateTree(config::STATE_TREE_HASH_VERSION);
+  m_cs_tree = StateTree(config::STATE_TREE_HASH_VERSION);
+  m_us_tree.setWorkerPool(worker_pool.get());
+  m_cs_tree.setWorkerPool(worker_pool.get());
+  state_checkpoint = make_unique<StateCheckpoint>(*kv_controller);
 }
 
 Chain::~Chain() {
+  stopPersistence();
+  // snapshot thread가 state tree를 읽고 있으므로 tree보다 먼저 멈춘다
+  if (state_checkpoint != nullptr)
+    state_checkpoint->stopSnapshot();
   impl.reset();
 }
 
@@ -317,7 +333,11 @@ void Chain::saveChain(local_chain_type &chain_info) {
 }
 
 void Chain::saveBlockIds() {
-  nlohmann::json id_array = unresolved_block_pool->getPoolBlockIds();
+  // 확정되었지만 아직 rdb에 commit되지 않은 블록도 재시작 시 복구되어야 하므로 함께 저장한다
+  nlohmann::json id_array = persistence_stage->getPendingBlockIds();
+  for (auto &each_block_id : unresolved_block_pool->getPoolBlockIds()) {
+    id_array.push_back(each_block_id);
+  }
 
   kv_controller->saveBlockIds(TypeConverter::bytesToString(nlohmann::json::to_cbor(id_array)));
 }
@@ -330,12 +350,15 @@ void Chain::saveBackupBlock(const nlohmann::json &block_json) {
 }
 
 void Chain::saveBackupResult(const UnresolvedBlock &UR_block) {
-  base58_type block_id = UR_block.block.getBlockId();
-  kv_controller->saveBackupUserLedgers(block_id, unresolved_block_pool->serializeUserLedgerList(UR_block));
-  kv_controller->saveBackupContractLedgers(block_id, unresolved_block_pool->serializeContractLedgerList(UR_block));
-  kv_controller->saveBackupUserAttributes(block_id, unresolved_block_pool->serializeUserAttributeList(UR_block));
-  kv_controller->saveBackupUserCerts(block_id, unresolved_block_pool->serializeUserCertList(UR_block));
-  kv_controller->saveBackupContracts(block_id, unresolved_block_pool->serializeContractList(UR_block));
+  kv_controller->saveBackupResult(UR_block.block.getBlockId(), UnresolvedBlockPool::serializeBackupResult(UR_block));
+}
+
+void Chain::beginGroupCommit() {
+  kv_controller->beginGroupCommit();
+}
+
+void Chain::endGroupCommit() {
+  kv_controller->endGroupCommit();
 }
 
 void Chain::saveSelfInfo(self_info_type &self_info) {
@@ -353,6 +376,14 @@ void Chain::restorePool() {
     return;
   }
 
+  // 처리 결과가 남아 있는 블록. 모두 pool에 넣은 뒤 height 순서로 state tree에 반영한다
+  struct RestoredResult {
+    base58_type block_id;
+    block_height_type block_height;
+    string serialized_result;
+  };
+  vector<RestoredResult> restored_results;
+
   nlohmann::json id_array_json = nlohmann::json::from_cbor(serialized_id_array);
   for (auto &each_block_id : id_array_json) {
     base58_type block_id = each_block_id;
@@ -363,111 +394,47 @@ void Chain::restorePool() {
     Block restored_block;
     restored_block.initialize(block_msg);
     block_push_result_type push_result = unresolved_block_pool->pushBlock(restored_block);
+    if (push_result.block_height == 0) // 이미 rdb에 commit된 블록
+      continue;
+    if (!push_result.linked) // 부모를 기다리는 orphan 블록은 처리된 적이 없다
+      continue;
 
-    UnresolvedBlock restored_unresolved_block =
-        unresolved_block_pool->getUnresolvedBlock(restored_block.getBlockId(), push_result.block_height);
-
-    nlohmann::json user_ledger_list_json = nlohmann::json::from_cbor(kv_controller->loadBackupUserLedgers(block_id));
-    nlohmann::json contract_ledger_list_json = nlohmann::json::from_cbor(kv_controller->loadBackupContractLedgers(block_id));
-    nlohmann::json user_attribute_list_json = nlohmann::json::from_cbor(kv_controller->loadBackupUserAttributes(block_id));
-    nlohmann::json user_cert_list_json = nlohmann::json::from_cbor(kv_controller->loadBackupUserCerts(block_id));
-    nlohmann::json contract_list_json = nlohmann::json::from_cbor(kv_controller->loadBackupContracts(block_id));
-
-    restoreUserLedgerList(restored_unresolved_block, user_ledger_list_json);
-    restoreContractLedgerList(restored_unresolved_block, contract_ledger_list_json);
-    restoreUserAttributeList(restored_unresolved_block, user_attribute_list_json);
-    restoreUserCertList(restored_unresolved_block, user_cert_list_json);
-    restoreContractList(restored_unresolved_block, contract_list_json);
-  }
-}
-
-void Chain::restoreUserLedgerList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_ledger_list_json) {
-  for (auto &each_user_ledger_json : user_ledger_list_json) {
-    user_ledger_type each_user_ledger;
-
-    each_user_ledger.var_name = json::get<string>(each_user_ledger_json, "var_name").value();
-    each_user_ledger.var_value = json::get<string>(each_user_ledger_json, "var_value").value();
-    each_user_ledger.var_type = stoi(json::get<string>(each_user_ledger_json, "var_type").value());
-    each_user_ledger.uid = json::get<string>(each_user_ledger_json, "uid").value();
-    each_user_ledger.up_time = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_user_ledger_json, "up_time").value()));
-    each_user_ledger.up_block = stoi(json::get<string>(each_user_ledger_json, "up_block").value());
-    each_user_ledger.tag = json::get<string>(each_user_ledger_json, "tag").value();
-    each_user_ledger.pid = json::get<string>(each_user_ledger_json, "pid").value();
-    each_user_ledger.query_type = static_cast<tethys::QueryType>(stoi(json::get<string>(each_user_ledger_json, "query_type").value()));
-    each_user_ledger.is_empty = json::get<bool>(each_user_ledger_json, "is_empty").value();
-
-    restored_unresolved_block.user_ledger_list[each_user_ledger.pid] = each_user_ledger;
-  }
-}
-
-void Chain::restoreContractLedgerList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &contract_ledger_list_json) {
-  for (auto &each_contract_ledger_json : contract_ledger_list_json) {
-    contract_ledger_type each_contract_ledger;
-
-    each_contract_ledger.var_name = json::get<string>(each_contract_ledger_json, "var_name").value();
-    each_contract_ledger.var_value = json::get<string>(each_contract_ledger_json, "var_value").value();
-    each_contract_ledger.var_type = stoi(json::get<string>(each_contract_ledger_json, "var_type").value());
-    each_contract_ledger.cid = json::get<string>(each_contract_ledger_json, "cid").value();
-    each_contract_ledger.up_time = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_contract_ledger_json, "up_time").value()));
-    each_contract_ledger.up_block = stoi(json::get<string>(each_contract_ledger_json, "up_block").value());
-    each_contract_ledger.var_info = json::get<string>(each_contract_ledger_json, "var_info").value();
-    each_contract_ledger.pid = json::get<string>(each_contract_ledger_json, "pid").value();
-    each_contract_ledger.query_type =
-        static_cast<tethys::QueryType>(stoi(json::get<string>(each_contract_ledger_json, "query_type").value()));
-    each_contract_ledger.is_empty = json::get<bool>(each_contract_ledger_json, "is_empty").value();
+    // 처리 결과가 기록되지 않은 블록은 다시 처리되도록 그대로 둔다
+    string serialized_result = kv_controller->loadBackupResult(block_id);
+    if (serialized_result.empty())
+      continue;
 
-    restored_unresolved_block.contract_ledger_list[each_contract_ledger.pid] = each_contract_ledger;
+    restored_results.push_back({block_id, push_result.block_height, std::move(serialized_result)});
   }
-}
-
-void Chain::restoreUserAttributeList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_attribute_list_json) {
-  for (auto &each_user_attribute_json : user_attribute_list_json) {
-    user_attribute_type each_user_attribute;
-
-    each_user_attribute.uid = json::get<string>(each_user_attribute_json, "uid").value();
-    each_user_attribute.register_day =
-        static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_user_attribute_json, "register_day").value()));
-    each_user_attribute.register_code = json::get<string>(each_user_attribute_json, "register_code").value();
-    each_user_attribute.gender = stoi(json::get<string>(each_user_attribute_json, "gender").value());
-    each_user_attribute.isc_type = json::get<string>(each_user_attribute_json, "isc_type").value();
-    each_user_attribute.isc_code = json::get<string>(each_user_attribute_json, "isc_code").value();
-    each_user_attribute.location = json::get<string>(each_user_attribute_json, "location").value();
-    each_user_attribute.age_limit = stoi(json::get<string>(each_user_attribute_json, "age_limit").value());
-    each_user_attribute.sigma = json::get<string>(each_user_attribute_json, "sigma").value();
 
-    restored_unresolved_block.user_attribute_list[each_user_attribute.uid] = each_user_attribute;
-  }
-}
+  std::stable_sort(restored_results.begin(), restored_results.end(),
+                   [](const RestoredResult &lhs, const RestoredResult &rhs) { return lhs.block_height < rhs.block_height; });
 
-void Chain::restoreUserCertList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_cert_list_json) {
-  for (auto &each_user_cert_json : user_cert_list_json) {
-    user_cert_type each_user_cert;
+  // 부모의 state tree version 위에 결과를 반영하고 블록의 version을 남긴다.
+  // 부모의 version이 없으면(부모가 다시 처리되어야 하면) 그 결과도 믿을 수 없으므로 다시 처리되도록 둔다
+  for (auto &each_result : restored_results) {
+    UnresolvedBlock restored_unresolved_block = unresolved_block_pool->getUnresolvedBlock(each_result.block_id, each_result.block_height);
+    if (!UnresolvedBlockPool::deserializeBackupResult(each_result.serialized_result, restored_unresolved_block)) {
+      logger::ERROR("Failed to restore the result backup of block {}", each_result.block_id);
+      continue;
+    }
 
-    each_user_cert.uid = json::get<string>(each_user_cert_json, "uid").value();
-    each_user_cert.sn = json::get<string>(each_user_cert_json, "sn").value();
-    each_user_cert.nvbefore = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_user_cert_json, "nvbefore").value()));
-    each_user_cert.nvafter = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_user_cert_json, "nvafter").value()));
-    each_user_cert.x509 = json::get<string>(each_user_cert_json, "x509").value();
+    base58_type prev_block_id = restored_unresolved_block.block.getPrevBlockId();
+    {
+      std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+      if (!m_us_tree.checkoutVersion(prev_block_id) || !m_cs_tree.checkoutVersion(prev_block_id))
+        continue;
+    }
 
-    restored_unresolved_block.user_cert_list[each_user_cert.sn] = each_user_cert;
+    if (!unresolved_block_pool->setUnresolvedBlock(restored_unresolved_block))
+      continue;
+    updateStateTree(restored_unresolved_block);
   }
-}
-
-void Chain::restoreContractList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &contract_list_json) {
-  for (auto &each_contract_json : contract_list_json) {
-    contract_type each_contract;
 
-    each_contract.cid = json::get<string>(each_contract_json, "cid").value();
-    each_contract.after = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_contract_json, "after").value()));
-    each_contract.before = static_cast<tethys::timestamp_t>(stoll(json::get<string>(each_contract_json, "before").value()));
-    each_contract.author = json::get<string>(each_contract_json, "author").value();
-    each_contract.friends = json::get<string>(each_contract_json, "friends").value();
-    each_contract.contract = json::get<string>(each_contract_json, "contract").value();
-    each_contract.desc = json::get<string>(each_contract_json, "desc").value();
-    each_contract.sigma = json::get<string>(each_contract_json, "sigma").value();
-
-    restored_unresolved_block.contract_list[each_contract.cid] = each_contract;
-  }
+  // head는 아직 확정된 블록이므로 tree도 확정된 version으로 되돌린다
+  std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+  m_us_tree.checkoutVersion(m_confirmed_state_id);
+  m_cs_tree.checkoutVersion(m_confirmed_state_id);
 }
 
 // RDB functions
@@ -596,6 +563,70 @@ const nlohmann::json Chain::queryContractScopeGet(const nlohmann::json &where_js
   return result_json;
 }
 
+const nlohmann::json Chain::queryUserScopeProof(const nlohmann::json &where_json) {
+  return queryStateProof(m_us_tree, where_json);
+}
+
+const nlohmann::json Chain::queryContractScopeProof(const nlohmann::json &where_json) {
+  return queryStateProof(m_cs_tree, where_json);
+}
+
+// where: {"pid": [base64 pid, ...], "block_id": 기준 블록 (없으면 마지막으로 확정된 블록)}
+// tree에 있는 pid들의 (pid, var_value)와 이들을 state root에 대해 한꺼번에 증명하는 proof를 돌려준다
+const nlohmann::json Chain::queryStateProof(const StateTree &state_tree, const nlohmann::json &where_json) {
+  vector<string> pids;
+  auto pid_json = where_json.find("pid");
+  if (pid_json != where_json.end() && pid_json->is_array()) {
+    for (auto &each_pid : *pid_json) {
+      pids.emplace_back(TypeConverter::decodeBase<64>(each_pid.get<string>()));
+    }
+  } else if (pid_json != where_json.end() && pid_json->is_string()) {
+    pids.emplace_back(TypeConverter::decodeBase<64>(pid_json->get<string>()));
+  }
+
+  string proof;
+  vector<pair<string, string>> proven_leaves;
+  base58_type block_id;
+  vector<uint8_t> state_root;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_state_tree_mutex);
+    block_id = json::get<string>(where_json, "block_id").value_or(m_confirmed_state_id);
+    if (!state_tree.getProof(block_id, pids, proof, proven_leaves)) {
+      logger::ERROR("State proof: no state of block {}", block_id);
+      return nlohmann::json();
+    }
+    state_root = state_tree.getRootValue(block_id);
+  }
+
+  nlohmann::json result_json;
+  result_json["name"] = nlohmann::json::array();
+  result_json["name"].push_back("pid");
+  result_json["name"].push_back("var_value");
+
+  result_json["data"] = nlohmann::json::array();
+  for (int i = 0; i < proven_leaves.size(); ++i) {
+    result_json["data"][i].push_back(TypeConverter::encodeBase<64>(proven_leaves[i].first));
+    result_json["data"][i].push_back(proven_leaves[i].second);
+  }
+
+  result_json["block_id"] = block_id;
+  result_json["state_root"] = TypeConverter::encodeBase<64>(state_root);
+  result_json["proof"] = TypeConverter::encodeBase<64>(proof);
+
+  // tree에 없는 pid는 proof에 포함되지 않는다
+  std::unordered_set<string> proven_pids;
+  for (auto &each_leaf : proven_leaves) {
+    proven_pids.insert(each_leaf.first);
+  }
+  result_json["not_found"] = nlohmann::json::array();
+  for (auto &each_pid : pids) {
+    if (proven_pids.insert(each_pid).second)
+      result_json["not_found"].push_back(TypeConverter::encodeBase<64>(each_pid));
+  }
+
+  return result_json;
+}
+
 // const nlohmann::json Chain::queryBlockGet(const nlohmann::json &where_json) {
 //  Block found_block = rdb_controller->queryBlockGet(where_json);
 //  nlohmann::json result_json;
@@ -654,6 +685,47 @@ string Chain::getUserCert(const base58_type &user_id) {
   return rdb_controller->getUserCert(user_id);
 }
 
+map<base58_type, string> Chain::getUserCerts(const vector<base58_type> &user_ids) {
+  return rdb_controller->getUserCerts(user_ids);
+}
+
+map<base58_type, string> Chain::getUserCertsFromPoint(const vector<base58_type> &user_ids, const base58_type &block_id,
+                                                      block_height_type block_height) {
+  map<base58_type, string> user_certs;
+  unordered_set<base58_type> missed_ids(user_ids.begin(), user_ids.end());
+
+  // 최근 블록부터 보므로 한 uid는 가장 최근에 등록된 인증서를 쓴다
+  auto take_certs = [&](const UnresolvedBlock &each_block) {
+    for (auto &each_cert : each_block.user_cert_list) {
+      if (missed_ids.erase(each_cert.second.uid) > 0)
+        user_certs[each_cert.second.uid] = each_cert.second.x509;
+    }
+    return !missed_ids.empty();
+  };
+
+  block_pool_info_type pool_info;
+  if (unresolved_block_pool->getBlockPoolInfo(block_id, block_height, pool_info))
+    unresolved_block_pool->traverseFromPoint(pool_info.deq_idx, pool_info.vec_idx, take_certs);
+
+  // 확정되었지만 아직 rdb에 commit되지 않은 블록. commit이 끝난 블록은 queue에서 빠지기 전에 rdb에 있다
+  if (!missed_ids.empty())
+    persistence_stage->visitPendingBlocks(take_certs);
+
+  if (!missed_ids.empty()) {
+    map<base58_type, string> rdb_certs = rdb_controller->getUserCerts(vector<base58_type>(missed_ids.begin(), missed_ids.end()));
+    user_certs.insert(rdb_certs.begin(), rdb_certs.end());
+  }
+  return user_certs;
+}
+
+nlohmann::json Chain::getRdbCacheStats() {
+  return rdb_controller->getCacheStats();
+}
+
+nlohmann::json Chain::getOrphanStats() {
+  return unresolved_block_pool->getOrphanStats();
+}
+
 bool Chain::applyBlockToRDB(const tethys::Block &block_info) {
   return rdb_controller->applyBlockToRDB(block_info);
 }
@@ -682,6 +754,27 @@ bool Chain::applyContractToRDB(const std::map<base58_type, contract_type> &contr
   return rdb_controller->applyContractToRDB(contract_list);
 }
 
+bool Chain::commitResolvedBlock(const UnresolvedBlock &resolved_block) {
+  return rdb_controller->commitResolvedBlock(resolved_block);
+}
+
+bool Chain::enqueueResolvedBlock(const UnresolvedBlock &resolved_block) {
+  return persistence_stage->push(resolved_block);
+}
+
+block_height_type Chain::getDurableHeight() {
+  return persistence_stage->getDurableHeight();
+}
+
+bool Chain::hasPersistenceFailed() {
+  return persistence_stage->hasFailed();
+}
+
+void Chain::stopPersistence() {
+  if (persistence_stage != nullptr)
+    persistence_stage->stop();
+}
+
 vector<Block> Chain::getBlocksByHeight(int from, int to) {
   if (from > to) {
     return vector<Block>();
@@ -1206,44 +1299,48 @@ string Chain::calculatePid(const string &var_name, int var_type, const string &v
 int Chain::getVarType(const string &var_owner, const string &var_name, const block_height_type height, const int vec_idx) {
   int var_type = (int)UniqueCheck::NO_VALUE;
   int pool_deque_idx = height - unresolved_block_pool->getLatestConfirmedHeight() - 1;
-  int pool_vec_idx = vec_idx;
-
-  if (isUserId(var_owner)) {
-    map<string, user_ledger_type> current_user_ledgers;
-
-    // unresolved block pool의 연결된 앞 블록들에서 검색
-    while (pool_deque_idx >= 0) {
-      current_user_ledgers = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).user_ledger_list;
-      for (auto &each_ledger : current_user_ledgers) {
-        if ((each_ledger.second.uid == var_owner) && (each_ledger.second.var_name == var_name) && (each_ledger.second.tag.empty())) {
-          if ((var_type != (int)UniqueCheck::NO_VALUE) && (var_type != each_ledger.second.var_type)) {
-            return (int)UniqueCheck::NOT_UNIQUE; // var_type가 초기값이 아닌데 새로운 값이 오면 unique하지 않다는 것
-          }
-          var_type = each_ledger.second.var_type;
+  bool not_unique = false;
+
+  auto check_user_ledgers = [&](const UnresolvedBlock &each_block) {
+    for (auto &each_ledger : each_block.user_ledger_list) {
+      if ((each_ledger.second.uid == var_owner) && (each_ledger.second.var_name == var_name) && (each_ledger.second.tag.empty())) {
+        if ((var_type != (int)UniqueCheck::NO_VALUE) && (var_type != each_ledger.second.var_type)) {
+          not_unique = true; // var_type가 초기값이 아닌데 새로운 값이 오면 unique하지 않다는 것
+          return false;
         }
+        var_type = each_ledger.second.var_type;
       }
-      pool_vec_idx = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).prev_vec_idx;
-      --pool_deque_idx;
     }
-  } else if (isContractId(var_owner)) {
-    map<string, contract_ledger_type> current_contract_ledgers;
-
-    // unresolved block pool의 연결된 앞 블록들에서 검색
-    while (pool_deque_idx >= 0) {
-      current_contract_ledgers = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).contract_ledger_list;
-      for (auto &each_ledger : current_contract_ledgers) { // TODO: var_info가 empty인걸 찾는게 맞는지 확인
-        if ((each_ledger.second.cid == var_owner) && (each_ledger.second.var_name == var_name) && (each_ledger.second.var_info.empty())) {
-          if ((var_type != (int)UniqueCheck::NO_VALUE) && (var_type != each_ledger.second.var_type)) {
-            return (int)UniqueCheck::NOT_UNIQUE; // var_type가 초기값이 아닌데 새로운 값이 오면 unique하지 않다는 것
-          }
-          var_type = each_ledger.second.var_type;
+    return true;
+  };
+
+  auto check_contract_ledgers = [&](const UnresolvedBlock &each_block) {
+    for (auto &each_ledger : each_block.contract_ledger_list) { // TODO: var_info가 empty인걸 찾는게 맞는지 확인
+      if ((each_ledger.second.cid == var_owner) && (each_ledger.second.var_name == var_name) && (each_ledger.second.var_info.empty())) {
+        if ((var_type != (int)UniqueCheck::NO_VALUE) && (var_type != each_ledger.second.var_type)) {
+          not_unique = true; // var_type가 초기값이 아닌데 새로운 값이 오면 unique하지 않다는 것
+          return false;
         }
+        var_type = each_ledger.second.var_type;
       }
-      pool_vec_idx = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).prev_vec_idx;
-      --pool_deque_idx;
     }
+    return true;
+  };
+
+  // unresolved block pool의 연결된 앞 블록들과, 확정되었지만 아직 rdb에 commit되지 않은 블록들에서 검색
+  if (isUserId(var_owner)) {
+    unresolved_block_pool->traverseFromPoint(pool_deque_idx, vec_idx, check_user_ledgers);
+    if (!not_unique)
+      persistence_stage->visitPendingBlocks(check_user_ledgers);
+  } else if (isContractId(var_owner)) {
+    unresolved_block_pool->traverseFromPoint(pool_deque_idx, vec_idx, check_contract_ledgers);
+    if (!not_unique)
+      persistence_stage->visitPendingBlocks(check_contract_ledgers);
   }
 
+  if (not_unique)
+    return (int)UniqueCheck::NOT_UNIQUE;
+
   // rdb에서 검색
   int rdb_var_type = rdb_controller->getVarTypeFromRDB(var_owner, var_name);
 
@@ -1274,12 +1371,19 @@ bool Chain::checkUniqueVarName(const string &var_owner, const string &var_name,
 block_push_result_type Chain::pushBlock(Block &new_block) {
   block_push_result_type ret_val = unresolved_block_pool->pushBlock(new_block);
 
-  if (m_longest_chain_info.block_height < ret_val.block_height) {
+  // orphan 블록은 부모가 들어와 pool에 연결될 때 longest chain의 후보가 된다
+  if (ret_val.linked && m_longest_chain_info.block_height < ret_val.block_height) {
     m_longest_chain_info.block_id = ret_val.block_id;
     m_longest_chain_info.block_height = ret_val.block_height;
     m_longest_chain_info.deq_idx = ret_val.deq_idx;
     m_longest_chain_info.vec_idx = ret_val.vec_idx;
   }
+  for (auto &each_linked_info : ret_val.linked_orphans) {
+    if (m_longest_chain_info.block_height < each_linked_info.block_height)
+      m_longest_chain_info = each_linked_info;
+  }
+
+  kv_controller->delBackups(ret_val.evicted_orphan_ids);
   return ret_val;
 }
 
@@ -1287,19 +1391,73 @@ UnresolvedBlock Chain::getUnresolvedBlock(const base58_type &block_id, const blo
   return unresolved_block_pool->getUnresolvedBlock(block_id, block_height);
 }
 
-void Chain::setUnresolvedBlock(const UnresolvedBlock &unresolved_block) {
-  unresolved_block_pool->setUnresolvedBlock(unresolved_block);
+bool Chain::setUnresolvedBlock(const UnresolvedBlock &unresolved_block) {
+  return unresolved_block_pool->setUnresolvedBlock(unresolved_block);
 }
 
 bool Chain::resolveBlock(Block &new_block, UnresolvedBlock &resolved_result) {
   vector<base58_type> dropped_block_ids;
-  if (!unresolved_block_pool->resolveBlock(new_block, resolved_result, dropped_block_ids))
+  base58_type prev_confirmed_id = unresolved_block_pool->getLatestConfirmedId();
+  block_height_type prev_confirmed_height = unresolved_block_pool->getLatestConfirmedHeight();
+  // rdb에 commit이 끝난 블록의 backup은 이제 지워도 된다. kv_controller는 이 thread에서만 다룬다
+  vector<base58_type> released_block_ids = persistence_stage->takeDurableBlockIds();
+
+  // persistence stage가 받을 수 없으면 확정을 미룬다. 블록은 pool에 남아 commit이 따라잡은 뒤에 확정된다
+  if (!persistence_stage->canPush()) {
+    logger::ERROR("Persistence stage cannot take a block (pending {}). Resolving is deferred", persistence_stage->getPendingSize());
+    kv_controller->delBackups(released_block_ids);
     return false;
+  }
 
+  if (!unresolved_block_pool->resolveBlock(new_block, resolved_result, dropped_block_ids)) {
+    kv_controller->delBackups(released_block_ids);
+    return false;
+  }
+
+  // 확정된 블록의 backup은 commit이 끝날 때까지 남겨둔다. 선택받지 못한 블록과 그 후손의 backup은 함께 지운다
   for (auto &each_block_id : dropped_block_ids) {
-    kv_controller->delBackup(each_block_id);
+    if (each_block_id != resolved_result.block.getBlockId())
+      released_block_ids.push_back(each_block_id);
+  }
+  kv_controller->delBackups(released_block_ids);
+
+  // 재시작 시 state tree를 다시 만들 수 있도록 확정된 블록에서 바뀐 ledger를 남긴다
+  state_checkpoint->saveDiff(resolved_result);
+
+  // 이전 기준 version이 rdb commit까지 끝났고 snapshot 간격이 지났다면, 회수하기 전에 snapshot 기록을 시작한다.
+  // 기록은 snapshot thread에서 하며, 그동안 version은 state_checkpoint가 따로 잡아둔다
+  if (prev_confirmed_height >= state_checkpoint->getSnapshotHeight() + config::STATE_CHECKPOINT_INTERVAL &&
+      getDurableHeight() >= prev_confirmed_height && !state_checkpoint->isSaving()) {
+    state_checkpoint->startSnapshot(m_us_tree, m_cs_tree, m_state_tree_mutex, prev_confirmed_id, prev_confirmed_height);
   }
 
+  // 확정된 블록의 state tree version이 새 기준이 된다. 이전 기준과 선택받지 못한 블록들의 version은 회수
+  {
+    std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+    m_confirmed_state_id = resolved_result.block.getBlockId();
+  }
+  releaseStateVersion(prev_confirmed_id);
+  for (auto &each_block_id : dropped_block_ids) {
+    if (each_block_id != resolved_result.block.getBlockId())
+      releaseStateVersion(each_block_id);
+  }
+
+  // pool에 남은 블록들의 위치가 바뀌었으므로 block id로 다시 찾는다.
+  // head가 확정되었거나 지워진 branch에 있었다면, 확정된 블록의 state에서 다시 시작한다
+  if (!m_head_info.block_id.empty() &&
+      !unresolved_block_pool->getBlockPoolInfo(m_head_info.block_id, m_head_info.block_height, m_head_info)) {
+    {
+      std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+      if (m_us_tree.hasVersion(m_confirmed_state_id) && m_cs_tree.hasVersion(m_confirmed_state_id)) {
+        m_us_tree.checkoutVersion(m_confirmed_state_id);
+        m_cs_tree.checkoutVersion(m_confirmed_state_id);
+      }
+    }
+    m_head_info = block_pool_info_type();
+  }
+  if (!unresolved_block_pool->getBlockPoolInfo(m_longest_chain_info.block_id, m_longest_chain_info.block_height, m_longest_chain_info))
+    m_longest_chain_info = unresolved_block_pool->getDeepestBlockInfo();
+
   return true;
 }
 
@@ -1311,61 +1469,41 @@ void Chain::setPool(const base64_type &last_block_id, block_height_type last_hei
 search_result_type Chain::findUserLedgerFromPoint(const string &pid, block_height_type height, int vec_idx) {
   search_result_type search_result;
   int pool_deque_idx = height - unresolved_block_pool->getLatestConfirmedHeight() - 1;
-  int pool_vec_idx = vec_idx;
 
-  map<string, user_ledger_type> current_user_ledgers;
-  map<string, user_ledger_type>::iterator it;
+  // 각 블록의 index는 부모 블록들의 ledger를 모두 포함하므로, 한 번의 검색으로 pool 전체를 확인한다
+  if (unresolved_block_pool->findUserLedger(pool_deque_idx, vec_idx, pid, search_result.user_ledger))
+    return search_result;
 
-  while (1) {
-    current_user_ledgers = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).user_ledger_list;
+  // 확정되었지만 아직 rdb에 commit되지 않은 블록
+  if (persistence_stage->findUserLedger(pid, search_result.user_ledger))
+    return search_result;
 
-    it = current_user_ledgers.find(pid);
-    if (it != current_user_ledgers.end()) {
-      search_result.user_ledger = it->second;
-      return search_result;
-    }
-    pool_vec_idx = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).prev_vec_idx;
-    --pool_deque_idx;
-
-    if (pool_deque_idx < 0) {
-      // -1이 되면 rdb에서 찾을 차례. select문으로 조회하는데도 찾지 못한다면 존재하지 않는 데이터
-      search_result.user_ledger = rdb_controller->findUserScopeFromRDB(pid);
-      if (search_result.user_ledger.is_empty) {
-        search_result.not_found = true;
-      }
-      return search_result;
-    }
+  // pool에서 찾지 못하면 rdb에서 찾을 차례. select문으로 조회하는데도 찾지 못한다면 존재하지 않는 데이터
+  search_result.user_ledger = rdb_controller->findUserScopeFromRDB(pid);
+  if (search_result.user_ledger.is_empty) {
+    search_result.not_found = true;
   }
+  return search_result;
 }
 
 search_result_type Chain::findContractLedgerFromPoint(const string &pid, block_height_type height, int vec_idx) {
   search_result_type search_result;
   int pool_deque_idx = height - unresolved_block_pool->getLatestConfirmedHeight() - 1;
-  int pool_vec_idx = vec_idx;
 
-  map<string, contract_ledger_type> current_contract_ledgers;
-  map<string, contract_ledger_type>::iterator it;
+  // 각 블록의 index는 부모 블록들의 ledger를 모두 포함하므로, 한 번의 검색으로 pool 전체를 확인한다
+  if (unresolved_block_pool->findContractLedger(pool_deque_idx, vec_idx, pid, search_result.contract_ledger))
+    return search_result;
 
-  while (1) {
-    current_contract_ledgers = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).contract_ledger_list;
+  // 확정되었지만 아직 rdb에 commit되지 않은 블록
+  if (persistence_stage->findContractLedger(pid, search_result.contract_ledger))
+    return search_result;
 
-    it = current_contract_ledgers.find(pid);
-    if (it != current_contract_ledgers.end()) {
-      search_result.contract_ledger = it->second;
-      return search_result;
-    }
-    pool_vec_idx = unresolved_block_pool->getUnresolvedBlock(pool_deque_idx, pool_vec_idx).prev_vec_idx;
-    --pool_deque_idx;
-
-    if (pool_deque_idx < 0) {
-      // -1이 되면 rdb에서 찾을 차례. select문으로 조회하는데도 찾지 못한다면 존재하지 않는 데이터
-      search_result.contract_ledger = rdb_controller->findContractScopeFromRDB(pid);
-      if (search_result.contract_ledger.is_empty) {
-        search_result.not_found = true;
-      }
-      return search_result;
-    }
+  // pool에서 찾지 못하면 rdb에서 찾을 차례. select문으로 조회하는데도 찾지 못한다면 존재하지 않는 데이터
+  search_result.contract_ledger = rdb_controller->findContractScopeFromRDB(pid);
+  if (search_result.contract_ledger.is_empty) {
+    search_result.not_found = true;
   }
+  return search_result;
 }
 
 vector<Block> Chain::getBlocksFromUnresolvedLongestChain() {
@@ -1378,9 +1516,9 @@ vector<Block> Chain::getBlocksFromUnresolvedLongestChain() {
   for (int i = 0; i < chain_path.size(); i++) {
     int deq_idx = i;
     int vec_idx = chain_path[i];
-    auto unresolved_block = unresolved_block_pool->getUnresolvedBlock(deq_idx, vec_idx);
-
-    blocks.push_back(unresolved_block.block);
+    unresolved_block_pool->visitUnresolvedBlock(deq_idx, vec_idx, [&blocks](const UnresolvedBlock &each_block) {
+      blocks.push_back(each_block.block);
+    });
   }
 
   return blocks;
@@ -1411,28 +1549,135 @@ bool Chain::isContractId(const string &id) {
 
 // State Tree
 void Chain::setupStateTree() {
-  m_us_tree.updateUserState(rdb_controller->getAllUserLedger());
-  m_cs_tree.updateContractState(rdb_controller->getAllContractLedger());
+  auto start_time = std::chrono::steady_clock::now();
+  block_height_type resolved_height = getLatestResolvedHeight();
+
+  if (loadStateCheckpoint(resolved_height)) {
+    std::chrono::duration<double, std::milli> elapsed_ms = std::chrono::steady_clock::now() - start_time;
+    logger::INFO("State tree is loaded from checkpoint at height {} ({} ms)", resolved_height, elapsed_ms.count());
+    return;
+  }
+
+  // checkpoint가 없거나 쓸 수 없으면 rdb 전체를 읽어 다시 만든다
+  vector<user_ledger_type> user_ledgers = rdb_controller->getAllUserLedger();
+  vector<contract_ledger_type> contract_ledgers = rdb_controller->getAllContractLedger();
+  base58_type confirmed_id = unresolved_block_pool->getLatestConfirmedId();
+  {
+    std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+    m_us_tree = StateTree(config::STATE_TREE_HASH_VERSION);
+    m_cs_tree = StateTree(config::STATE_TREE_HASH_VERSION);
+    m_us_tree.setWorkerPool(worker_pool.get());
+    m_cs_tree.setWorkerPool(worker_pool.get());
+
+    worker_pool->parallelFor(2, [&](size_t tree_idx) {
+      if (tree_idx == 0)
+        m_us_tree.updateUserState(user_ledgers);
+      else
+        m_cs_tree.updateContractState(contract_ledgers);
+    });
+
+    m_us_tree.commitVersion(confirmed_id);
+    m_cs_tree.commitVersion(confirmed_id);
+    m_confirmed_state_id = confirmed_id;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed_ms = std::chrono::steady_clock::now() - start_time;
+  logger::INFO("State tree is rebuilt from rdb at height {} ({} ms)", resolved_height, elapsed_ms.count());
+
+  // 이후 diff는 이 snapshot 위에 쌓인다. 기록이 끝나기 전에 멈추면 다음 시작 때 다시 rdb에서 만든다
+  state_checkpoint->startSnapshot(m_us_tree, m_cs_tree, m_state_tree_mutex, confirmed_id, resolved_height);
+}
+
+// snapshot을 올리고 rdb에 commit된 height까지의 diff를 다시 반영한다. 실패하면 false
+bool Chain::loadStateCheckpoint(block_height_type resolved_height) {
+  if (!state_checkpoint->hasSnapshot())
+    return false;
+
+  // 확정되었지만 rdb에 commit되지 못한 블록은 backup에서 다시 처리되므로, 그보다 앞선 snapshot만 쓸 수 있다
+  if (state_checkpoint->getSnapshotHeight() > resolved_height) {
+    logger::ERROR("State snapshot (height {}) is ahead of rdb (height {})", state_checkpoint->getSnapshotHeight(), resolved_height);
+    return false;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+  base58_type snapshot_block_id;
+  block_height_type snapshot_height;
+  if (!state_checkpoint->loadSnapshot(m_us_tree, m_cs_tree, *worker_pool, snapshot_block_id, snapshot_height))
+    return false;
+
+  for (block_height_type diff_height = snapshot_height + 1; diff_height <= resolved_height; ++diff_height) {
+    vector<user_ledger_type> user_ledgers;
+    vector<contract_ledger_type> contract_ledgers;
+    if (!state_checkpoint->loadDiff(diff_height, user_ledgers, contract_ledgers)) {
+      logger::ERROR("State diff of height {} is missing", diff_height);
+      return false;
+    }
+
+    worker_pool->parallelFor(2, [&](size_t tree_idx) {
+      if (tree_idx == 0)
+        m_us_tree.updateUserState(user_ledgers);
+      else
+        m_cs_tree.updateContractState(contract_ledgers);
+    });
+  }
+
+  m_confirmed_state_id = unresolved_block_pool->getLatestConfirmedId();
+  m_us_tree.commitVersion(m_confirmed_state_id);
+  m_cs_tree.commitVersion(m_confirmed_state_id);
+  return true;
 }
 
 void Chain::updateStateTree(const UnresolvedBlock &unresolved_block) {
   // TODO: 현재의 state tree 관리 방식은 한 블록의 처리를 모두 끝낸 후 최종 결과를 한꺼번에 반영하는 방식.
   //  쿼리 하나를 처리할때마다 state tree를 갱신하는 방식으로 할 수도 있음. 어느쪽이 더 적절한지 검토.
-  m_us_tree.updateUserState(unresolved_block.user_ledger_list);
-  m_cs_tree.updateContractState(unresolved_block.contract_ledger_list);
+  // user / contract tree는 서로 독립이므로 동시에 계산한다
+  {
+    std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+    worker_pool->parallelFor(2, [&](size_t tree_idx) {
+      if (tree_idx == 0)
+        m_us_tree.updateUserState(unresolved_block.user_ledger_list);
+      else
+        m_cs_tree.updateContractState(unresolved_block.contract_ledger_list);
+    });
+  }
+
+  // 이 블록까지 반영된 tree를 저장해 두고, head를 옮길 때 다시 계산하지 않고 전환한다
+  commitStateVersion(unresolved_block.block.getBlockId());
+}
+
+void Chain::commitStateVersion(const base58_type &block_id) {
+  std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+  m_us_tree.commitVersion(block_id);
+  m_cs_tree.commitVersion(block_id);
+}
+
+void Chain::releaseStateVersion(const base58_type &block_id) {
+  std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+  m_us_tree.releaseVersion(block_id);
+  m_cs_tree.releaseVersion(block_id);
 }
 
 void Chain::revertStateTree(const UnresolvedBlock &unresolved_block) {
+  vector<user_ledger_type> user_ledgers;
   for (auto &each_user_ledger : unresolved_block.user_ledger_list) {
-    m_us_tree.insertNode(
+    user_ledgers.emplace_back(
         findUserLedgerFromPoint(each_user_ledger.first, unresolved_block.block.getHeight(), unresolved_block.cur_vec_idx).user_ledger);
   }
 
+  vector<contract_ledger_type> contract_ledgers;
   for (auto &each_contract_ledger : unresolved_block.contract_ledger_list) {
-    m_us_tree.insertNode(
+    contract_ledgers.emplace_back(
         findContractLedgerFromPoint(each_contract_ledger.first, unresolved_block.block.getHeight(), unresolved_block.cur_vec_idx)
             .contract_ledger);
   }
+
+  std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+  worker_pool->parallelFor(2, [&](size_t tree_idx) {
+    if (tree_idx == 0)
+      m_us_tree.updateUserState(user_ledgers);
+    else
+      m_cs_tree.updateContractState(contract_ledgers);
+  });
 }
 
 user_ledger_type Chain::findUserLedgerFromHead(UnresolvedBlock &UR_block, const string &pid) {
@@ -1440,12 +1685,11 @@ user_ledger_type Chain::findUserLedgerFromHead(UnresolvedBlock &UR_block, const
   return_ledger = UR_block.user_ledger_list[pid];
 
   if (return_ledger.is_empty) {
-    shared_ptr<StateNode> node = m_us_tree.getMerkleNode(pid);
-    if (node == nullptr)
-      return return_ledger;
-    else
-      return node->getUserLedger();
+    optional<user_ledger_type> found_ledger = m_us_tree.getUserLedger(pid);
+    if (found_ledger.has_value())
+      return found_ledger.value();
   }
+  return return_ledger;
 }
 
 contract_ledger_type Chain::findContractLedgerFromHead(UnresolvedBlock &UR_block, const string &pid) {
@@ -1453,12 +1697,11 @@ contract_ledger_type Chain::findContractLedgerFromHead(UnresolvedBlock &UR_block
   return_ledger = UR_block.contract_ledger_list[pid];
 
   if (return_ledger.is_empty) {
-    shared_ptr<StateNode> node = m_cs_tree.getMerkleNode(pid);
-    if (node == nullptr)
-      return return_ledger;
-    else
-      return node->getContractLedger();
+    optional<contract_ledger_type> found_ledger = m_cs_tree.getContractLedger(pid);
+    if (found_ledger.has_value())
+      return found_ledger.value();
   }
+  return return_ledger;
 }
 
 void Chain::moveHead(const base58_type &target_block_id, const block_height_type target_block_height) {
@@ -1469,7 +1712,7 @@ void Chain::moveHead(const base58_type &target_block_id, const block_height_type
     int current_height = static_cast<int>(m_head_info.block_height);
 
     while (current_height > target_block_height) {
-      current_vec_idx = unresolved_block_pool->getUnresolvedBlock(current_deq_idx, current_vec_idx).prev_vec_idx;
+      current_vec_idx = unresolved_block_pool->getPrevVecIdx(current_deq_idx, current_vec_idx);
       --current_deq_idx;
       --current_height;
     }
@@ -1478,7 +1721,7 @@ void Chain::moveHead(const base58_type &target_block_id, const block_height_type
 
     if (!target_path.empty()) {
       while (current_vec_idx != target_path[current_deq_idx]) {
-        current_vec_idx = unresolved_block_pool->getUnresolvedBlock(current_deq_idx, current_vec_idx).prev_vec_idx;
+        current_vec_idx = unresolved_block_pool->getPrevVecIdx(current_deq_idx, current_vec_idx);
         --current_deq_idx;
         --current_height;
 
@@ -1503,28 +1746,45 @@ void Chain::moveHead(const base58_type &target_block_id, const block_height_type
     current_deq_idx = m_head_info.deq_idx;
     current_vec_idx = m_head_info.vec_idx;
 
+    // target 블록의 state tree version이 있으면 revert / update 없이 root만 바꾼다
+    bool switch_by_version = m_us_tree.hasVersion(target_block_id) && m_cs_tree.hasVersion(target_block_id);
+
     for (int i = 0; i < back_count; ++i) {
-      revertStateTree(unresolved_block_pool->getUnresolvedBlock(current_deq_idx, current_vec_idx));
+      if (!switch_by_version)
+        unresolved_block_pool->visitUnresolvedBlock(current_deq_idx, current_vec_idx,
+                                                    [this](const UnresolvedBlock &each_block) { revertStateTree(each_block); });
       // TODO: ledger 이외의 것들도 revert
-      current_vec_idx = unresolved_block_pool->getUnresolvedBlock(current_deq_idx, current_vec_idx).prev_vec_idx;
+      current_vec_idx = unresolved_block_pool->getPrevVecIdx(current_deq_idx, current_vec_idx);
       --current_deq_idx;
       --current_height;
     }
 
     for (int i = 0; i < front_count; ++i) {
-      updateStateTree(unresolved_block_pool->getUnresolvedBlock(current_deq_idx, current_vec_idx));
+      if (!switch_by_version)
+        unresolved_block_pool->visitUnresolvedBlock(current_deq_idx, current_vec_idx,
+                                                    [this](const UnresolvedBlock &each_block) { updateStateTree(each_block); });
       // TODO: ledger 이외의 것들도 update
       ++current_deq_idx;
       current_vec_idx = target_path[current_deq_idx];
       ++current_height;
     }
 
+    if (switch_by_version) {
+      std::unique_lock<std::shared_mutex> lock(m_state_tree_mutex);
+      m_us_tree.checkoutVersion(target_block_id);
+      m_cs_tree.checkoutVersion(target_block_id);
+    }
+
     m_head_info.deq_idx = current_deq_idx;
     m_head_info.vec_idx = current_vec_idx;
     m_head_info.block_height = current_height;
-    m_head_info.block_id = unresolved_block_pool->getUnresolvedBlock(m_head_info.deq_idx, m_head_info.vec_idx).block.getBlockId();
+    block_height_type head_block_height = 0;
+    unresolved_block_pool->visitUnresolvedBlock(m_head_info.deq_idx, m_head_info.vec_idx, [&](const UnresolvedBlock &head_block) {
+      m_head_info.block_id = head_block.block.getBlockId();
+      head_block_height = head_block.block.getHeight();
+    });
 
-    if (unresolved_block_pool->getUnresolvedBlock(m_head_info.deq_idx, m_head_info.vec_idx).block.getHeight() != m_head_info.block_height) {
+    if (head_block_height != m_head_info.block_height) {
       logger::ERROR("URBP, Something error in move_head() - end part, check height");
       return;
     }
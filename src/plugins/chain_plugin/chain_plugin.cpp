@@ -1,5 +1,6 @@
 #include "include/chain_plugin.hpp"
 #include "../../contract/include/engine.hpp"
+#include "include/ledger_cache.hpp"
 #include "include/transacton_pool.hpp"
 #include <boost/asio/steady_timer.hpp>
 
@@ -22,26 +23,34 @@ public:
   }
 };
 
+// txid -> 검증을 통과한 transaction의 서명 대상 내용 digest
+using verified_tx_cache_type = ShardedLruCache<base58_type, hash_t>;
+
 class TransactionMessageVerifier {
 public:
-  bool operator()(const Transaction &transaction) {
-    if (!verifyID(transaction))
-      return false;
+  // verified_tx_cache를 주면 같은 내용으로 이미 검증된 transaction은 서명 검증을 건너뛰고, 새로 검증한 것은 cache에 넣는다
+  explicit TransactionMessageVerifier(verified_tx_cache_type *verified_tx_cache = nullptr) : m_verified_tx_cache(verified_tx_cache) {}
 
-    if (!verifyEndorserSig(transaction))
-      return false;
+  bool operator()(const Transaction &transaction) {
+    return (*this)(transaction, transaction.getWorld(), transaction.getChain());
+  }
 
-    if (!verifyUserSig(transaction))
-      return false;
+  // block에 담긴 transaction은 world / chain을 block의 것으로 보고 검증한다. transaction은 바꾸지 않는다
+  bool operator()(const Transaction &transaction, const string &world, const string &chain) {
+    hash_t tx_id = makeTxId(transaction, world, chain);
 
-    return true;
-  }
+    hash_t signed_digest;
+    if (m_verified_tx_cache != nullptr) {
+      signed_digest = makeSignedDigest(transaction, tx_id);
 
-  bool operator()(Transaction &transaction, const string &world, const string &chain) {
-    transaction.setWorld(world);
-    transaction.setChain(chain);
+      hash_t verified_digest;
+      if (m_verified_tx_cache->get(transaction.getTxId(), verified_digest) && verified_digest == signed_digest) {
+        ++m_cache_hit_num;
+        return true;
+      }
+    }
 
-    if (!verifyID(transaction))
+    if (transaction.getTxId() != TypeConverter::encodeBase<58>(tx_id))
       return false;
 
     if (!verifyEndorserSig(transaction))
@@ -50,15 +59,25 @@ public:
     if (!verifyUserSig(transaction))
       return false;
 
+    if (m_verified_tx_cache != nullptr)
+      m_verified_tx_cache->put(transaction.getTxId(), signed_digest);
+
     return true;
   }
 
+  size_t getCacheHitNum() const {
+    return m_cache_hit_num;
+  }
+
 private:
-  bool verifyID(const Transaction &transaction) const {
+  verified_tx_cache_type *m_verified_tx_cache;
+  size_t m_cache_hit_num{0};
+
+  hash_t makeTxId(const Transaction &transaction, const string &world, const string &chain) const {
     BytesBuilder tx_id_builder;
     tx_id_builder.appendBase<58>(transaction.getUserId());
-    tx_id_builder.append(transaction.getWorld());
-    tx_id_builder.append(transaction.getChain());
+    tx_id_builder.append(world);
+    tx_id_builder.append(chain);
     tx_id_builder.appendDec(transaction.getTxTime());
 
     auto receiver_id = transaction.getReceiverId();
@@ -68,12 +87,22 @@ private:
     tx_id_builder.append(transaction.getContractId());
     tx_id_builder.append(transaction.getTxInputCbor());
 
-    vector<uint8_t> tx_id = Sha256::hash(tx_id_builder.getBytes());
-    if (transaction.getTxId() != TypeConverter::encodeBase<58>(tx_id)) {
-      return false;
+    return Sha256::hash(tx_id_builder.getBytes());
+  }
+
+  // 서명 검증에 쓰이는 모든 값의 digest. 필드 경계가 섞이지 않도록 필드마다 hash한 값을 이어서 다시 hash 한다
+  hash_t makeSignedDigest(const Transaction &transaction, const hash_t &tx_id) const {
+    BytesBuilder digest_builder;
+    digest_builder.append(tx_id);
+    for (auto &each_endorser : transaction.getEndorsers()) {
+      digest_builder.append(Sha256::hash(each_endorser.endorser_id));
+      digest_builder.append(Sha256::hash(each_endorser.endorser_pk));
+      digest_builder.append(Sha256::hash(each_endorser.endorser_sig));
     }
+    digest_builder.append(Sha256::hash(transaction.getTxUserPk()));
+    digest_builder.append(Sha256::hash(transaction.getUserSig()));
 
-    return true;
+    return Sha256::hash(digest_builder.getBytes());
   }
 
   bool verifyEndorserSig(const Transaction &transaction) const {
@@ -108,6 +137,11 @@ public:
   unique_ptr<tsce::ContractEngine> contract_engine;
 
   unique_ptr<boost::asio::steady_timer> block_check_timer;
+  unique_ptr<WorkerPool> verify_pool;
+  unique_ptr<SSigBatchVerifier> ssig_verifier;
+  unique_ptr<verified_tx_cache_type> verified_tx_cache;
+  uint64_t block_tx_num{0};
+  uint64_t cached_block_tx_num{0};
 
   string dbms;
   string table_name;
@@ -128,6 +162,9 @@ public:
     chain = make_unique<Chain>(dbms, table_name, db_user_id, db_password);
     transaction_pool = make_unique<TransactionPool>();
     contract_engine = make_unique<tsce::ContractEngine>();
+    verify_pool = make_unique<WorkerPool>(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    ssig_verifier = make_unique<SSigBatchVerifier>(*verify_pool);
+    verified_tx_cache = make_unique<verified_tx_cache_type>(VERIFIED_TX_CACHE_SIZE, VERIFIED_TX_CACHE_SHARD_NUM);
 
     contract_engine->attachReadInterface([this](const nlohmann::json &req_query) { return processRequestQuery(req_query); });
     block_check_timer = make_unique<boost::asio::steady_timer>(app().getIoContext());
@@ -164,7 +201,7 @@ public:
     if (!transaction.has_value())
       return;
 
-    TransactionMessageVerifier verfier;
+    TransactionMessageVerifier verfier(verified_tx_cache.get());
     auto valid = verfier(transaction.value());
 
     if (valid) {
@@ -194,26 +231,46 @@ public:
       logger::ERROR("Block input fail: duplicated");
       return;
     }
+    if (!push_result.linked) {
+      logger::INFO("Block is waiting for its parent: " + push_result.block_id);
+    }
+    // 블록 backup, 백업 목록, resolve로 지워지는 backup을 한 번의 sync write로 기록한다
+    chain->beginGroupCommit();
     chain->saveBackupBlock(block_json);
     chain->saveBlockIds();
 
     UnresolvedBlock resolved_block;
     bool resolve_result = chain->resolveBlock(input_block, resolved_block);
     if (resolve_result) {
-      chain->applyBlockToRDB(resolved_block.block);
-      chain->applyTransactionToRDB(resolved_block.block);
-      chain->applyUserLedgerToRDB(resolved_block.user_ledger_list);
-      chain->applyContractLedgerToRDB(resolved_block.contract_ledger_list);
-      chain->applyUserAttributeToRDB(resolved_block.user_attribute_list);
-      chain->applyUserCertToRDB(resolved_block.user_cert_list);
-      chain->applyContractToRDB(resolved_block.contract_list);
+      // rdb commit은 persistence stage에서 비동기로 처리. 받지 않으면 백업 목록에 남겨 두어 재시작 시 복구되게 한다
+      if (!chain->enqueueResolvedBlock(resolved_block)) {
+        chain->endGroupCommit();
+        stopOnPersistenceFailure();
+        return;
+      }
+
+      // 확정된 블록에 들어간 tx는 다시 block에 넣지 않도록 pool에서 지운다. 너무 오래 남은 tx도 이때 함께 정리
+      transaction_pool->remove(resolved_block.block.getTransactions());
+      transaction_pool->removeExpired();
 
       chain->saveBlockIds(); // resolve로 인하여 pool에서 삭제된 블록을 백업 목록에서 제거
     }
+    chain->endGroupCommit();
+    stopOnPersistenceFailure();
 
     return;
   }
 
+  // rdb commit을 포기한 persistence stage는 더 이상 블록을 받지 않으므로, 확정하지 못한 블록을 계속 쌓지 않고 node를 멈춘다.
+  // 확정된 블록은 backup에 남아 있어 재시작 시 pool로 복구된다
+  void stopOnPersistenceFailure() {
+    if (!chain->hasPersistenceFailed())
+      return;
+
+    logger::ERROR("RDB commit keeps failing. Stop the merger; resolved blocks are restored from backup on restart");
+    app().quit();
+  }
+
   void processTxResult(const nlohmann::json &result) {
     // TODO: state tree lock 필요. head가 달라지면서 state tree가 반영되면 정확한 값이 아니게 될 수 있다
     base58_type block_id = json::get<string>(result["block"], "id").value();
@@ -281,7 +338,9 @@ public:
         }
       }
     }
-    chain->setUnresolvedBlock(updated_UR_block);
+    // 처리하는 동안 resolve로 pool에서 지워진 블록이면 결과를 반영하거나 backup하지 않는다
+    if (!chain->setUnresolvedBlock(updated_UR_block))
+      return;
     chain->updateStateTree(updated_UR_block);
     chain->saveBackupResult(updated_UR_block);
 
@@ -309,6 +368,10 @@ public:
         return chain->queryUserScopeGet(where_json.value());
       } else if (type == "contract.scope.get") {
         return chain->queryContractScopeGet(where_json.value());
+      } else if (type == "user.scope.proof") {
+        return chain->queryUserScopeProof(where_json.value());
+      } else if (type == "contract.scope.proof") {
+        return chain->queryContractScopeProof(where_json.value());
       } else if (type == "block.get") {
         return chain->queryBlockGet(where_json.value());
       } else if (type == "tx.get") {
@@ -317,6 +380,10 @@ public:
         return chain->queryBlockScan(where_json.value());
       } else if (type == "tx.scan") {
         return chain->queryTxScan(where_json.value());
+      } else if (type == "orphan.stats.get") {
+        return chain->getOrphanStats(); // 부모를 기다리는 블록 수와 연결되기까지 걸린 시간
+      } else if (type == "rdb.cache.stats.get") {
+        return chain->getRdbCacheStats(); // 확정된 scope / var type / cert cache의 크기와 hit, miss 수
       } else {
         logger::ERROR("URBP, Something error in query process");
         return request;
@@ -373,13 +440,8 @@ public:
         UnresolvedBlock resolved_block;
         bool resolve_result = chain->resolveBlock(blocks[i], resolved_block);
         if (resolve_result) {
-          chain->applyBlockToRDB(resolved_block.block);
-          chain->applyTransactionToRDB(resolved_block.block);
-          chain->applyUserLedgerToRDB(resolved_block.user_ledger_list);
-          chain->applyContractLedgerToRDB(resolved_block.contract_ledger_list);
-          chain->applyUserAttributeToRDB(resolved_block.user_attribute_list);
-          chain->applyUserCertToRDB(resolved_block.user_cert_list);
-          chain->applyContractToRDB(resolved_block.contract_list);
+          chain->enqueueResolvedBlock(resolved_block); // rdb commit은 persistence stage에서 비동기로 처리
+          transaction_pool->remove(resolved_block.block.getTransactions());
         }
 
         sleep(1);
@@ -413,30 +475,90 @@ public:
   }
 
   // block verify 코드. chain의 접근권한이 필요함. 정리 필요.
+  // block header를 먼저 검증한 뒤, 두 merkle root와 transaction 검증을 verify_pool에서 함께 돌린다.
+  // 하나라도 실패하면 아직 시작하지 않은 검증은 건너뛴다. 모두 통과하면 SSig를 한꺼번에 검증한다
   bool earlyStage(Block &block) {
-    if (!verifyBlock(block))
+    auto stage_start = std::chrono::steady_clock::now();
+    if (!verifyBlock(block)) {
+      logger::ERROR("Block verify fail: header of {}", block.getBlockId());
       return false;
-
-    const vector<Transaction> &transactions = block.getTransactions();
-    for (auto each_transaction : transactions) {
-      TransactionMessageVerifier tx_verifier;
-      if (!tx_verifier(each_transaction, block.getWorldId(), block.getChainId()))
-        return false;
     }
+    auto header_us = elapsedUs(stage_start);
 
-    return true;
-  }
+    const vector<Transaction> &transactions = block.getTransactions();
+    size_t tx_chunk_num = (transactions.size() + TX_VERIFY_CHUNK_SIZE - 1) / TX_VERIFY_CHUNK_SIZE;
+
+    enum VerifyTask : size_t { TX_ROOT = 0, SG_ROOT = 1, TX_CHUNK_BEGIN = 2 };
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> failed_task{0};
+    std::atomic<int64_t> merkle_us{0};
+    std::atomic<int64_t> tx_us{0};
+    std::atomic<size_t> cache_hit_num{0};
+
+    stage_start = std::chrono::steady_clock::now();
+    verify_pool->parallelFor(TX_CHUNK_BEGIN + tx_chunk_num, [&](size_t task_idx) {
+      if (failed.load(std::memory_order_relaxed))
+        return;
+
+      auto task_start = std::chrono::steady_clock::now();
+      bool result = true;
+      if (task_idx == TX_ROOT) {
+        result = verifyTxRoot(block);
+      } else if (task_idx == SG_ROOT) {
+        result = verifySgRoot(block);
+      } else {
+        TransactionMessageVerifier tx_verifier(verified_tx_cache.get());
+        size_t tx_begin = (task_idx - TX_CHUNK_BEGIN) * TX_VERIFY_CHUNK_SIZE;
+        size_t tx_end = std::min(tx_begin + TX_VERIFY_CHUNK_SIZE, transactions.size());
+        for (size_t i = tx_begin; i < tx_end && result; ++i) {
+          if (failed.load(std::memory_order_relaxed))
+            return;
+          result = tx_verifier(transactions[i], block.getWorldId(), block.getChainId());
+        }
+        cache_hit_num += tx_verifier.getCacheHitNum();
+      }
 
-  bool lateStage(Block &block) {
-    if (!verifyBlockID(block))
+      auto &stage_us = (task_idx < TX_CHUNK_BEGIN) ? merkle_us : tx_us;
+      stage_us += elapsedUs(task_start);
+      if (!result && !failed.exchange(true))
+        failed_task = task_idx;
+    });
+    auto parallel_us = elapsedUs(stage_start);
+
+    if (failed) {
+      size_t task_idx = failed_task;
+      if (task_idx < TX_CHUNK_BEGIN)
+        logger::ERROR("Block verify fail: {} of {}", (task_idx == TX_ROOT) ? "tx root" : "sg root", block.getBlockId());
+      else
+        logger::ERROR("Block verify fail: transaction in [{}, {}) of {}", (task_idx - TX_CHUNK_BEGIN) * TX_VERIFY_CHUNK_SIZE,
+                      std::min((task_idx - TX_CHUNK_BEGIN + 1) * TX_VERIFY_CHUNK_SIZE, transactions.size()), block.getBlockId());
       return false;
+    }
 
-    if (!verifySSigs(block))
+    // SSig 검증은 ssig_verifier가 다시 verify_pool에 나누어 맡기므로 위의 parallelFor 안에서 부르지 않는다
+    stage_start = std::chrono::steady_clock::now();
+    if (!verifySSigs(block)) {
+      logger::ERROR("Block verify fail: SSig of {}", block.getBlockId());
       return false;
+    }
+    auto ssig_us = elapsedUs(stage_start);
+
+    // merkle / tx 시간은 worker들에서 걸린 시간의 합이고, parallel은 둘을 함께 돌린 실제 시간이다
+    logger::INFO("Block verified: {} txs ({} cached), {} SSigs, header {}us, merkle {}us, tx {}us, parallel {}us, ssig {}us",
+                 transactions.size(), cache_hit_num.load(), block.getNumSigners(), header_us, merkle_us.load(), tx_us.load(), parallel_us,
+                 ssig_us);
+
+    // pushTransaction에서의 조회는 항상 처음 보는 transaction이므로 block으로 들어온 transaction만 센다
+    block_tx_num += transactions.size();
+    cached_block_tx_num += cache_hit_num;
+    if (block_tx_num > 0)
+      logger::INFO("Verified tx cache: {} entries, block tx hit rate {:.1f}%", verified_tx_cache->size(),
+                   100.0 * cached_block_tx_num / block_tx_num);
 
     return true;
   }
 
+  // tx root / sg root는 earlyStage에서 transaction 검증과 함께 따로 확인한다
   bool verifyBlock(const Block &block) {
 
     // TODO: SSig의 퀄리티, 수 검증 추가
@@ -445,26 +567,9 @@ public:
     if (!verifyBlockID(block))
       return false;
 
-    vector<hash_t> tx_merkle_tree = makeStaticMerkleTree(block.getTxaggs());
-    if (block.getTxRoot() != TypeConverter::encodeBase<64>(tx_merkle_tree.back())) {
-      return false;
-    }
-
     if (!verifyBlockHash(block))
       return false;
 
-    vector<Signature> signers = block.getSigners();
-    vector<string> signer_id_sigs;
-    signer_id_sigs.clear();
-    for (auto &each_signer : signers) {
-      string id_sig = each_signer.signer_id + each_signer.signer_sig; // need bytebuilder?
-      signer_id_sigs.emplace_back(id_sig);
-    }
-    vector<hash_t> sg_merkle_tree = makeStaticMerkleTree(signer_id_sigs);
-    if (block.getSgRoot() != TypeConverter::encodeBase<64>(sg_merkle_tree.back())) {
-      return false;
-    }
-
     // TODO: us_state_root 검증 추가
     // TODO: cs_state_root 검증 추가
 
@@ -473,6 +578,25 @@ public:
     return true;
   }
 
+  bool verifyTxRoot(const Block &block) {
+    hash_t tx_root = makeStaticMerkleRoot(block.getTxaggs());
+    return block.getTxRoot() == TypeConverter::encodeBase<64>(tx_root);
+  }
+
+  bool verifySgRoot(const Block &block) {
+    vector<string> signer_id_sigs;
+    for (auto &each_signer : block.getSigners()) {
+      string id_sig = each_signer.signer_id + each_signer.signer_sig; // need bytebuilder?
+      signer_id_sigs.emplace_back(id_sig);
+    }
+    hash_t sg_root = makeStaticMerkleRoot(signer_id_sigs);
+    return block.getSgRoot() == TypeConverter::encodeBase<64>(sg_root);
+  }
+
+  static int64_t elapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
   bool verifyBlockID(const Block &block) const {
     BytesBuilder block_id_builder;
     block_id_builder.appendBase<58>(block.getBlockProdId());
@@ -518,9 +642,8 @@ public:
     return ags.verifyPEM(producer_cert, message, block.getBlockProdSig());
   }
 
-  std::vector<hash_t> makeStaticMerkleTree(const std::vector<string> &material) {
+  hash_t makeStaticMerkleRoot(const std::vector<string> &material) {
 
-    std::vector<hash_t> merkle_tree_vector;
     std::vector<hash_t> sha256_material;
 
     // 입력으로 들어오는 material 벡터는 해시만 하면 되도록 처리된 상태로 전달되어야 합니다
@@ -528,11 +651,10 @@ public:
       sha256_material.emplace_back(Sha256::hash(each_element));
     }
 
-    StaticMerkleTree merkle_tree;
-    merkle_tree.generate(sha256_material);
-    merkle_tree_vector = merkle_tree.getStaticMerkleTree();
+    StaticMerkleTree merkle_tree(sha256_material);
+    const auto &merkle_root = merkle_tree.getRoot();
 
-    return merkle_tree_vector;
+    return hash_t(merkle_root.begin(), merkle_root.end());
   }
 
   bytes getUserStateRoot() {
@@ -554,14 +676,26 @@ public:
     string message = TypeConverter::bytesToString(block_info_hash);
     vector<Signature> signers = block.getSigners();
 
-    AGS ags;
+    // signer 인증서는 한꺼번에 가져온다. 부모 블록에서 바라본 인증서이므로 pool이나 commit 전의 블록에서 등록된 signer도 찾는다.
+    // 그 밖의 signer는 rdb에서 찾으며, cache에 모두 있으면 rdb 조회가 없다
+    vector<base58_type> signer_ids;
     for (auto &each_signer : signers) {
-      string signer_cert = chain->getUserCert(each_signer.signer_id);
-      if (!ags.verifyPEM(signer_cert, message, each_signer.signer_sig))
+      signer_ids.emplace_back(each_signer.signer_id);
+    }
+    map<base58_type, string> signer_certs = chain->getUserCertsFromPoint(signer_ids, block.getPrevBlockId(), block.getHeight() - 1);
+
+    // 인증서가 없는 signer는 서명을 검증해 볼 필요 없이 실패로 처리한다
+    vector<pair<string, string>> cert_sigs;
+    for (auto &each_signer : signers) {
+      auto cert_it = signer_certs.find(each_signer.signer_id);
+      if (cert_it == signer_certs.end() || cert_it->second.empty()) {
+        logger::ERROR("SSig verify fail: no certificate for signer {}", each_signer.signer_id);
         return false;
+      }
+      cert_sigs.emplace_back(cert_it->second, each_signer.signer_sig);
     }
 
-    return true;
+    return ssig_verifier->verifyAll(message, cert_sigs);
   }
   // block verify part end
 };
@@ -644,6 +778,18 @@ TransactionPool &ChainPlugin::transactionPool() {
   return *(impl->transaction_pool);
 }
 
+SSigBatchVerifier &ChainPlugin::ssigVerifier() {
+  return *(impl->ssig_verifier);
+}
+
+void ChainPlugin::pluginShutdown() {
+  logger::INFO("ChainPlugin Shutdown");
+
+  // 확정된 블록이 모두 rdb에 기록될 때까지 기다린다
+  if (impl->chain != nullptr)
+    impl->chain->stopPersistence();
+}
+
 void ChainPlugin::pluginStart() {
   logger::INFO("ChainPlugin Start");
 
@@ -29,6 +29,27 @@ namespace config {
         constexpr uint32_t MAX_SIGNATURE_COLLECT_SIZE = 20;
         constexpr uint32_t MAX_UNICAST_MISSING_BLOCK = 4;
         constexpr uint32_t DB_SESSION_POOL_SIZE = 10;
+        constexpr uint32_t RDB_CACHE_SHARD_NUM = 16;
+        constexpr uint32_t RDB_LEDGER_CACHE_SIZE = 65536;
+        constexpr uint32_t RDB_CERT_CACHE_SIZE = 8192;
+        constexpr size_t RDB_MULTI_ROW_CHUNK_SIZE = 512; // multi-row INSERT / UPDATE / DELETE 하나에 담는 row 수
+        constexpr uint32_t PERSISTENCE_QUEUE_SIZE = 32;
+        constexpr uint32_t PERSISTENCE_MAX_RETRY_NUM = 10; // 100ms부터 5s까지 늘려가며 약 30초 동안 다시 시도
+        constexpr StateHashVersion STATE_TREE_HASH_VERSION = StateHashVersion::BASE64_CONCAT; // 기존 체인의 state root 호환
+        constexpr int STATE_TREE_SPLIT_DEPTH = 8;
+        constexpr uint32_t STATE_TREE_PARALLEL_MIN_UPDATES = 512;
+        constexpr uint32_t STATE_CHECKPOINT_INTERVAL = 1000; // resolved height 기준 snapshot 간격
+        constexpr uint32_t STATE_CHECKPOINT_CHUNK_SIZE = 65536; // snapshot의 kv value 하나에 담는 노드 / ledger 수
+        constexpr size_t TX_VERIFY_CHUNK_SIZE = 32; // block 검증 시 worker 하나가 한 번에 가져가는 transaction 수
+        constexpr uint32_t VERIFIED_TX_CACHE_SIZE = 65536; // pool에서 block으로 들어올 때까지 기다리는 transaction 수보다 넉넉하게
+        constexpr uint32_t VERIFIED_TX_CACHE_SHARD_NUM = 16;
+        constexpr size_t SSIG_VERIFY_CHUNK_SIZE = 8; // SSig 검증 시 worker 하나가 한 번에 가져가는 서명 수
+        constexpr uint32_t TX_POOL_SHARD_NUM = 16;
+        constexpr uint32_t TX_POOL_MAX_SIZE = 32768; // VERIFIED_TX_CACHE_SIZE보다 작게 두어 pool의 tx는 block 검증 시 cache에 남아 있게 한다
+        constexpr auto TX_POOL_MAX_AGE = std::chrono::seconds(600); // 이보다 오래 block에 들어가지 못한 tx는 버린다
+        constexpr uint32_t ORPHAN_POOL_MAX_SIZE = 64; // 부모를 기다리는 블록 수. 넘으면 먼저 들어온 블록부터 버린다
+        constexpr uint32_t ORPHAN_POOL_MAX_TX_NUM = 65536; // orphan 블록들이 가진 transaction 수의 합
+        constexpr uint32_t LEDGER_INDEX_COMPACT_INTERVAL = 64; // 확정된 조상의 ledger를 pool의 ledger index에서 걷어내는 간격(확정 블록 수)
         constexpr uint32_t BP_INTERVAL = 10;
         constexpr auto BLOCK_POOL_CHECK_PERIOD = std::chrono::milliseconds(500);
 
@@ -39,7 +60,10 @@ namespace config {
         const std::string GENESIS_BLOCK_PREV_ID_B58 = "11111111111111111111111111111111";
 
         const std::string DEFAULT_KV_PATH = "./leveldb";
+        const std::string KV_DB_NAME = "merger"; // DEFAULT_KV_PATH 아래에 모든 data type을 담는 하나의 DB
+        constexpr size_t KV_BLOCK_CACHE_SIZE = 100 * 1048576;
 
+        // KV_DB_NAME 안에서 key prefix로 쓰이는 data type. 예전에는 각각 DEFAULT_KV_PATH 아래의 별도 DB였다
         static vector<string> keyValueDBNames() {
           vector<string> names;
 
@@ -47,16 +71,18 @@ namespace config {
           names.emplace_back(DataType::WORLD);
           names.emplace_back(DataType::CHAIN);
           names.emplace_back(DataType::BACKUP_BLOCK);
-          names.emplace_back(DataType::BACKUP_USER_LEDGER);
-          names.emplace_back(DataType::BACKUP_CONTRACT_LEDGER);
-          names.emplace_back(DataType::BACKUP_USER_ATTRIBUTE);
-          names.emplace_back(DataType::BACKUP_USER_CERT);
-          names.emplace_back(DataType::BACKUP_CONTRACT);
+          names.emplace_back(DataType::BACKUP_RESULT);
           names.emplace_back(DataType::UNRESOLVED_BLOCK_IDS_KEY);
           names.emplace_back(DataType::SELF_INFO);
+          names.emplace_back(DataType::STATE_CHECKPOINT);
 
           return names;
         }
+
+        // backup_result 하나로 합쳐지며 없어진 DB. 결과 record가 없는 블록은 다시 처리하므로 옮기지 않고 지운다
+        static vector<string> retiredKeyValueDBNames() {
+          return {"backup_user_ledger", "backup_user_attribute", "backup_user_cert", "backup_contract_ledger", "backup_contract"};
+        }
 }
 // clang-format on
 
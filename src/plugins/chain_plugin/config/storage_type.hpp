@@ -13,6 +13,8 @@ using namespace std;
 namespace tethys {
 
 enum class QueryType : int { INSERT = 0, UPDATE = 1, DELETE = 2 };
+// state tree 내부 노드의 hash 방식. BASE64_CONCAT : sha256(b64(L) + b64(R)), BINARY : sha256(L || R) (없는 자식은 32 byte 0)
+enum class StateHashVersion : int { BASE64_CONCAT = 0, BINARY = 1 };
 // enum class WhichType : int {
 //  USERLEDGER,
 //  CONTRACTLEDGER,
@@ -34,13 +36,10 @@ struct DataType {
   inline static const string WORLD = "world";
   inline static const string CHAIN = "chain";
   inline static const string BACKUP_BLOCK = "backup_block";
-  inline static const string BACKUP_USER_LEDGER = "backup_user_ledger";
-  inline static const string BACKUP_CONTRACT_LEDGER = "backup_contract_ledger";
-  inline static const string BACKUP_USER_ATTRIBUTE = "backup_user_attribute";
-  inline static const string BACKUP_USER_CERT = "backup_user_cert";
-  inline static const string BACKUP_CONTRACT = "backup_contract";
+  inline static const string BACKUP_RESULT = "backup_result"; // 블록 처리 결과(ledger 목록 5종)를 한 record로
   inline static const string UNRESOLVED_BLOCK_IDS_KEY = "UNRESOLVED_BLOCK_IDS_KEY";
   inline static const string SELF_INFO = "self_info";
+  inline static const string STATE_CHECKPOINT = "state_checkpoint";
 };
 
 enum class UniqueCheck : int { NO_VALUE = -1, NOT_UNIQUE = -2 };
@@ -115,13 +114,24 @@ using proof_type = struct ProofType {
   std::vector<std::pair<bool, std::string>> siblings;
 };
 
+using block_pool_info_type = struct BlockPoolInfoType {
+  base58_type block_id{};
+  block_height_type block_height{0};
+  int deq_idx{-1};
+  int vec_idx{-1};
+
+  BlockPoolInfoType() = default;
+};
+
 using block_push_result_type = struct BlockPushResultType {
   base58_type block_id;
   block_height_type block_height;
   int deq_idx;
   int vec_idx;
-  bool linked;
+  bool linked; // false이면 부모를 기다리는 orphan 블록
   bool duplicated;
+  std::vector<block_pool_info_type> linked_orphans; // 이 블록이 들어오면서 함께 pool에 연결된 orphan 블록들
+  std::vector<base58_type> evicted_orphan_ids;      // orphan pool의 상한을 넘어 버려진 블록들
 
   BlockPushResultType() = default;
 };
@@ -141,15 +151,6 @@ using block_info_type = struct BlockInfoType {
       : tx_agg_cbor(tx_agg_cbor_), block_id(block_id_), tx_pos(tx_pos_), tx_output(tx_output_) {}
 };
 
-using block_pool_info_type = struct BlockPoolInfoType {
-  base58_type block_id{};
-  block_height_type block_height{0};
-  int deq_idx{-1};
-  int vec_idx{-1};
-
-  BlockPoolInfoType() = default;
-};
-
 using result_query_info_type = struct ResultQueryInfoType {
   base58_type block_id;
   block_height_type block_height;
@@ -0,0 +1,194 @@
+#ifndef TETHYS_PUBLIC_MERGER_BINARY_CODEC_HPP
+#define TETHYS_PUBLIC_MERGER_BINARY_CODEC_HPP
+
+#include "../config/storage_type.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tethys {
+
+// kv store에 기록하는 binary record(state checkpoint, unresolved block backup)의 공통 인코딩.
+// 정수는 little endian 고정 길이, 문자열은 4 byte 길이 + 내용
+inline void appendUint(string &out, uint64_t value, int byte_num) {
+  for (int i = 0; i < byte_num; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+inline void appendString(string &out, const string &value) {
+  appendUint(out, value.size(), 4);
+  out.append(value);
+}
+
+// 읽은 record를 중간 객체 없이 앞에서부터 바로 읽는다. 문자열은 buffer를 가리키는 string_view로도 꺼낼 수 있다
+class BinaryReader {
+public:
+  explicit BinaryReader(std::string_view data) : m_data(data) {}
+
+  bool readUint(uint64_t &value, int byte_num) {
+    if (m_data.size() - m_pos < static_cast<size_t>(byte_num))
+      return false;
+
+    value = 0;
+    for (int i = 0; i < byte_num; ++i) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(m_data[m_pos++])) << (8 * i);
+    }
+    return true;
+  }
+
+  bool readStringView(std::string_view &value) {
+    uint64_t length;
+    if (!readUint(length, 4) || m_data.size() - m_pos < length)
+      return false;
+
+    value = m_data.substr(m_pos, length);
+    m_pos += length;
+    return true;
+  }
+
+  bool readString(string &value) {
+    std::string_view view;
+    if (!readStringView(view))
+      return false;
+
+    value.assign(view.data(), view.size());
+    return true;
+  }
+
+  bool readBytes(uint8_t *out, size_t length) {
+    if (m_data.size() - m_pos < length)
+      return false;
+
+    std::copy(m_data.begin() + m_pos, m_data.begin() + m_pos + length, out);
+    m_pos += length;
+    return true;
+  }
+
+  bool atEnd() const {
+    return m_pos == m_data.size();
+  }
+
+private:
+  std::string_view m_data;
+  size_t m_pos{0};
+};
+
+inline void appendLedger(string &out, const user_ledger_type &ledger) {
+  appendString(out, ledger.var_name);
+  appendString(out, ledger.var_value);
+  appendUint(out, static_cast<uint32_t>(ledger.var_type), 4);
+  appendString(out, ledger.uid);
+  appendUint(out, ledger.up_time, 8);
+  appendUint(out, ledger.up_block, 8);
+  appendString(out, ledger.tag);
+  appendString(out, ledger.pid);
+  appendUint(out, static_cast<uint32_t>(ledger.query_type), 1);
+  appendUint(out, ledger.is_empty, 1);
+}
+
+inline void appendLedger(string &out, const contract_ledger_type &ledger) {
+  appendString(out, ledger.var_name);
+  appendString(out, ledger.var_value);
+  appendUint(out, static_cast<uint32_t>(ledger.var_type), 4);
+  appendString(out, ledger.cid);
+  appendUint(out, ledger.up_time, 8);
+  appendUint(out, ledger.up_block, 8);
+  appendString(out, ledger.var_info);
+  appendString(out, ledger.pid);
+  appendUint(out, static_cast<uint32_t>(ledger.query_type), 1);
+  appendUint(out, ledger.is_empty, 1);
+}
+
+inline void appendLedger(string &out, const user_attribute_type &user_attribute) {
+  appendString(out, user_attribute.uid);
+  appendUint(out, user_attribute.register_day, 8);
+  appendString(out, user_attribute.register_code);
+  appendUint(out, static_cast<uint32_t>(user_attribute.gender), 4);
+  appendString(out, user_attribute.isc_type);
+  appendString(out, user_attribute.isc_code);
+  appendString(out, user_attribute.location);
+  appendUint(out, static_cast<uint32_t>(user_attribute.age_limit), 4);
+  appendString(out, user_attribute.sigma);
+}
+
+inline void appendLedger(string &out, const user_cert_type &user_cert) {
+  appendString(out, user_cert.uid);
+  appendString(out, user_cert.sn);
+  appendUint(out, user_cert.nvbefore, 8);
+  appendUint(out, user_cert.nvafter, 8);
+  appendString(out, user_cert.x509);
+}
+
+inline void appendLedger(string &out, const contract_type &contract) {
+  appendString(out, contract.cid);
+  appendUint(out, contract.after, 8);
+  appendUint(out, contract.before, 8);
+  appendString(out, contract.author);
+  appendString(out, contract.friends);
+  appendString(out, contract.contract);
+  appendString(out, contract.desc);
+  appendString(out, contract.sigma);
+  appendUint(out, static_cast<uint32_t>(contract.query_type), 1);
+}
+
+inline bool readLedger(BinaryReader &reader, user_ledger_type &ledger) {
+  uint64_t var_type, query_type, is_empty;
+  if (!reader.readString(ledger.var_name) || !reader.readString(ledger.var_value) || !reader.readUint(var_type, 4) ||
+      !reader.readString(ledger.uid) || !reader.readUint(ledger.up_time, 8) || !reader.readUint(ledger.up_block, 8) ||
+      !reader.readString(ledger.tag) || !reader.readString(ledger.pid) || !reader.readUint(query_type, 1) || !reader.readUint(is_empty, 1))
+    return false;
+
+  ledger.var_type = static_cast<int>(static_cast<uint32_t>(var_type));
+  ledger.query_type = static_cast<QueryType>(query_type);
+  ledger.is_empty = (is_empty != 0);
+  return true;
+}
+
+inline bool readLedger(BinaryReader &reader, contract_ledger_type &ledger) {
+  uint64_t var_type, query_type, is_empty;
+  if (!reader.readString(ledger.var_name) || !reader.readString(ledger.var_value) || !reader.readUint(var_type, 4) ||
+      !reader.readString(ledger.cid) || !reader.readUint(ledger.up_time, 8) || !reader.readUint(ledger.up_block, 8) ||
+      !reader.readString(ledger.var_info) || !reader.readString(ledger.pid) || !reader.readUint(query_type, 1) ||
+      !reader.readUint(is_empty, 1))
+    return false;
+
+  ledger.var_type = static_cast<int>(static_cast<uint32_t>(var_type));
+  ledger.query_type = static_cast<QueryType>(query_type);
+  ledger.is_empty = (is_empty != 0);
+  return true;
+}
+
+inline bool readLedger(BinaryReader &reader, user_attribute_type &user_attribute) {
+  uint64_t gender, age_limit;
+  if (!reader.readString(user_attribute.uid) || !reader.readUint(user_attribute.register_day, 8) ||
+      !reader.readString(user_attribute.register_code) || !reader.readUint(gender, 4) || !reader.readString(user_attribute.isc_type) ||
+      !reader.readString(user_attribute.isc_code) || !reader.readString(user_attribute.location) || !reader.readUint(age_limit, 4) ||
+      !reader.readString(user_attribute.sigma))
+    return false;
+
+  user_attribute.gender = static_cast<int>(static_cast<uint32_t>(gender));
+  user_attribute.age_limit = static_cast<int>(static_cast<uint32_t>(age_limit));
+  return true;
+}
+
+inline bool readLedger(BinaryReader &reader, user_cert_type &user_cert) {
+  return reader.readString(user_cert.uid) && reader.readString(user_cert.sn) && reader.readUint(user_cert.nvbefore, 8) &&
+         reader.readUint(user_cert.nvafter, 8) && reader.readString(user_cert.x509);
+}
+
+inline bool readLedger(BinaryReader &reader, contract_type &contract) {
+  uint64_t query_type;
+  if (!reader.readString(contract.cid) || !reader.readUint(contract.after, 8) || !reader.readUint(contract.before, 8) ||
+      !reader.readString(contract.author) || !reader.readString(contract.friends) || !reader.readString(contract.contract) ||
+      !reader.readString(contract.desc) || !reader.readString(contract.sigma) || !reader.readUint(query_type, 1))
+    return false;
+
+  contract.query_type = static_cast<QueryType>(query_type);
+  return true;
+}
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_BINARY_CODEC_HPP
@@ -0,0 +1,174 @@
+#ifndef TETHYS_PUBLIC_MERGER_CBOR_READER_HPP
+#define TETHYS_PUBLIC_MERGER_CBOR_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace tethys {
+
+// CBOR를 DOM으로 만들지 않고 앞에서부터 한 항목씩 읽는다. 문자열은 원래 buffer를 가리키는 string_view로 돌려준다.
+// txagg처럼 모양이 정해진 메시지를 바로 구조체에 채울 때 쓴다.
+// nlohmann::json::to_cbor가 만드는 형태(길이가 정해진 배열/map, 최소 길이 정수, text 문자열, double)만 canonical로 본다
+class CborReader {
+public:
+  CborReader(const uint8_t *begin, const uint8_t *end) : m_pos(begin), m_end(end) {}
+  explicit CborReader(std::string_view data)
+      : CborReader(reinterpret_cast<const uint8_t *>(data.data()), reinterpret_cast<const uint8_t *>(data.data()) + data.size()) {}
+
+  bool atEnd() const {
+    return m_pos == m_end;
+  }
+
+  const uint8_t *position() const {
+    return m_pos;
+  }
+
+  bool readMapSize(size_t &size) {
+    return readContainerSize(MAJOR_MAP, size);
+  }
+
+  bool readArraySize(size_t &size) {
+    return readContainerSize(MAJOR_ARRAY, size);
+  }
+
+  bool readText(std::string_view &text) {
+    uint8_t major;
+    uint64_t arg;
+    bool minimal;
+    if (!readHead(major, arg, minimal) || major != MAJOR_TEXT || arg > static_cast<uint64_t>(m_end - m_pos))
+      return false;
+
+    text = std::string_view(reinterpret_cast<const char *>(m_pos), arg);
+    m_pos += arg;
+    return true;
+  }
+
+  // 항목 하나를 건너뛴다. 건너뛴 byte가 nlohmann::json::to_cbor로 다시 만든 것과 같은 형태가 아니면 canonical은 false
+  bool skip(bool &canonical, int depth = 0) {
+    if (depth > MAX_DEPTH)
+      return false;
+
+    uint8_t major;
+    uint64_t arg;
+    bool minimal;
+    const uint8_t *head = m_pos;
+    if (!readHead(major, arg, minimal))
+      return false;
+    canonical = canonical && minimal;
+
+    switch (major) {
+    case MAJOR_UNSIGNED:
+      return true;
+    case MAJOR_NEGATIVE:
+      // int64로 담을 수 없는 음수는 nlohmann이 다르게 다룬다
+      canonical = canonical && (arg <= static_cast<uint64_t>(INT64_MAX));
+      return true;
+    case MAJOR_BYTES:
+    case MAJOR_TEXT:
+      if (arg > static_cast<uint64_t>(m_end - m_pos))
+        return false;
+      canonical = canonical && (major == MAJOR_TEXT);
+      m_pos += arg;
+      return true;
+    case MAJOR_ARRAY:
+      for (uint64_t i = 0; i < arg; ++i) {
+        if (!skip(canonical, depth + 1))
+          return false;
+      }
+      return true;
+    case MAJOR_MAP: {
+      // nlohmann의 object는 key 순으로 정렬되어 있으므로 key가 순서대로일 때만 그대로 다시 만들어진다
+      std::string_view prev_key;
+      for (uint64_t i = 0; i < arg; ++i) {
+        std::string_view key;
+        if (!readText(key))
+          return false;
+        canonical = canonical && (i == 0 || prev_key < key);
+        prev_key = key;
+
+        if (!skip(canonical, depth + 1))
+          return false;
+      }
+      return true;
+    }
+    case MAJOR_TAG:
+      canonical = false;
+      return skip(canonical, depth + 1);
+    default:
+      // false(0xf4), true(0xf5), null(0xf6), double(0xfb)만 그대로 다시 만들어진다
+      canonical = canonical && (*head == 0xf4 || *head == 0xf5 || *head == 0xf6 || *head == 0xfb);
+      return true;
+    }
+  }
+
+private:
+  static constexpr uint8_t MAJOR_UNSIGNED = 0;
+  static constexpr uint8_t MAJOR_NEGATIVE = 1;
+  static constexpr uint8_t MAJOR_BYTES = 2;
+  static constexpr uint8_t MAJOR_TEXT = 3;
+  static constexpr uint8_t MAJOR_ARRAY = 4;
+  static constexpr uint8_t MAJOR_MAP = 5;
+  static constexpr uint8_t MAJOR_TAG = 6;
+  static constexpr int MAX_DEPTH = 64;
+
+  const uint8_t *m_pos;
+  const uint8_t *m_end;
+
+  // 첫 byte의 major type과 뒤따르는 인자(길이 / 값)를 읽는다. 길이를 정하지 않은(indefinite) 항목은 다루지 않는다
+  bool readHead(uint8_t &major, uint64_t &arg, bool &minimal) {
+    if (m_pos == m_end)
+      return false;
+
+    major = *m_pos >> 5;
+    uint8_t info = *m_pos & 0x1f;
+    ++m_pos;
+
+    if (major == 7) {
+      static constexpr uint8_t SIMPLE_VALUE_SIZE[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8};
+      if (info > 27 || SIMPLE_VALUE_SIZE[info] > m_end - m_pos)
+        return false;
+      m_pos += SIMPLE_VALUE_SIZE[info];
+      arg = 0;
+      minimal = true;
+      return true;
+    }
+
+    if (info < 24) {
+      arg = info;
+      minimal = true;
+      return true;
+    }
+    if (info > 27)
+      return false;
+
+    size_t arg_size = size_t(1) << (info - 24);
+    if (arg_size > static_cast<size_t>(m_end - m_pos))
+      return false;
+
+    arg = 0;
+    for (size_t i = 0; i < arg_size; ++i) {
+      arg = (arg << 8) | m_pos[i];
+    }
+    m_pos += arg_size;
+
+    uint64_t min_arg = (info == 24) ? 24 : (uint64_t(1) << (8 * (arg_size / 2)));
+    minimal = (arg >= min_arg);
+    return true;
+  }
+
+  bool readContainerSize(uint8_t expected_major, size_t &size) {
+    uint8_t major;
+    uint64_t arg;
+    bool minimal;
+    if (!readHead(major, arg, minimal) || major != expected_major || arg > static_cast<uint64_t>(m_end - m_pos))
+      return false;
+
+    size = arg;
+    return true;
+  }
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_CBOR_READER_HPP
@@ -5,13 +5,17 @@
 #include "../config/storage_type.hpp"
 #include "../structure/block.hpp"
 #include "kv_store.hpp"
+#include "persistence_stage.hpp"
 #include "rdb_controller.hpp"
+#include "state_checkpoint.hpp"
 #include "unresolved_block_pool.hpp"
+#include "worker_pool.hpp"
 
 #include <boost/program_options/variables_map.hpp>
 #include <map>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <utility>
 #include <vector>
 
@@ -25,6 +29,9 @@ private:
   unique_ptr<RdbController> rdb_controller;
   unique_ptr<KvController> kv_controller;
   unique_ptr<UnresolvedBlockPool> unresolved_block_pool;
+  unique_ptr<PersistenceStage> persistence_stage;
+  unique_ptr<WorkerPool> worker_pool;
+  unique_ptr<StateCheckpoint> state_checkpoint;
 
 public:
   Chain(string_view dbms, string_view table_name, string_view db_user_id, string_view db_password);
@@ -52,14 +59,11 @@ public:
   void saveBlockIds();
   void saveBackupBlock(const nlohmann::json &block_json);
   void saveBackupResult(const UnresolvedBlock &UR_block);
+  void beginGroupCommit();
+  void endGroupCommit();
   void saveSelfInfo(self_info_type &self_info);
   string getValueByKey(string what, const string &base_keys);
   void restorePool();
-  void restoreUserLedgerList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_ledger_list_json);
-  void restoreContractLedgerList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &contract_ledger_list_json);
-  void restoreUserAttributeList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_attribute_list_json);
-  void restoreUserCertList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &user_cert_list_json);
-  void restoreContractList(UnresolvedBlock &restored_unresolved_block, const nlohmann::json &contract_list_json);
 
   // RDB functions
   const nlohmann::json queryContractScan(const nlohmann::json &where_json);
@@ -68,12 +72,20 @@ public:
   const nlohmann::json queryUserInfoGet(const nlohmann::json &where_json);
   const nlohmann::json queryUserScopeGet(const nlohmann::json &where_json);
   const nlohmann::json queryContractScopeGet(const nlohmann::json &where_json);
+  const nlohmann::json queryUserScopeProof(const nlohmann::json &where_json);
+  const nlohmann::json queryContractScopeProof(const nlohmann::json &where_json);
   //const nlohmann::json queryBlockGet(const nlohmann::json &where_json);
   const nlohmann::json queryTxGet(const nlohmann::json &where_json);
   const nlohmann::json queryBlockScan(const nlohmann::json &where_json);
   const nlohmann::json queryTxScan(const nlohmann::json &where_json);
 
   string getUserCert(const base58_type &user_id);
+  map<base58_type, string> getUserCerts(const vector<base58_type> &user_ids);
+  // (block_id, block_height) 블록에서 바라본 인증서. 그 블록과 조상 블록 -> commit 전의 확정된 블록 -> rdb 순서로 찾는다
+  map<base58_type, string> getUserCertsFromPoint(const vector<base58_type> &user_ids, const base58_type &block_id,
+                                                 block_height_type block_height);
+  nlohmann::json getRdbCacheStats();
+  nlohmann::json getOrphanStats();
   bool applyBlockToRDB(const Block &block_info);
   bool applyTransactionToRDB(const Block &block_info);
   bool applyUserLedgerToRDB(const map<string, user_ledger_type> &user_ledger_list);
@@ -81,6 +93,11 @@ public:
   bool applyUserAttributeToRDB(const map<base58_type, user_attribute_type> &user_attribute_list);
   bool applyUserCertToRDB(const map<base58_type, user_cert_type> &user_cert_list);
   bool applyContractToRDB(const map<base58_type, contract_type> &contract_list);
+  bool commitResolvedBlock(const UnresolvedBlock &resolved_block);
+  bool enqueueResolvedBlock(const UnresolvedBlock &resolved_block);
+  block_height_type getDurableHeight();
+  bool hasPersistenceFailed();
+  void stopPersistence();
 
   vector<Block> getBlocksFromUnresolvedLongestChain();
   vector<Block> getBlocksByHeight(int from, int to);
@@ -107,7 +124,7 @@ public:
 
   block_push_result_type pushBlock(Block &new_block);
   UnresolvedBlock getUnresolvedBlock(const base58_type &block_id, const block_height_type block_height);
-  void setUnresolvedBlock(const UnresolvedBlock &unresolved_block);
+  bool setUnresolvedBlock(const UnresolvedBlock &unresolved_block);
   bool resolveBlock(Block &new_block, UnresolvedBlock &resolved_result);
   void setPool(const base64_type &last_block_id, block_height_type last_height, timestamp_t last_time, const base64_type &last_hash,
                const base64_type &prev_block_id);
@@ -125,11 +142,19 @@ private:
   StateTree m_cs_tree; // contract scope state tree
   block_pool_info_type m_head_info;
   block_pool_info_type m_longest_chain_info;
+  // state tree는 io thread에서만 바꾸지만 proof 조회는 다른 thread에서도 들어오므로, 바꿀 때와 proof를 만들 때 lock을 잡는다
+  std::shared_mutex m_state_tree_mutex;
+  base58_type m_confirmed_state_id; // proof의 기본 기준이 되는 마지막 확정 블록
+
+  bool loadStateCheckpoint(block_height_type resolved_height);
+  const nlohmann::json queryStateProof(const StateTree &state_tree, const nlohmann::json &where_json);
 
 public:
   void setupStateTree();
   void updateStateTree(const UnresolvedBlock &unresolved_block);
   void revertStateTree(const UnresolvedBlock &unresolved_block);
+  void commitStateVersion(const base58_type &block_id);
+  void releaseStateVersion(const base58_type &block_id);
 
   user_ledger_type findUserLedgerFromHead(UnresolvedBlock &UR_block, const string &pid);
   contract_ledger_type findContractLedgerFromHead(UnresolvedBlock &UR_block, const string &pid);
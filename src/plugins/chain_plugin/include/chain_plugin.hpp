@@ -12,6 +12,7 @@
 #include "../structure/transaction.hpp"
 #include "chain.hpp"
 #include "plugin.hpp"
+#include "ssig_verifier.hpp"
 #include "transacton_pool.hpp"
 
 #include <boost/filesystem.hpp>
@@ -36,9 +37,7 @@ public:
 
   void pluginStart();
 
-  void pluginShutdown() {
-    logger::INFO("ChainPlugin Shutdown");
-  }
+  void pluginShutdown();
 
   void setProgramOptions(options_description &cfg) override;
 
@@ -46,6 +45,7 @@ public:
 
   Chain &chain();
   TransactionPool &transactionPool();
+  SSigBatchVerifier &ssigVerifier();
 
 private:
   std::unique_ptr<class ChainPluginImpl> impl;
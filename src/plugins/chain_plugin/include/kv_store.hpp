@@ -10,6 +10,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <leveldb/cache.h>
 #include <leveldb/db.h>
+#include <leveldb/iterator.h>
 #include <leveldb/options.h>
 #include <leveldb/write_batch.h>
 
@@ -28,8 +29,10 @@ private:
   leveldb::WriteOptions m_write_options;
   leveldb::ReadOptions m_read_options;
 
-  unordered_map<string, leveldb::DB *> db_map;
-  unordered_map<string, leveldb::WriteBatch> write_batch_map;
+  leveldb::DB *m_db{nullptr}; // 모든 data type을 key prefix로 나누어 하나의 DB에 저장한다
+  leveldb::WriteBatch m_write_batch;
+  size_t m_batch_op_num{0};
+  int m_group_commit_depth{0};
 
 public:
   KvController();
@@ -51,28 +54,31 @@ public:
   // unresolved block pool backup / restore
   bool saveBlockIds(const string &serialized_block_ids);
   bool saveBackupBlock(const base58_type &block_id, const string &serialized_block);
-  bool saveBackupUserLedgers(const base58_type &block_id, const string &serialized_user_ledgers);
-  bool saveBackupContractLedgers(const base58_type &block_id, const string &serialized_contract_ledgers);
-  bool saveBackupUserAttributes(const base58_type &block_id, const string &serialized_user_attributes);
-  bool saveBackupUserCerts(const base58_type &block_id, const string &serialized_user_certs);
-  bool saveBackupContracts(const base58_type &block_id, const string &serialized_contracts);
+  bool saveBackupResult(const base58_type &block_id, const string &serialized_result);
 
   string loadBlockIds();
   string loadBackupBlock(const std::string &key);
-  string loadBackupUserLedgers(const std::string &key);
-  string loadBackupContractLedgers(const std::string &key);
-  string loadBackupUserAttributes(const std::string &key);
-  string loadBackupUserCerts(const std::string &key);
-  string loadBackupContracts(const std::string &key);
+  string loadBackupResult(const std::string &key);
 
-  void delBackup(const base58_type &block_id);
+  void delBackups(const vector<base58_type> &block_ids);
+
+  // begin ~ end 사이의 save / del은 batch에 모아 두었다가 end에서 한 번의 sync write로 기록한다
+  void beginGroupCommit();
+  bool endGroupCommit();
+
+  // state tree checkpoint. 크기가 크므로 다른 data type의 batch와 섞지 않고 바로 기록한다
+  bool saveStateCheckpoint(const string &key, const string &value, bool sync = false);
+  string loadStateCheckpoint(const string &key);
+  void delStateCheckpoint(const vector<string> &keys);
 
 private:
+  static string makeKey(const string &what, const string &key);
+  void migrateSeparateDBs();
   bool errorOnCritical(const leveldb::Status &status);
-  bool addBatch(string what, const string &key, const string &value);
-  void commitBatchAll();
-  void rollbackBatchAll();
-  void clearBatchAll();
+  bool addBatch(const string &what, const string &key, const string &value);
+  void delBatch(const string &what, const string &key);
+  bool commitBatch();
+  void rollbackBatch();
   bool to_bool(const string &string_bool);
 };
 } // namespace tethys
@@ -0,0 +1,163 @@
+#ifndef TETHYS_PUBLIC_MERGER_LEDGER_CACHE_HPP
+#define TETHYS_PUBLIC_MERGER_LEDGER_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tethys {
+
+// key의 hash로 shard를 나누고, shard마다 LRU 방식으로 크기를 제한하는 cache.
+// 서로 다른 shard에 대한 접근은 lock을 공유하지 않는다.
+// rdb를 조회해서 채우는 쪽은 조회 전에 getGeneration으로 shard의 generation을 읽어 두고 fill로 넣는다.
+// 그 사이 같은 shard에 put / update / erase가 있었으면 조회 결과가 이미 오래된 것일 수 있으므로 넣지 않는다.
+template <typename KeyType, typename ValueType>
+class ShardedLruCache {
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::list<std::pair<KeyType, ValueType>> lru_list; // front가 가장 최근에 사용된 항목
+    std::unordered_map<KeyType, typename std::list<std::pair<KeyType, ValueType>>::iterator> index;
+    uint64_t generation{0}; // put / update / erase 때마다 증가
+  };
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  size_t m_shard_capacity;
+
+  std::atomic<uint64_t> m_hit_count{0};
+  std::atomic<uint64_t> m_miss_count{0};
+
+  Shard &getShard(const KeyType &key) {
+    return *m_shards[std::hash<KeyType>{}(key) % m_shards.size()];
+  }
+
+  // shard.mutex를 잡은 상태에서 부른다
+  void putLocked(Shard &shard, const KeyType &key, const ValueType &value) {
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      it->second->second = value;
+      shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, it->second);
+      return;
+    }
+
+    shard.lru_list.emplace_front(key, value);
+    shard.index[key] = shard.lru_list.begin();
+
+    if (shard.lru_list.size() > m_shard_capacity) {
+      shard.index.erase(shard.lru_list.back().first);
+      shard.lru_list.pop_back();
+    }
+  }
+
+public:
+  ShardedLruCache(size_t capacity, size_t shard_num) : m_shard_capacity(std::max<size_t>(1, capacity / std::max<size_t>(1, shard_num))) {
+    for (size_t i = 0; i < std::max<size_t>(1, shard_num); ++i) {
+      m_shards.emplace_back(std::make_unique<Shard>());
+    }
+  }
+
+  bool get(const KeyType &key, ValueType &value) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      ++m_miss_count;
+      return false;
+    }
+
+    shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, it->second);
+    value = it->second->second;
+    ++m_hit_count;
+    return true;
+  }
+
+  void put(const KeyType &key, const ValueType &value) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    ++shard.generation;
+    putLocked(shard, key, value);
+  }
+
+  uint64_t getGeneration(const KeyType &key) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.generation;
+  }
+
+  // generation을 읽은 뒤 같은 shard가 바뀌지 않았을 때만 넣는다. 넣지 않았으면 false
+  bool fill(const KeyType &key, const ValueType &value, uint64_t generation) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    if (shard.generation != generation)
+      return false;
+
+    putLocked(shard, key, value);
+    return true;
+  }
+
+  // cache에 있는 항목만 제자리에서 수정한다. 없으면 false
+  template <typename Updater>
+  bool update(const KeyType &key, Updater &&updater) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    ++shard.generation; // cache에 없어도 진행 중인 조회가 이전 값을 넣지 못하게 한다
+    auto it = shard.index.find(key);
+    if (it == shard.index.end())
+      return false;
+
+    updater(it->second->second);
+    return true;
+  }
+
+  void erase(const KeyType &key) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    ++shard.generation;
+    auto it = shard.index.find(key);
+    if (it == shard.index.end())
+      return;
+
+    shard.lru_list.erase(it->second);
+    shard.index.erase(it);
+  }
+
+  void clear() {
+    for (auto &shard : m_shards) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      ++shard->generation;
+      shard->lru_list.clear();
+      shard->index.clear();
+    }
+  }
+
+  size_t size() {
+    size_t total_size = 0;
+    for (auto &shard : m_shards) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      total_size += shard->lru_list.size();
+    }
+    return total_size;
+  }
+
+  uint64_t getHitCount() const {
+    return m_hit_count.load();
+  }
+
+  uint64_t getMissCount() const {
+    return m_miss_count.load();
+  }
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_LEDGER_CACHE_HPP
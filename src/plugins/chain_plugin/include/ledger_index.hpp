@@ -0,0 +1,112 @@
+#ifndef TETHYS_PUBLIC_MERGER_LEDGER_INDEX_HPP
+#define TETHYS_PUBLIC_MERGER_LEDGER_INDEX_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace tethys {
+
+// pid를 key로 하는 persistent(immutable) treap.
+// insert는 root부터 바뀐 경로의 노드만 새로 만들고 나머지는 부모 블록의 index와 공유한다 (path copying).
+// 따라서 각 UnresolvedBlock은 부모의 index에 자신의 ledger만 얹은 index를 가질 수 있고,
+// "블록 X에서 바라본 pid의 최신 값"을 fork 깊이와 관계없이 O(log n)에 찾을 수 있다.
+template <typename LedgerType>
+class PersistentLedgerIndex {
+private:
+  struct Entry {
+    std::string pid;
+    LedgerType ledger;
+
+    Entry(const std::string &pid_, const LedgerType &ledger_) : pid(pid_), ledger(ledger_) {}
+  };
+
+  struct Node;
+  using node_ptr = std::shared_ptr<const Node>;
+
+  struct Node {
+    std::shared_ptr<const Entry> entry; // path copying 시에 ledger를 복사하지 않도록 entry는 공유한다
+    size_t priority;
+    node_ptr left;
+    node_ptr right;
+
+    Node(std::shared_ptr<const Entry> entry_, size_t priority_, node_ptr left_, node_ptr right_)
+        : entry(std::move(entry_)), priority(priority_), left(std::move(left_)), right(std::move(right_)) {}
+  };
+
+  node_ptr m_root;
+  size_t m_size{0};
+
+public:
+  PersistentLedgerIndex() = default;
+
+  bool empty() const {
+    return m_root == nullptr;
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+
+  // 기존 index는 그대로 두고, pid의 값이 ledger로 바뀐 새 index를 반환한다
+  PersistentLedgerIndex insert(const std::string &pid, const LedgerType &ledger) const {
+    PersistentLedgerIndex new_index;
+    bool replaced = false;
+    new_index.m_root = insertNode(m_root, std::make_shared<const Entry>(pid, ledger), std::hash<std::string>{}(pid), replaced);
+    new_index.m_size = replaced ? m_size : m_size + 1;
+    return new_index;
+  }
+
+  PersistentLedgerIndex insert(const std::map<std::string, LedgerType> &ledger_list) const {
+    PersistentLedgerIndex new_index = *this;
+    for (auto &each_ledger : ledger_list) {
+      new_index = new_index.insert(each_ledger.first, each_ledger.second);
+    }
+    return new_index;
+  }
+
+  // 찾지 못하면 nullptr. 반환된 포인터는 이 index(또는 이를 공유하는 index)가 살아있는 동안 유효하다
+  const LedgerType *find(const std::string &pid) const {
+    const Node *current = m_root.get();
+    while (current != nullptr) {
+      int cmp = pid.compare(current->entry->pid);
+      if (cmp == 0)
+        return &current->entry->ledger;
+      current = (cmp < 0) ? current->left.get() : current->right.get();
+    }
+    return nullptr;
+  }
+
+private:
+  static node_ptr insertNode(const node_ptr &node, std::shared_ptr<const Entry> entry, size_t priority, bool &replaced) {
+    if (node == nullptr)
+      return std::make_shared<const Node>(std::move(entry), priority, nullptr, nullptr);
+
+    int cmp = entry->pid.compare(node->entry->pid);
+    if (cmp == 0) {
+      replaced = true;
+      return std::make_shared<const Node>(std::move(entry), node->priority, node->left, node->right);
+    }
+
+    if (cmp < 0) {
+      node_ptr new_left = insertNode(node->left, std::move(entry), priority, replaced);
+      if (new_left->priority > node->priority) { // rotate right
+        node_ptr new_right = std::make_shared<const Node>(node->entry, node->priority, new_left->right, node->right);
+        return std::make_shared<const Node>(new_left->entry, new_left->priority, new_left->left, std::move(new_right));
+      }
+      return std::make_shared<const Node>(node->entry, node->priority, std::move(new_left), node->right);
+    }
+
+    node_ptr new_right = insertNode(node->right, std::move(entry), priority, replaced);
+    if (new_right->priority > node->priority) { // rotate left
+      node_ptr new_left = std::make_shared<const Node>(node->entry, node->priority, node->left, new_right->left);
+      return std::make_shared<const Node>(new_right->entry, new_right->priority, std::move(new_left), new_right->right);
+    }
+    return std::make_shared<const Node>(node->entry, node->priority, node->left, std::move(new_right));
+  }
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_LEDGER_INDEX_HPP
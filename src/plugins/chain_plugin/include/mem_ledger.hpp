@@ -6,119 +6,182 @@
 #include "../../../../lib/tethys-utils/src/sha256.hpp"
 #include "../config/storage_type.hpp"
 
+#include <array>
+#include <botan-2/botan/hash.h>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
-#include <mutex>
+#include <optional>
 #include <sstream>
-#include <stack>
 #include <stdlib.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace tethys {
 
-// TODO: define 값 변경
+// pid로부터 계산한 path 중 먼저 사용하는 비트 수. 이 비트가 모두 같은 pid끼리는 나머지 비트로 계속 내려간다
 #define _TREE_DEPTH 16
-#define _SHA256_SPLIT 15
+#define _MAX_TREE_DEPTH 256
 
 string toHex(int num);
 string valueToStr(vector<uint8_t> value);
-char *intToBin(uint32_t num);
 
-ostream &operator<<(ostream &os, vector<uint8_t> &value);
+using state_hash_type = std::array<uint8_t, 32>;
+using state_node_idx_type = uint32_t;
 
-class StateNode {
-private:
-  // TODO: 메모리 절약을 위해 최대한 멤버 변수를 줄일 것
-  string m_pid;
-  shared_ptr<StateNode> m_left;
-  shared_ptr<StateNode> m_right;
-  vector<uint8_t> m_hash_value;
-  path_type m_suffix;
-  int m_suffix_len;
-  path_type m_bin_path;
-
-  shared_ptr<user_ledger_type> m_user_ledger;
-  shared_ptr<contract_ledger_type> m_contract_ledger;
-
-  void makeValue(const user_ledger_type &user_ledger);
-  void makeValue(const contract_ledger_type &contract_ledger);
-  void makeValue(string &key);
-//  uint32_t makePath(user_ledger_type &user_ledger);
-//  uint32_t makePath(contract_ledger_type &contract_ledger);
+constexpr state_node_idx_type NIL_NODE_IDX = std::numeric_limits<state_node_idx_type>::max();
 
-public:
-  StateNode() = default;
-  StateNode(const user_ledger_type &user_ledger);
-  StateNode(const contract_ledger_type &contract_ledger);
-  void reHash();
-  void reHash(string l_value, string r_value);
-
-  void moveToParent();
-  bool isDummy();
-  path_type calPathFromPid(const string &pid);
-
-  void setLeft(shared_ptr<StateNode> node);
-  void setRight(shared_ptr<StateNode> node);
-  void setSuffix(const path_type &path, int pos);
-  void setBinPath(const string &pid);
-  void setNodeInfo(shared_ptr<StateNode> new_node);
-  void overwriteNode(shared_ptr<StateNode> node);
-
-  string getPid();
-  shared_ptr<StateNode> getLeft();
-  shared_ptr<StateNode> getRight();
-  path_type getSuffix();
-  int getSuffixLen();
-  vector<uint8_t> getValue();
-  path_type getBinPath();
-
-  const user_ledger_type &getUserLedger() const;
-  const contract_ledger_type &getContractLedger() const;
-  shared_ptr<user_ledger_type> getUserLedgerPtr() const;
-  shared_ptr<contract_ledger_type> getContractLedgerPtr() const;
+class WorkerPool;
+
+// arena(StateTree::m_nodes)에 저장되는 노드. 자식은 포인터가 아닌 arena의 index로 연결한다.
+// leaf는 ledger_idx로 ledger를 가리키고, 내부(dummy) 노드는 ledger_idx가 NIL_NODE_IDX이다.
+// dirty는 아래쪽이 바뀌어 hash를 다시 계산해야 하는 내부 노드 표시
+// ref_count는 이 노드를 가리키는 부모 노드와 root(작업 중인 tree, 저장된 version)의 수. 1보다 크면 공유 중이므로 복사한 뒤 고친다
+struct StateNode {
+  state_hash_type hash_value{};
+  state_node_idx_type left{NIL_NODE_IDX};
+  state_node_idx_type right{NIL_NODE_IDX};
+  state_node_idx_type ledger_idx{NIL_NODE_IDX};
+  uint32_t ref_count{0};
+  bool dirty{false};
+
+  bool isLeaf() const {
+    return ledger_idx != NIL_NODE_IDX;
+  }
 };
 
 class StateTree {
 private:
-  shared_ptr<StateNode> root;
+  // leaf가 가리키는 ledger. contract ledger는 index의 최상위 비트로 구분한다
+  static constexpr state_node_idx_type CONTRACT_LEDGER_FLAG = 0x80000000;
+
+  struct UserLeaf {
+    path_type path;
+    user_ledger_type ledger;
+  };
+
+  struct ContractLeaf {
+    path_type path;
+    contract_ledger_type ledger;
+  };
+
+  // 블록 id별로 저장해 둔 tree. 노드를 공유하므로 저장/전환은 root index만 바꾼다
+  struct StateVersion {
+    state_node_idx_type root;
+    uint64_t size;
+  };
+
+  vector<StateNode> m_nodes;
+  vector<state_node_idx_type> m_free_nodes;
+  vector<UserLeaf> m_user_leaves;
+  vector<state_node_idx_type> m_free_user_leaves;
+  vector<ContractLeaf> m_contract_leaves;
+  vector<state_node_idx_type> m_free_contract_leaves;
+  state_node_idx_type m_root;
   uint64_t m_size;
-  stack<shared_ptr<StateNode>> stk; // leaf 에서 root 까지의 해쉬 재 계산을 위해 StateNode *를 기억해두는 변수
-
-  bool _debug_dir;
-  int _debug_depth;
-  string _debug_str_depth;
-  string _debug_str_dir;
+  unordered_map<base58_type, StateVersion> m_versions;
+  StateHashVersion m_hash_version;
+  WorkerPool *m_worker_pool{nullptr};
+
+  // proof에서 각 노드의 두 자식이 어떤 형태로 들어있는지
+  enum class ProofChild : uint8_t { EMPTY = 0, HASH = 1, BRANCH = 2, LEAF = 3 };
+  static constexpr uint8_t PROOF_FORMAT_VERSION = 1;
+
+  static path_type calPathFromPid(const string &pid);
+  static bool getDirectionOf(const path_type &path, int depth); // false: left, true: right
+  static string getTraversalKey(const string &pid);
+  static state_hash_type hashLeaf(StateHashVersion hash_version, const string &pid, const string &var_value);
+  static state_hash_type hashBranch(StateHashVersion hash_version, const state_hash_type *left, const state_hash_type *right);
+
+  state_node_idx_type allocNode();
+  void freeNode(state_node_idx_type node_idx);
+  void retainNode(state_node_idx_type node_idx);
+  void releaseNode(state_node_idx_type node_idx);
+  state_node_idx_type copyNode(state_node_idx_type node_idx);
+  state_node_idx_type makeWritableRoot();
+  state_node_idx_type makeWritableChild(state_node_idx_type parent_idx, bool dir);
+  template <typename T>
+  state_node_idx_type newLeafNode(const T &ledger);
+  state_node_idx_type allocLeaf(const user_ledger_type &user_ledger);
+  state_node_idx_type allocLeaf(const contract_ledger_type &contract_ledger);
+  void freeLeaf(state_node_idx_type ledger_idx);
+  void setLeafLedger(state_node_idx_type ledger_idx, const user_ledger_type &user_ledger);
+  void setLeafLedger(state_node_idx_type ledger_idx, const contract_ledger_type &contract_ledger);
+
+  const path_type &getLeafPath(state_node_idx_type ledger_idx) const;
+  const string &getLeafPid(state_node_idx_type ledger_idx) const;
+  state_node_idx_type &childOf(state_node_idx_type node_idx, bool dir);
+
+  void makeLeafValue(state_node_idx_type node_idx);
+  void reHash(state_node_idx_type node_idx);
+  void markDirty(const vector<state_node_idx_type> &path_nodes);
+  void reHashDirty(state_node_idx_type node_idx);
+  void reHashDirtyTree(size_t updated_num);
+  void collectDirtySplitNodes(state_node_idx_type node_idx, int depth, vector<state_node_idx_type> &split_nodes) const;
+  state_node_idx_type findLeaf(const string &pid, vector<state_node_idx_type> &path_nodes) const;
+  state_node_idx_type findLeaf(state_node_idx_type root_idx, const string &pid, vector<state_node_idx_type> &path_nodes) const;
+  const string &getLeafValue(state_node_idx_type ledger_idx) const;
 
-  bool getDirectionOf(const path_type &path, int pos); // false: left, true: right
-  void visit(shared_ptr<StateNode> node, bool isPrint);
-  void postOrder(shared_ptr<StateNode> node, bool isPrint = true);
+  template <typename T>
+  void insertLeaf(const T &ledger);
+  void writeProofNode(state_node_idx_type node_idx, int depth, const vector<pair<string, uint32_t>> &sorted_pids, size_t begin, size_t end,
+                      string &proof) const;
+  void postOrder(state_node_idx_type node_idx, int depth, bool dir);
 
 public:
-  StateTree() {
-    root = shared_ptr<StateNode>();
-    m_size = 0;
-  }
+  explicit StateTree(StateHashVersion hash_version = StateHashVersion::BASE64_CONCAT);
 
+  // 설정하면 많은 ledger를 한꺼번에 반영할 때 split depth 아래의 dirty subtree들을 pool에서 나눠 re-hashing 한다
+  void setWorkerPool(WorkerPool *worker_pool);
+
+  // 여러 ledger를 한꺼번에 반영할 때는 leaf를 모두 바꾼 뒤, 바뀐 내부 노드들을 한 번씩만 re-hashing 한다
   void updateUserState(const vector<user_ledger_type> &user_ledger_list);
   void updateUserState(const map<string, user_ledger_type> &user_ledger_list);
   void updateContractState(const vector<contract_ledger_type> &contract_ledger_list);
   void updateContractState(const map<string, contract_ledger_type> &contract_ledger_list);
-  template <typename T>
-  void insertNode(const T &ledger);   // TODO: user_ledger_type과 contract_ledger_type 두 가지로 template를 제한
-  void modifyNode(shared_ptr<StateNode> old_node, shared_ptr<StateNode> new_node);
+  void insertNode(const user_ledger_type &user_ledger);
+  void insertNode(const contract_ledger_type &contract_ledger);
   void removeNode(const string &pid);
-  shared_ptr<StateNode> getMerkleNode(const string &pid);
-  vector<vector<uint8_t>> getSiblings(const string &pid);
+
+  // 현재 tree를 block_id의 version으로 저장 / 저장된 version으로 전환 / 삭제. 모두 O(1)이며, 삭제 시 다른 곳에서 쓰지 않는 노드만 회수된다
+  void commitVersion(const base58_type &block_id);
+  bool checkoutVersion(const base58_type &block_id);
+  void releaseVersion(const base58_type &block_id);
+  // block_id version을 new_id로도 저장한다. 둘 중 하나를 삭제해도 다른 하나는 남는다
+  bool copyVersion(const base58_type &block_id, const base58_type &new_id);
+  bool hasVersion(const base58_type &block_id) const;
+  size_t getVersionNum() const;
+
+  // checkpoint 저장 / 복원 용. version의 노드를 root부터 BFS 순서로 0, 1, 2, ... 번호를 다시 매겨 node_sink로 넘기고,
+  // leaf의 ledger도 나오는 순서대로 user_sink / contract_sink로 넘긴다. 넘기는 노드의 자식 / ledger index는 새 번호이다.
+  // version의 노드는 index로만 따라가므로, version이 남아 있다면 sink가 넘겨받은 값을 쓴 뒤 잠시 lock을 풀고 tree가 바뀌어도 된다
+  bool exportVersion(const base58_type &block_id, const std::function<void(const StateNode &)> &node_sink,
+                     const std::function<void(const user_ledger_type &)> &user_sink,
+                     const std::function<void(const contract_ledger_type &)> &contract_sink) const;
+  // exportVersion으로 꺼낸 노드와 ledger로 tree를 다시 만든다. hash는 다시 계산하지 않고 저장된 값을 그대로 쓴다
+  bool importTree(vector<StateNode> &&nodes, vector<user_ledger_type> &&user_ledgers, vector<contract_ledger_type> &&contract_ledgers);
+
+  optional<user_ledger_type> getUserLedger(const string &pid) const;
+  optional<contract_ledger_type> getContractLedger(const string &pid) const;
+
+  // block_id version에 대한 pid들의 inclusion proof. 여러 pid가 함께 지나는 노드와 형제 hash는 한 번만 넣는다.
+  // tree에 있는 pid만 (pid, var_value)로 proven_leaves에 넘긴 순서대로 담기며, proof는 이 leaf들에 대한 것이다. version이 없으면 false
+  // tree를 바꾸지 않으므로 갱신과 겹치지만 않으면 여러 thread에서 불러도 된다
+  bool getProof(const base58_type &block_id, const vector<string> &pids, string &proof, vector<pair<string, string>> &proven_leaves) const;
+  static bool verifyProof(const string &proof, const vector<uint8_t> &root_value, const vector<pair<string, string>> &leaves);
 
   void printTreePostOrder();
 
-  uint64_t getSize();
-  vector<uint8_t> getRootValue();
-  shared_ptr<StateNode> getRootPtr();
-  stack<shared_ptr<StateNode>> getStack();
+  StateHashVersion getHashVersion() const;
+  uint64_t getSize() const;
+  size_t getNodeCount() const;
+  size_t getMemoryUsage() const;
+  vector<uint8_t> getRootValue() const;
+  vector<uint8_t> getRootValue(const base58_type &block_id) const;
 };
 
 } // namespace tethys
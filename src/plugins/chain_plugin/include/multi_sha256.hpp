@@ -0,0 +1,29 @@
+#ifndef TETHYS_PUBLIC_MERGER_MULTI_SHA256_HPP
+#define TETHYS_PUBLIC_MERGER_MULTI_SHA256_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tethys {
+
+// merkle tree의 한 level처럼 크기가 64 byte로 같은 메시지 여러 개를 한꺼번에 SHA-256 하는 kernel.
+// SHA-NI > AVX2(8개씩 동시에) > scalar 중 CPU가 지원하는 것을 실행 중에 골라 쓴다.
+// 메시지 길이가 고정이므로 두 번째(padding) block의 message schedule은 미리 계산해 둔다
+class MultiSha256 {
+public:
+  enum class Kernel { SCALAR, AVX2, SHA_NI };
+
+  // 이 CPU에서 쓸 수 있는 가장 빠른 kernel. 처음 불릴 때 한 번 고른다
+  static Kernel getKernel();
+  static bool isSupported(Kernel kernel);
+  static const char *getKernelName(Kernel kernel);
+
+  // input에 이어붙인 64 byte 메시지 num개의 hash를 output에 32 byte씩 이어서 쓴다. input과 output은 겹치면 안 된다
+  // kernel을 직접 고를 때는 isSupported인 것만 넘긴다
+  static void hash64(const uint8_t *input, size_t num, uint8_t *output);
+  static void hash64(Kernel kernel, const uint8_t *input, size_t num, uint8_t *output);
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_MULTI_SHA256_HPP
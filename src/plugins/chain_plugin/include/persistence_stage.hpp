@@ -0,0 +1,80 @@
+#ifndef TETHYS_PUBLIC_MERGER_PERSISTENCE_STAGE_HPP
+#define TETHYS_PUBLIC_MERGER_PERSISTENCE_STAGE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../../../lib/log/include/log.hpp"
+#include "../config/storage_config.hpp"
+#include "../config/storage_type.hpp"
+#include "unresolved_block_pool.hpp"
+
+namespace tethys {
+
+// 확정된 블록을 io_context thread 밖에서 순서대로 rdb에 commit하는 단계.
+// push는 io thread를 막지 않도록 기다리지 않는다. queue가 가득 찼거나 commit을 포기했으면 받지 않으므로,
+// 블록을 확정하기 전에 canPush로 확인하고 받을 수 없으면 확정을 미룬다 (push하는 thread는 io thread 하나뿐).
+// commit이 끝난 블록은 durable height(어디까지 rdb에 기록되었는지)를 올리고, backup 삭제를 위해 id를 남긴다.
+class PersistenceStage {
+public:
+  using commit_function_type = std::function<bool(const UnresolvedBlock &)>;
+
+  PersistenceStage(size_t queue_capacity, commit_function_type commit_function, block_height_type durable_height);
+  ~PersistenceStage();
+
+  PersistenceStage(const PersistenceStage &) = delete;
+  PersistenceStage &operator=(const PersistenceStage &) = delete;
+
+  void start();
+  void stop();
+
+  bool canPush();
+  bool push(const UnresolvedBlock &resolved_block);
+  // commit을 PERSISTENCE_MAX_RETRY_NUM번 실패하여 worker가 멈췄다. 재시작해야 backup에서 복구된다
+  bool hasFailed() const;
+
+  block_height_type getDurableHeight() const;
+  size_t getPendingSize();
+  vector<base58_type> getPendingBlockIds();
+  vector<base58_type> takeDurableBlockIds();
+
+  // 아직 commit되지 않은 블록들에서 pid를 찾는다. 최근 블록부터 검색
+  bool findUserLedger(const string &pid, user_ledger_type &found_ledger);
+  bool findContractLedger(const string &pid, contract_ledger_type &found_ledger);
+
+  // 아직 commit되지 않은 블록들을 최근 블록부터 순회한다. visitor가 false를 반환하면 멈춘다
+  template <typename Visitor>
+  void visitPendingBlocks(Visitor &&visitor) {
+    std::lock_guard<std::mutex> guard(m_queue_mutex);
+    for (auto it = m_pending_blocks.rbegin(); it != m_pending_blocks.rend(); ++it) {
+      if (!visitor(static_cast<const UnresolvedBlock &>(*it)))
+        return;
+    }
+  }
+
+private:
+  void run();
+  bool commitWithRetry(const UnresolvedBlock &resolved_block);
+
+  size_t m_queue_capacity;
+  commit_function_type m_commit_function;
+
+  std::deque<UnresolvedBlock> m_pending_blocks; // front는 현재 commit 중인 블록
+  vector<base58_type> m_durable_block_ids;
+  std::mutex m_queue_mutex;
+  std::condition_variable m_not_empty;
+
+  std::atomic<block_height_type> m_durable_height;
+  std::atomic<bool> m_stopping{false};
+  std::atomic<bool> m_failed{false};
+  std::thread m_worker;
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_PERSISTENCE_STAGE_HPP
@@ -5,6 +5,7 @@
 #include "../config/storage_config.hpp"
 #include "../config/storage_type.hpp"
 #include "../structure/block.hpp"
+#include "ledger_cache.hpp"
 #include "soci.h"
 #include "unresolved_block_pool.hpp"
 
@@ -22,9 +23,26 @@ private:
   string m_db_password;
   soci::connection_pool m_db_pool;
 
+  // 확정된 state의 cache. apply*ToRDB에서 실행에 성공한 쿼리만 반영하므로 rdb와 항상 일치한다
+  ShardedLruCache<string, user_ledger_type> m_user_scope_cache;         // pid -> row (없는 pid는 is_empty인 ledger)
+  ShardedLruCache<string, contract_ledger_type> m_contract_scope_cache; // pid -> row (없는 pid는 is_empty인 ledger)
+  ShardedLruCache<string, int> m_var_type_cache;                        // var_owner + var_name -> var_type
+  ShardedLruCache<base58_type, string> m_user_cert_cache;               // uid -> x509
+
   Block rowToBlock(const soci::row &r);
   bool isUserId(const string &id);
   bool isContractId(const string &id);
+  string varTypeCacheKey(const string &var_owner, const string &var_name);
+  void cacheUserLedger(const user_ledger_type &user_ledger);
+  void cacheContractLedger(const contract_ledger_type &contract_ledger);
+
+  void insertBlock(soci::session &db_session, const Block &block);
+  void insertTransactions(soci::session &db_session, const Block &block);
+  void writeUserLedgers(soci::session &db_session, const map<string, user_ledger_type> &user_ledger_list);
+  void writeContractLedgers(soci::session &db_session, const map<string, contract_ledger_type> &contract_ledger_list);
+  void writeUserAttributes(soci::session &db_session, const map<base58_type, user_attribute_type> &user_attribute_list);
+  void writeUserCerts(soci::session &db_session, const map<base58_type, user_cert_type> &user_cert_list);
+  void writeContracts(soci::session &db_session, const map<contract_id_type, contract_type> &contract_list);
 
 public:
   RdbController(string_view dbms, string_view table_name, string_view db_user_id, string_view db_password);
@@ -48,10 +66,13 @@ public:
   bool applyUserAttributeToRDB(const map<base58_type, user_attribute_type> &user_attribute_list);
   bool applyUserCertToRDB(const map<base58_type, user_cert_type> &user_cert_list);
   bool applyContractToRDB(const map<contract_id_type, contract_type> &contract_list);
+  bool commitResolvedBlock(const UnresolvedBlock &resolved_block);
 
   vector<Block> getBlocks(const int from, const int to);
   optional<Block> getLatestResolvedBlock();
   string getUserCert(const base58_type &user_id);
+  // 여러 uid의 인증서를 cache에서 먼저 찾고, 없는 것만 한 번의 조회로 읽는다
+  map<base58_type, string> getUserCerts(const vector<base58_type> &user_ids);
 
   //  bool queryRunQuery(std::vector<LedgerRecord> &mem_ledger, nlohmann::json &option, result_query_info_type &result_info);
   //  bool queryRunContract(std::vector<LedgerRecord> &mem_ledger, nlohmann::json &option, result_query_info_type &result_info);
@@ -62,6 +83,8 @@ public:
 
   vector<user_ledger_type> getAllUserLedger();
   vector<contract_ledger_type> getAllContractLedger();
+
+  nlohmann::json getCacheStats();
 };
 } // namespace tethys
 #endif
@@ -0,0 +1,30 @@
+#ifndef TETHYS_PUBLIC_MERGER_SSIG_VERIFIER_HPP
+#define TETHYS_PUBLIC_MERGER_SSIG_VERIFIER_HPP
+
+#include "worker_pool.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tethys {
+
+// 같은 message(block 정보 hash)에 대한 여러 signer의 서명(SSig)을 한꺼번에 검증한다.
+// AGS에는 여러 key를 한 번에 검증하는 연산이 없으므로 서명들을 chunk로 나눠 worker_pool에서 나눠 검증한다.
+// block 수신(ChainPluginImpl::verifySSigs)과 block 생성(BlockProducerPluginImpl::makeMsgBlock)에서 함께 쓴다
+class SSigBatchVerifier {
+public:
+  explicit SSigBatchVerifier(WorkerPool &worker_pool);
+
+  // cert_sigs[i]는 (signer 인증서 PEM, 서명). 모두 유효하면 true이고, 하나라도 틀리면 아직 시작하지 않은 검증은 건너뛴다
+  bool verifyAll(const std::string &message, const std::vector<std::pair<std::string, std::string>> &cert_sigs);
+  // 서명마다의 결과. 틀린 서명만 골라낼 때 쓴다
+  std::vector<bool> verifyEach(const std::string &message, const std::vector<std::pair<std::string, std::string>> &cert_sigs);
+
+private:
+  WorkerPool &m_worker_pool;
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_SSIG_VERIFIER_HPP
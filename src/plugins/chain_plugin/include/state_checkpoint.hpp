@@ -0,0 +1,90 @@
+#ifndef TETHYS_PUBLIC_MERGER_STATE_CHECKPOINT_HPP
+#define TETHYS_PUBLIC_MERGER_STATE_CHECKPOINT_HPP
+
+#include "../../../../lib/json/include/json.hpp"
+#include "../../../../lib/log/include/log.hpp"
+#include "../config/storage_config.hpp"
+#include "../config/storage_type.hpp"
+#include "kv_store.hpp"
+#include "mem_ledger.hpp"
+#include "unresolved_block_pool.hpp"
+#include "worker_pool.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tethys {
+
+// 재시작할 때 rdb의 ledger 전체를 읽어 state tree를 다시 만드는 대신, kv store에 남겨둔 checkpoint에서 불러오기 위한 저장소.
+//  - diff: 블록이 확정될 때마다 그 블록에서 바뀐 ledger들을 height별로 저장
+//  - snapshot: 일정 간격마다 확정된 version의 tree 전체(내부 노드 hash 포함)를 chunk로 나눠 저장. 이전 snapshot과 diff는 지운다
+// 불러올 때는 snapshot을 re-hashing 없이 그대로 올리고, 그 이후의 diff만 다시 반영하면 된다.
+// snapshot 기록만 별도 thread에서 하고, 나머지는 kv_controller와 마찬가지로 io thread에서만 사용한다
+class StateCheckpoint {
+public:
+  explicit StateCheckpoint(KvController &kv_controller);
+  ~StateCheckpoint();
+
+  StateCheckpoint(const StateCheckpoint &) = delete;
+  StateCheckpoint &operator=(const StateCheckpoint &) = delete;
+
+  bool saveDiff(const UnresolvedBlock &resolved_block);
+  bool loadDiff(block_height_type height, vector<user_ledger_type> &user_ledgers, vector<contract_ledger_type> &contract_ledgers);
+
+  // 두 tree에 저장된 block_id version을 height의 snapshot으로 별도 thread에서 기록한다. 기록이 끝나면 이전 snapshot과 height까지의 diff를 지운다.
+  // 기록하는 동안 version을 따로 잡아두므로 호출한 쪽은 block_id version을 바로 회수해도 된다. 두 tree는 tree_mutex로 보호되어야 하며,
+  // 기록 중에는 chunk를 만드는 동안만 shared lock을 잡는다. 이미 기록 중이거나 version이 없으면 false
+  bool startSnapshot(StateTree &us_tree, StateTree &cs_tree, std::shared_mutex &tree_mutex, const base58_type &block_id,
+                     block_height_type height);
+  bool isSaving() const;
+  void waitSnapshot();
+  // 기록 중인 snapshot을 버리고 thread를 정리한다. 이전 snapshot은 그대로 유효하다
+  void stopSnapshot();
+  // 마지막 snapshot을 두 tree에 올린다. 두 tree는 worker_pool에서 동시에 읽는다
+  bool loadSnapshot(StateTree &us_tree, StateTree &cs_tree, WorkerPool &worker_pool, base58_type &block_id, block_height_type &height);
+
+  bool hasSnapshot() const;
+  block_height_type getSnapshotHeight() const;
+
+private:
+  struct TreeMeta {
+    uint64_t node_num{0};
+    uint64_t user_ledger_num{0};
+    uint64_t contract_ledger_num{0};
+    string root_value;
+  };
+
+  static string makeDiffKey(block_height_type height);
+  static string makeChunkKey(block_height_type height, const string &tree_name, const string &part_name, uint64_t chunk_idx);
+
+  bool saveSnapshot(const StateTree &us_tree, const StateTree &cs_tree, std::shared_mutex &tree_mutex, const base58_type &block_id,
+                    block_height_type height);
+  bool saveTree(const StateTree &tree, std::shared_mutex &tree_mutex, block_height_type height, const string &tree_name,
+                TreeMeta &tree_meta);
+  bool loadTree(StateTree &tree, const string &tree_name, const TreeMeta &tree_meta);
+  static vector<string> getSnapshotKeys(block_height_type height, uint64_t chunk_size, const string &tree_name, const TreeMeta &tree_meta);
+  void loadMeta();
+
+  KvController &m_kv_controller;
+
+  bool m_has_snapshot{false};
+  block_height_type m_snapshot_height{0};
+  base58_type m_snapshot_block_id;
+  uint64_t m_snapshot_chunk_size{config::STATE_CHECKPOINT_CHUNK_SIZE};
+  StateHashVersion m_snapshot_hash_version{StateHashVersion::BASE64_CONCAT};
+  TreeMeta m_us_meta;
+  TreeMeta m_cs_meta;
+  mutable std::mutex m_meta_mutex; // snapshot thread가 바꾸는 위의 snapshot 정보
+
+  std::thread m_snapshot_worker;
+  std::atomic<bool> m_saving{false};
+  std::atomic<bool> m_stopping{false};
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_STATE_CHECKPOINT_HPP
@@ -1,7 +1,8 @@
 #ifndef TETHYS_PUBLIC_MERGER_MERKLE_TREE_HPP
 #define TETHYS_PUBLIC_MERGER_MERKLE_TREE_HPP
 
-#include <map>
+#include <algorithm>
+#include <array>
 #include <vector>
 
 #include "../../../../lib/tethys-utils/src/bytes_builder.hpp"
@@ -10,64 +11,127 @@
 #include "../config/storage_config.hpp"
 #include "../config/storage_type.hpp"
 #include "../structure/transaction.hpp"
+#include "multi_sha256.hpp"
 
 using namespace std;
 using namespace tethys::config;
 
 namespace tethys {
 
-// clang-format off
-const std::map<std::string, std::string> HASH_LOOKUP_B64 = {
-    {"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA==", "9aX9QtFqIDAnmO9u0wmXm0MAPSMg2fDo6pgxqSdZ+0s="}, // 1
-    {"9aX9QtFqIDAnmO9u0wmXm0MAPSMg2fDo6pgxqSdZ+0v1pf1C0WogMCeY727TCZebQwA9IyDZ8OjqmDGpJ1n7Sw==", "21YRTgD91MH4XIkr81rJqJKJquyx69CpbN5ganSLXXE="}, // 2
-    {"21YRTgD91MH4XIkr81rJqJKJquyx69CpbN5ganSLXXHbVhFOAP3UwfhciSvzWsmokomq7LHr0Kls3mBqdItdcQ==", "x4AJ/fB/xWoR8SI3BlijU6qlQu1j5ExLwV/0zRBaszw="}, // 3
-    {"x4AJ/fB/xWoR8SI3BlijU6qlQu1j5ExLwV/0zRBaszzHgAn98H/FahHxIjcGWKNTqqVC7WPkTEvBX/TNEFqzPA==", "U22Yg38t0WWlXV7q6RSFlURy1W8kbfJWvzyuGTUqEjw="}, // 4
-    {"U22Yg38t0WWlXV7q6RSFlURy1W8kbfJWvzyuGTUqEjxTbZiDfy3RZaVdXurpFIWVRHLVbyRt8la/PK4ZNSoSPA==", "nv3gUqoVQp+uBbrU0LHXxk2mTQPXoYVKWIwsuEMMDTA="}, // 5
-    {"nv3gUqoVQp+uBbrU0LHXxk2mTQPXoYVKWIwsuEMMDTCe/eBSqhVCn64FutTQsdfGTaZNA9ehhUpYjCy4QwwNMA==", "2I3f7tQAqHVVlrIZQsFJfhFMMC5hGCkPkeZ3KXYEH6E="}, // 6
-    {"2I3f7tQAqHVVlrIZQsFJfhFMMC5hGCkPkeZ3KXYEH6HYjd/u1ACodVWWshlCwUl+EUwwLmEYKQ+R5ncpdgQfoQ==", "h+sN26V+NfbShmc4AqSvWXXiJQbHz0xku2vl7hFSfyw="}, // 7
-    {"h+sN26V+NfbShmc4AqSvWXXiJQbHz0xku2vl7hFSfyyH6w3bpX419tKGZzgCpK9ZdeIlBsfPTGS7a+XuEVJ/LA==", "JoRkdv1fxUpdQzhRZ8lRRPJkP1M8yFu50Wt4L419sZM="}, // 8
-    {"JoRkdv1fxUpdQzhRZ8lRRPJkP1M8yFu50Wt4L419sZMmhGR2/V/FSl1DOFFnyVFE8mQ/UzzIW7nRa3gvjX2xkw==", "UG2GWC0lJAW4QAGHksrSvxJZ8e9apfiH4Tyy8AlPUeE="}, // 9
-    {"UG2GWC0lJAW4QAGHksrSvxJZ8e9apfiH4Tyy8AlPUeFQbYZYLSUkBbhAAYeSytK/Elnx71ql+IfhPLLwCU9R4Q==", "//8K1+ZZdy+VNMGVyBXvxAFO8eHa7UQEwGOF0RGS6Ss="}, // 10
-    {"//8K1+ZZdy+VNMGVyBXvxAFO8eHa7UQEwGOF0RGS6Sv//wrX5ll3L5U0wZXIFe/EAU7x4drtRATAY4XREZLpKw==", "bPBBJ9sFRBzYMxB6Ur6FKGiJDkMX5qAqtHaDqnWWQiA="} // 11
-};
+// leaf는 tx 등을 SHA-256 한 값이고, MAX_MERKLE_LEAVES개가 안 되는 나머지는 0으로 채운 dummy leaf로 본다.
+// dummy로만 이루어진 subtree의 hash는 level별로 항상 같으므로(empty hash) 실제 leaf가 걸친 노드만 계산하고 저장한다.
+// 노드 번호는 leaf부터 root까지 level 순서로 매긴 기존 배치(0 ~ MAX_MERKLE_LEAVES * 2 - 2, root가 마지막)를 그대로 쓴다
+class StaticMerkleTree {
+public:
+  using node_type = std::array<uint8_t, 32>;
 
-static std::map<bytes, hash_t> HASH_LOOKUP = {};
-// clang-format on
+  static constexpr int TREE_HEIGHT = [] {
+    int height = 0;
+    while ((1u << height) < MAX_MERKLE_LEAVES)
+      ++height;
+    return height;
+  }();
+  static_assert((1u << TREE_HEIGHT) == MAX_MERKLE_LEAVES, "MAX_MERKLE_LEAVES must be a power of two");
+  static_assert(sizeof(node_type) == 32, "nodes of a level must be contiguous 32 byte hashes");
 
-class StaticMerkleTree {
 private:
-  vector<hash_t> m_merkle_tree;
+  // 실제 leaf가 걸친 노드들만 level 순서로 이어 담는다. level마다 앞쪽 m_real_num[level]개가 실제 노드이다
+  vector<node_type> m_nodes;
+  std::array<size_t, TREE_HEIGHT + 1> m_level_begin{};
+  std::array<size_t, TREE_HEIGHT + 1> m_real_num{};
 
 public:
   StaticMerkleTree() {
-    prepareLookUpTable();
+    generate({});
   }
 
-  StaticMerkleTree(vector<hash_t> &merkle_contents) {
-    prepareLookUpTable();
+  StaticMerkleTree(const vector<hash_t> &merkle_contents) {
     generate(merkle_contents);
   }
 
-  void generate(vector<hash_t> &merkle_contents) {
-    const bytes dummy_leaf(32, 0); // for SHA-256
+  void generate(const vector<hash_t> &merkle_contents) {
+    m_real_num[0] = min(MAX_MERKLE_LEAVES, static_cast<uint32_t>(merkle_contents.size()));
+    size_t node_num = 0;
+    for (int level = 0; level <= TREE_HEIGHT; ++level) {
+      if (level > 0)
+        m_real_num[level] = (m_real_num[level - 1] + 1) / 2;
+      m_level_begin[level] = node_num;
+      node_num += m_real_num[level];
+    }
+    m_nodes.resize(node_num); // 다시 generate 할 때는 capacity를 그대로 쓴다
 
-    auto min_addable_size = min(MAX_MERKLE_LEAVES, static_cast<uint32_t>(merkle_contents.size()));
+    for (size_t i = 0; i < m_real_num[0]; ++i) {
+      m_nodes[i].fill(0);
+      std::copy_n(merkle_contents[i].begin(), min(merkle_contents[i].size(), m_nodes[i].size()), m_nodes[i].begin());
+    }
 
-    for (int i = 0; i < min_addable_size; ++i)
-      m_merkle_tree[i] = merkle_contents[i];
+    // 한 level의 실제 노드들을 이어 담으면 그대로 다음 level의 64 byte 입력들이 되므로 MultiSha256으로 한꺼번에 계산한다.
+    // 실제 노드 수가 홀수면 마지막 노드는 empty hash와 짝지어 따로 계산한다
+    for (int level = 0; level < TREE_HEIGHT; ++level) {
+      size_t child_num = m_real_num[level];
+      node_type *children = m_nodes.data() + m_level_begin[level];
+      node_type *parents = m_nodes.data() + m_level_begin[level + 1];
+
+      if (child_num >= 2)
+        MultiSha256::hash64(children[0].data(), child_num / 2, parents[0].data());
+      if (child_num % 2 == 1) {
+        std::array<uint8_t, 64> last_pair;
+        std::copy(children[child_num - 1].begin(), children[child_num - 1].end(), last_pair.begin());
+        std::copy(getEmptyHash(level).begin(), getEmptyHash(level).end(), last_pair.begin() + 32);
+        MultiSha256::hash64(last_pair.data(), 1, parents[child_num / 2].data());
+      }
+    }
+  }
 
-    for (int i = min_addable_size; i < MAX_MERKLE_LEAVES; ++i)
-      m_merkle_tree[i] = dummy_leaf;
+  const node_type &getRoot() const {
+    return getNode(TREE_HEIGHT, 0);
+  }
 
-    int parent_pos = MAX_MERKLE_LEAVES;
-    for (int i = 0; i < MAX_MERKLE_LEAVES * 2 - 3; i += 2) {
-      m_merkle_tree[parent_pos] = makeParent(m_merkle_tree[i], m_merkle_tree[i + 1]);
-      ++parent_pos;
+  // 기존 배치의 노드 번호로 찾는다
+  const node_type &getNode(size_t node_idx) const {
+    int level = 0;
+    size_t level_size = MAX_MERKLE_LEAVES;
+    while (node_idx >= level_size && level < TREE_HEIGHT) {
+      node_idx -= level_size;
+      level_size /= 2;
+      ++level;
     }
+    return getNode(level, node_idx);
   }
 
-  vector<hash_t> getStaticMerkleTree() {
-    return m_merkle_tree;
+  const node_type &getNode(int level, size_t pos) const {
+    if (pos < m_real_num[level])
+      return m_nodes[m_level_begin[level] + pos];
+    return getEmptyHash(level);
+  }
+
+  // level 높이의 dummy로만 이루어진 subtree의 hash. level 0은 dummy leaf(0 x 32)
+  static const node_type &getEmptyHash(int level) {
+    static const std::array<node_type, TREE_HEIGHT + 1> empty_hashes = [] {
+      std::array<node_type, TREE_HEIGHT + 1> hashes{};
+      for (int i = 0; i < TREE_HEIGHT; ++i) {
+        std::array<uint8_t, 64> empty_pair;
+        std::copy(hashes[i].begin(), hashes[i].end(), empty_pair.begin());
+        std::copy(hashes[i].begin(), hashes[i].end(), empty_pair.begin() + 32);
+        MultiSha256::hash64(empty_pair.data(), 1, hashes[i + 1].data());
+      }
+      return hashes;
+    }();
+
+    return empty_hashes[level];
+  }
+
+  // 모든 노드를 기존 배치대로 펼친 것. 노드마다 vector를 만들므로 root만 필요하면 getRoot를 쓴다
+  vector<hash_t> getStaticMerkleTree() const {
+    vector<hash_t> merkle_tree;
+    merkle_tree.reserve(MAX_MERKLE_LEAVES * 2 - 1);
+    for (int level = 0; level <= TREE_HEIGHT; ++level) {
+      for (size_t pos = 0; pos < (MAX_MERKLE_LEAVES >> level); ++pos) {
+        const node_type &node = getNode(level, pos);
+        merkle_tree.emplace_back(node.begin(), node.end());
+      }
+    }
+    return merkle_tree;
   }
 
   static bool isValidSiblings(proof_type &proof,
@@ -122,30 +186,6 @@ public:
 
     return (root_val == mtree_root);
   }
-
-private:
-  void prepareLookUpTable() {
-    m_merkle_tree.resize(MAX_MERKLE_LEAVES * 2 - 1);
-
-    if (HASH_LOOKUP.size() != HASH_LOOKUP_B64.size()) {
-      HASH_LOOKUP.clear();
-      for (auto &hash_entry : HASH_LOOKUP_B64) {
-        HASH_LOOKUP.emplace(TypeConverter::stringToBytes(TypeConverter::decodeBase<64>(hash_entry.first)),
-                            TypeConverter::stringToBytes(TypeConverter::decodeBase<64>(hash_entry.second)));
-      }
-    }
-  }
-
-  hash_t makeParent(hash_t left, hash_t &right) {
-    left.insert(left.cend(), right.cbegin(), right.cend());
-
-    auto it_map = HASH_LOOKUP.find(left);
-    if (it_map != HASH_LOOKUP.end()) {
-      return it_map->second;
-    } else {
-      return Sha256::hash(left);
-    }
-  }
 };
 } // namespace tethys
 
@@ -1,17 +1,52 @@
-#pragma once
-#include "../structure/transaction.hpp"
-#include <map>
-#include <shared_mutex>
-#include <vector>
-
-namespace tethys {
-class TransactionPool {
-public:
-  void add(const Transaction &tx);
-  vector<Transaction> fetchAll();
-
-private:
-  std::map<string, Transaction> tx_pool;
-  std::shared_mutex pool_mutex;
-};
-}
\ No newline at end of file
+#pragma once
+#include "../config/storage_config.hpp"
+#include "../structure/transaction.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tethys {
+// txid의 hash로 shard를 나누고 shard마다 lock을 따로 두어, 여러 thread의 add가 서로 기다리지 않게 한다.
+// 전체 크기는 max_size, pool에 머무는 시간은 max_age로 제한한다
+class TransactionPool {
+public:
+  TransactionPool(size_t max_size = config::TX_POOL_MAX_SIZE, std::chrono::seconds max_age = config::TX_POOL_MAX_AGE,
+                  size_t shard_num = config::TX_POOL_SHARD_NUM);
+
+  // 이미 있거나 pool이 가득 차면 false
+  bool add(const Transaction &tx);
+  vector<Transaction> fetchAll();
+  // fee가 높은 순, 같으면 먼저 만들어진 순으로 최대 min(n, MAX_COLLECT_TRANSACTION_SIZE)개. 골라진 tx만 복사한다
+  vector<Transaction> fetchTop(size_t n = config::MAX_COLLECT_TRANSACTION_SIZE);
+
+  // 확정된 블록에 들어간 tx를 지운다
+  void remove(const vector<Transaction> &txs);
+  // max_age가 지난 tx를 지운다. 지운 개수를 돌려준다
+  size_t removeExpired();
+  size_t size() const;
+
+private:
+  struct PoolEntry {
+    Transaction tx;
+    std::chrono::steady_clock::time_point arrival_time;
+  };
+
+  struct Shard {
+    std::shared_mutex mutex;
+    std::unordered_map<base58_type, PoolEntry> txs;
+  };
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  std::atomic<size_t> m_size{0};
+  size_t m_max_size;
+  std::chrono::seconds m_max_age;
+
+  Shard &getShard(const base58_type &tx_id) {
+    return *m_shards[std::hash<base58_type>{}(tx_id) % m_shards.size()];
+  }
+};
+}
@@ -1,11 +1,16 @@
 #ifndef TETHYS_PUBLIC_MERGER_UNRESOLVED_BLOCK_POOL_HPP
 #define TETHYS_PUBLIC_MERGER_UNRESOLVED_BLOCK_POOL_HPP
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string_view>
 #include <time.h>
+#include <unordered_map>
 
 #include "../../../../lib/log/include/log.hpp"
 #include "../../../../lib/tethys-utils/src/time_util.hpp"
@@ -13,6 +18,7 @@
 #include "../config/storage_type.hpp"
 
 #include "../structure/block.hpp"
+#include "ledger_index.hpp"
 #include "mem_ledger.hpp"
 
 namespace tethys {
@@ -21,7 +27,7 @@ struct UnresolvedBlock {
   Block block;
   int32_t cur_vec_idx{-1};
   int32_t prev_vec_idx{-1};
-  int32_t ssig_sum{0};
+  int32_t ssig_sum{0}; // 이 블록과 후손 블록들의 SSig 수 합
   std::map<string, user_ledger_type> user_ledger_list;
   std::map<string, contract_ledger_type> contract_ledger_list;
   std::map<base58_type, user_attribute_type> user_attribute_list;
@@ -29,16 +35,47 @@ struct UnresolvedBlock {
   std::map<contract_id_type, contract_type> contract_list;
   bool is_processed{false};
 
+  // 이 블록부터 latest confirmed block 직전까지의 ledger를 모두 반영한 index. 부모 블록의 index와 구조를 공유한다
+  PersistentLedgerIndex<user_ledger_type> user_ledger_index;
+  PersistentLedgerIndex<contract_ledger_type> contract_ledger_index;
+
   UnresolvedBlock() = default;
   UnresolvedBlock(Block &block_, int cur_vec_idx_, int prev_vec_idx_)
       : block(block_), cur_vec_idx(cur_vec_idx_), prev_vec_idx(prev_vec_idx_) {}
 };
 
+// pool 안에서 블록의 위치. deque index는 height에서 구하므로 pop_front 후에도 값을 고칠 필요가 없다
+struct PoolPosition {
+  block_height_type block_height;
+  int32_t vec_idx;
+};
+
+// 부모 블록이 아직 들어오지 않아 pool에 넣지 못한 블록
+struct OrphanBlock {
+  Block block;
+  uint64_t arrival_seq;
+  std::chrono::steady_clock::time_point arrival_time;
+};
+
 class UnresolvedBlockPool {
 private:
   std::deque<std::vector<UnresolvedBlock>> m_block_pool; // deque[n] is tree's depth n; vector's blocks are same depth(block height)
   std::recursive_mutex m_push_mutex;
 
+  std::unordered_map<base58_type, PoolPosition> m_block_index; // block id -> pool 위치
+  uint32_t m_resolved_num_since_compaction{0};                 // ledger index를 마지막으로 다시 만든 뒤 확정된 블록 수
+
+  std::unordered_map<base58_type, OrphanBlock> m_orphan_blocks;           // block id -> orphan 블록
+  std::unordered_map<base58_type, vector<base58_type>> m_orphan_children; // 없는 부모 block id -> 그 부모를 기다리는 block id
+  std::deque<std::pair<uint64_t, base58_type>> m_orphan_arrival_order;    // 상한을 넘을 때 먼저 들어온 블록부터 버리기 위한 순서
+  uint64_t m_orphan_seq{0};
+  size_t m_orphan_tx_num{0};
+  uint64_t m_orphan_linked_num{0};
+  uint64_t m_orphan_evicted_num{0};
+  uint64_t m_orphan_expired_num{0};
+  double m_orphan_link_ms_sum{0};
+  double m_orphan_link_ms_max{0};
+
   base64_type m_latest_confirmed_id;
   block_height_type m_latest_confirmed_height;
   timestamp_t m_latest_confirmed_time;
@@ -66,19 +103,67 @@ public:
 
   UnresolvedBlock getUnresolvedBlock(const base58_type &block_id, const block_height_type block_height);
   UnresolvedBlock getUnresolvedBlock(int pool_deq_idx, int pool_vec_idx);
-  void setUnresolvedBlock(const UnresolvedBlock &unresolved_block);
+  // resolveBlock으로 블록의 위치가 바뀌므로, 위치를 들고 있는 쪽은 block id로 다시 찾는다
+  bool getBlockPoolInfo(const base58_type &block_id, block_height_type block_height, block_pool_info_type &pool_info);
+  block_pool_info_type getDeepestBlockInfo();
+  int getPrevVecIdx(int pool_deq_idx, int pool_vec_idx);
+
+  // (pool_deq_idx, pool_vec_idx) 블록에서 바라본 pid의 최신 ledger를 찾는다. pool에 없으면 false
+  bool findUserLedger(int pool_deq_idx, int pool_vec_idx, const string &pid, user_ledger_type &found_ledger);
+  bool findContractLedger(int pool_deq_idx, int pool_vec_idx, const string &pid, contract_ledger_type &found_ledger);
+
+  // (pool_deq_idx, pool_vec_idx) 위치의 블록 하나를 복사 없이 visitor에게 넘긴다.
+  template <typename Visitor>
+  void visitUnresolvedBlock(int pool_deq_idx, int pool_vec_idx, Visitor &&visitor) {
+    std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+    visitor(static_cast<const UnresolvedBlock &>(m_block_pool[pool_deq_idx][pool_vec_idx]));
+  }
+
+  // (pool_deq_idx, pool_vec_idx) 블록에서 시작하여 prev_vec_idx를 따라 latest confirmed block 직전까지 복사 없이 순회한다.
+  // visitor는 `bool(const UnresolvedBlock &)` 형태이며, false를 반환하면 순회를 멈춘다.
+  template <typename Visitor>
+  void traverseFromPoint(int pool_deq_idx, int pool_vec_idx, Visitor &&visitor) {
+    std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+
+    while (pool_deq_idx >= 0 && pool_deq_idx < static_cast<int>(m_block_pool.size())) {
+      if (pool_vec_idx < 0 || pool_vec_idx >= static_cast<int>(m_block_pool[pool_deq_idx].size()))
+        return;
+
+      const UnresolvedBlock &current_block = m_block_pool[pool_deq_idx][pool_vec_idx];
+      if (!visitor(current_block))
+        return;
+
+      pool_vec_idx = current_block.prev_vec_idx;
+      --pool_deq_idx;
+    }
+  }
+
+  bool setUnresolvedBlock(const UnresolvedBlock &unresolved_block);
   vector<int> getPath(const base58_type &block_id, const block_height_type block_height);
   Block &getLowestUnprocessedBlock(const block_pool_info_type &longest_chain_info);
 
   nlohmann::json getPoolBlockIds();
-  string serializeUserLedgerList(const UnresolvedBlock &unresolved_block);
-  string serializeContractLedgerList(const UnresolvedBlock &unresolved_block);
-  string serializeUserAttributeList(const UnresolvedBlock &unresolved_block);
-  string serializeUserCertList(const UnresolvedBlock &unresolved_block);
-  string serializeContractList(const UnresolvedBlock &unresolved_block);
+  // orphan pool의 크기와 지금까지 연결 / 버려진 수, 들어와서 연결되기까지 걸린 시간
+  nlohmann::json getOrphanStats();
+  // 블록 처리 결과(ledger 목록 5종)의 backup record. 버전, block id / height, 목록별 항목 수와 항목들을 길이와 함께 이어 쓴다
+  static string serializeBackupResult(const UnresolvedBlock &unresolved_block);
+  static bool deserializeBackupResult(std::string_view serialized_result, UnresolvedBlock &unresolved_block);
 
 private:
-  void updateTotalNumSSig();
+  bool isPushableHeight(block_height_type t_height);
+  void placeBlock(Block &new_block, int prev_vec_idx, block_pool_info_type &placed_info);
+  void addOrphan(Block &new_block, vector<base58_type> &evicted_ids);
+  void linkOrphans(const base58_type &parent_id, vector<block_pool_info_type> &linked_infos);
+  OrphanBlock takeOrphan(std::unordered_map<base58_type, OrphanBlock>::iterator orphan_it);
+  void dropDeadOrphans(vector<base58_type> &dropped_block_id);
+  void trimOrphanArrivalOrder();
+  void pruneUnlinkedBlocks(vector<base58_type> &dropped_block_id);
+  bool findBlockIdx(const base58_type &block_id, block_height_type block_height, int &pool_deq_idx, int &pool_vec_idx);
+  void addSSigToAncestors(int pool_deq_idx, int pool_vec_idx);
+  bool isValidIdx(int pool_deq_idx, int pool_vec_idx);
+  void buildLedgerIndex(int pool_deq_idx, int pool_vec_idx);
+  void rebuildLedgerIndexFrom(int pool_deq_idx, int pool_vec_idx);
+  void rebuildAllLedgerIndex();
 };
 
 } // namespace tethys
@@ -0,0 +1,52 @@
+#ifndef TETHYS_PUBLIC_MERGER_WORKER_POOL_HPP
+#define TETHYS_PUBLIC_MERGER_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tethys {
+
+// CPU 작업을 나눠 실행하기 위한 고정 크기 thread pool.
+// parallelFor를 호출한 thread도 작업을 가져가 실행하므로, 작업 안에서 다시 parallelFor를 호출해도 멈추지 않는다.
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t thread_num);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  size_t getThreadNum() const;
+
+  // task(0) ~ task(task_num - 1)을 실행하고 모두 끝날 때까지 기다린다
+  void parallelFor(size_t task_num, const std::function<void(size_t)> &task);
+
+private:
+  struct Batch {
+    const std::function<void(size_t)> *task;
+    size_t task_num;
+    std::atomic<size_t> next_idx{0};
+    std::atomic<size_t> done_num{0};
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+  };
+
+  void run();
+  bool runOneTask(Batch &batch);
+
+  std::deque<std::shared_ptr<Batch>> m_batches;
+  std::mutex m_batch_mutex;
+  std::condition_variable m_batch_cv;
+  bool m_stopping{false};
+  std::vector<std::thread> m_workers;
+};
+
+} // namespace tethys
+
+#endif // TETHYS_PUBLIC_MERGER_WORKER_POOL_HPP
@@ -6,28 +6,24 @@ namespace tethys {
 KvController::KvController() {
   logger::INFO("KV store initialize");
 
-  m_options.block_cache = leveldb::NewLRUCache(100 * 1048576); // 100MB cache
+  // data type마다 DB를 열면 cache, WAL, compaction thread도 그만큼 생기므로 하나의 DB와 cache를 함께 쓴다
+  m_options.block_cache = leveldb::NewLRUCache(config::KV_BLOCK_CACHE_SIZE);
   m_options.create_if_missing = true;
   m_write_options.sync = true;
 
   m_db_path = config::DEFAULT_KV_PATH;
   boost::filesystem::create_directories(m_db_path);
 
-  auto dir_names = config::keyValueDBNames();
-  for (auto &dir_name : dir_names) {
-    leveldb::DB *db;
-    errorOnCritical(leveldb::DB::Open(m_options, m_db_path + "/" + dir_name, &db));
-    db_map[dir_name] = db;
-
-    write_batch_map[dir_name] = leveldb::WriteBatch();
-  }
+  errorOnCritical(leveldb::DB::Open(m_options, m_db_path + "/" + config::KV_DB_NAME, &m_db));
+  migrateSeparateDBs();
 }
 
 KvController::~KvController() {
-  for (auto &[_, db_ptr] : db_map) {
-    delete db_ptr;
-    db_ptr = nullptr;
-  }
+  delete m_db;
+  m_db = nullptr;
+
+  delete m_options.block_cache;
+  m_options.block_cache = nullptr;
 }
 
 bool KvController::saveBuiltInContracts(map<string, string> &contracts) {
@@ -35,25 +31,19 @@ bool KvController::saveBuiltInContracts(map<string, string> &contracts) {
     addBatch(DataType::BUILT_IN_CONTRACT, contract.first, contract.second);
   }
 
-  commitBatchAll();
-
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveLatestWorldId(const alphanumeric_type &world_id) {
   addBatch(DataType::WORLD, "latest_world_id", world_id);
 
-  commitBatchAll();
-
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveLatestChainId(const alphanumeric_type &chain_id) {
   addBatch(DataType::CHAIN, "latest_chain_id", chain_id);
 
-  commitBatchAll();
-
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveWorld(world_type &world_info) {
@@ -93,8 +83,7 @@ bool KvController::saveWorld(world_type &world_info) {
   string tmp_jfee = world_info.join_fee;
   addBatch(DataType::WORLD, tmp_wid + "_tmp_jfee", tmp_jfee);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveChain(local_chain_type &chain_info) {
@@ -130,8 +119,7 @@ bool KvController::saveChain(local_chain_type &chain_info) {
   tk_addr_list.pop_back();
   addBatch(DataType::CHAIN, tmp_chid + "_tk_addr", tk_addr_list);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveSelfInfo(self_info_type &self_info) {
@@ -139,8 +127,7 @@ bool KvController::saveSelfInfo(self_info_type &self_info) {
   addBatch(DataType::SELF_INFO, "self_cert", self_info.cert);
   addBatch(DataType::SELF_INFO, "self_id", self_info.id);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
 const world_type KvController::loadCurrentWorld() {
@@ -192,7 +179,7 @@ string KvController::getValueByKey(const string &what, const string &key) {
   string value;
   leveldb::Status status;
 
-  status = db_map[what]->Get(m_read_options, key, &value);
+  status = m_db->Get(m_read_options, makeKey(what, key), &value);
 
   if (!status.ok())
     value = "";
@@ -200,98 +187,131 @@ string KvController::getValueByKey(const string &what, const string &key) {
 }
 
 void KvController::destroyDB() {
-  for (auto &[db_name, _] : db_map) {
-    boost::filesystem::remove_all(m_db_path + "/" + db_name);
-  }
+  boost::filesystem::remove_all(m_db_path + "/" + config::KV_DB_NAME);
 }
 
 bool KvController::saveBlockIds(const string &serialized_block_ids) {
   addBatch(DataType::UNRESOLVED_BLOCK_IDS_KEY, DataType::UNRESOLVED_BLOCK_IDS_KEY, serialized_block_ids);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
 bool KvController::saveBackupBlock(const base58_type &block_id, const string &serialized_block) {
   addBatch(DataType::BACKUP_BLOCK, block_id, serialized_block);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
-bool KvController::saveBackupUserLedgers(const base58_type &block_id, const string &serialized_user_ledgers) {
-  addBatch(DataType::BACKUP_USER_LEDGER, block_id, serialized_user_ledgers);
+bool KvController::saveBackupResult(const base58_type &block_id, const string &serialized_result) {
+  addBatch(DataType::BACKUP_RESULT, block_id, serialized_result);
 
-  commitBatchAll();
-  return true;
+  return commitBatch();
 }
 
-bool KvController::saveBackupContractLedgers(const base58_type &block_id, const string &serialized_contract_ledgers) {
-  addBatch(DataType::BACKUP_CONTRACT_LEDGER, block_id, serialized_contract_ledgers);
-
-  commitBatchAll();
-  return true;
+string KvController::loadBlockIds() {
+  return getValueByKey(DataType::UNRESOLVED_BLOCK_IDS_KEY, DataType::UNRESOLVED_BLOCK_IDS_KEY);
 }
 
-bool KvController::saveBackupUserAttributes(const base58_type &block_id, const string &serialized_user_attributes) {
-  addBatch(DataType::BACKUP_USER_ATTRIBUTE, block_id, serialized_user_attributes);
-
-  commitBatchAll();
-  return true;
+string KvController::loadBackupBlock(const std::string &key) {
+  return getValueByKey(DataType::BACKUP_BLOCK, key);
 }
 
-bool KvController::saveBackupUserCerts(const base58_type &block_id, const string &serialized_user_certs) {
-  addBatch(DataType::BACKUP_USER_CERT, block_id, serialized_user_certs);
-
-  commitBatchAll();
-  return true;
+string KvController::loadBackupResult(const std::string &key) {
+  return getValueByKey(DataType::BACKUP_RESULT, key);
 }
 
-bool KvController::saveBackupContracts(const base58_type &block_id, const string &serialized_contracts) {
-  addBatch(DataType::BACKUP_CONTRACT, block_id, serialized_contracts);
+// 여러 블록의 backup을 한 번의 batch로 지운다
+void KvController::delBackups(const vector<base58_type> &block_ids) {
+  bool deleted = false;
+  for (auto &each_block_id : block_ids) {
+    if (each_block_id.empty())
+      continue;
 
-  commitBatchAll();
-  return true;
-}
+    // delBatch(DataType::BACKUP_BLOCK, each_block_id);   // request query의 block.get에서 msg_block을 불러올 때 임시로 사용
+    delBatch(DataType::BACKUP_RESULT, each_block_id);
+    deleted = true;
+  }
 
-string KvController::loadBlockIds() {
-  return getValueByKey(DataType::UNRESOLVED_BLOCK_IDS_KEY, DataType::UNRESOLVED_BLOCK_IDS_KEY);
+  if (deleted)
+    commitBatch();
 }
 
-string KvController::loadBackupBlock(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_BLOCK, key);
+void KvController::beginGroupCommit() {
+  ++m_group_commit_depth;
 }
 
-string KvController::loadBackupUserLedgers(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_USER_LEDGER, key);
+bool KvController::endGroupCommit() {
+  if (m_group_commit_depth > 0)
+    --m_group_commit_depth;
+
+  return commitBatch();
 }
 
-string KvController::loadBackupContractLedgers(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_CONTRACT_LEDGER, key);
+bool KvController::saveStateCheckpoint(const string &key, const string &value, bool sync) {
+  leveldb::WriteOptions write_options;
+  write_options.sync = sync;
+
+  return errorOnCritical(m_db->Put(write_options, makeKey(DataType::STATE_CHECKPOINT, key), value));
 }
 
-string KvController::loadBackupUserAttributes(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_USER_ATTRIBUTE, key);
+string KvController::loadStateCheckpoint(const string &key) {
+  string value;
+
+  // snapshot은 여러 thread에서 나눠 읽는다. batch를 거치지 않고 DB에서 바로 읽으므로 함께 불려도 된다
+  if (!m_db->Get(m_read_options, makeKey(DataType::STATE_CHECKPOINT, key), &value).ok())
+    value = "";
+  return value;
 }
 
-string KvController::loadBackupUserCerts(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_USER_CERT, key);
+void KvController::delStateCheckpoint(const vector<string> &keys) {
+  leveldb::WriteBatch write_batch;
+  for (auto &each_key : keys) {
+    write_batch.Delete(makeKey(DataType::STATE_CHECKPOINT, each_key));
+  }
+
+  errorOnCritical(m_db->Write(m_write_options, &write_batch));
 }
 
-string KvController::loadBackupContracts(const std::string &key) {
-  return getValueByKey(DataType::BACKUP_CONTRACT, key);
+string KvController::makeKey(const string &what, const string &key) {
+  return what + ":" + key;
 }
 
-void KvController::delBackup(const base58_type &block_id) {
-  if (!block_id.empty()) {
-    // write_batch_map[DataType::BACKUP_BLOCK].Delete(block_id);   // request query의 block.get에서 msg_block을 불러올 때 임시로 사용
-    write_batch_map[DataType::BACKUP_USER_LEDGER].Delete(block_id);
-    write_batch_map[DataType::BACKUP_CONTRACT_LEDGER].Delete(block_id);
-    write_batch_map[DataType::BACKUP_USER_ATTRIBUTE].Delete(block_id);
-    write_batch_map[DataType::BACKUP_USER_CERT].Delete(block_id);
-    write_batch_map[DataType::BACKUP_CONTRACT].Delete(block_id);
+// data type마다 따로 쓰던 DB가 남아 있으면 key에 prefix를 붙여 하나의 DB로 옮기고 지운다
+void KvController::migrateSeparateDBs() {
+  for (auto &db_name : config::keyValueDBNames()) {
+    string separate_db_path = m_db_path + "/" + db_name;
+    if (!boost::filesystem::exists(separate_db_path))
+      continue;
+
+    leveldb::Options separate_options;
+    leveldb::DB *separate_db;
+    if (!errorOnCritical(leveldb::DB::Open(separate_options, separate_db_path, &separate_db)))
+      continue;
 
-    commitBatchAll();
+    leveldb::WriteBatch migrate_batch;
+    leveldb::Iterator *it = separate_db->NewIterator(m_read_options);
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      migrate_batch.Put(makeKey(db_name, it->key().ToString()), it->value());
+    }
+    bool migrated = it->status().ok() && errorOnCritical(m_db->Write(m_write_options, &migrate_batch));
+    delete it;
+    delete separate_db;
+
+    if (!migrated) {
+      logger::ERROR("KV: failed to migrate {} into {}", db_name, config::KV_DB_NAME);
+      continue;
+    }
+    boost::filesystem::remove_all(separate_db_path);
+    logger::INFO("KV: migrated {} into {}", db_name, config::KV_DB_NAME);
+  }
+
+  for (auto &db_name : config::retiredKeyValueDBNames()) {
+    string retired_db_path = m_db_path + "/" + db_name;
+    if (!boost::filesystem::exists(retired_db_path))
+      continue;
+
+    boost::filesystem::remove_all(retired_db_path);
+    logger::INFO("KV: removed retired {} (blocks without a result record are reprocessed)", db_name);
   }
 }
 
@@ -304,27 +324,30 @@ bool KvController::errorOnCritical(const leveldb::Status &status) {
   }
 }
 
-bool KvController::addBatch(string what, const string &key, const string &value) {
-  write_batch_map[what].Put(key, value);
+bool KvController::addBatch(const string &what, const string &key, const string &value) {
+  m_write_batch.Put(makeKey(what, key), value);
+  ++m_batch_op_num;
   return true;
 }
 
-void KvController::commitBatchAll() {
-  for (auto &[name, db_ptr] : db_map) {
-    db_ptr->Write(m_write_options, &write_batch_map[name]);
-  }
-
-  clearBatchAll();
+void KvController::delBatch(const string &what, const string &key) {
+  m_write_batch.Delete(makeKey(what, key));
+  ++m_batch_op_num;
 }
 
-void KvController::rollbackBatchAll() {
-  clearBatchAll();
+// 모아 둔 batch를 한 번의 sync write로 기록한다. group commit 중이면 endGroupCommit까지 미룬다
+bool KvController::commitBatch() {
+  if (m_group_commit_depth > 0 || m_batch_op_num == 0)
+    return true;
+
+  bool committed = errorOnCritical(m_db->Write(m_write_options, &m_write_batch));
+  rollbackBatch();
+  return committed;
 }
 
-void KvController::clearBatchAll() {
-  for (auto &[_, write_batch] : write_batch_map) {
-    write_batch.Clear();
-  }
+void KvController::rollbackBatch() {
+  m_write_batch.Clear();
+  m_batch_op_num = 0;
 }
 
 bool KvController::to_bool(const string &string_bool) {
@@ -1,4 +1,9 @@
 #include "include/mem_ledger.hpp"
+#include "config/storage_config.hpp"
+#include "include/worker_pool.hpp"
+
+#include <algorithm>
+#include <unordered_set>
 
 string toHex(int num) {
   string str_hex;
@@ -16,595 +21,958 @@ string valueToStr(vector<uint8_t> value) {
   return str;
 }
 
-// ostream& operator<<(ostream &os, vector<uint8_t> &value)
-//{
-//    os << valueToStr(value);
-//    return os;
-//}
-
 namespace tethys {
 
-StateNode::StateNode(const user_ledger_type &user_ledger) {
-  m_left = nullptr;
-  m_right = nullptr;
-  m_suffix = 0;
-  m_suffix_len = -1;
-  m_bin_path = 0;
-  makeValue(user_ledger);
-  // m_path = makePath(ledger);
-
-  m_user_ledger = make_shared<user_ledger_type>(user_ledger);
-}
-
-StateNode::StateNode(const contract_ledger_type &contract_ledger) {
-  m_left = nullptr;
-  m_right = nullptr;
-  m_suffix = 0;
-  m_suffix_len = -1;
-  m_bin_path = 0;
-  makeValue(contract_ledger);
-  // m_path = makePath(ledger);
-
-  m_contract_ledger = make_shared<contract_ledger_type>(contract_ledger);
-}
-
-void StateNode::makeValue(const user_ledger_type &user_ledger) {
-  BytesBuilder state_value_builder;
-  state_value_builder.append(user_ledger.pid);
-  state_value_builder.append(user_ledger.var_value);
+namespace {
 
-  string key = state_value_builder.getString();
-  makeValue(key);
+Botan::HashFunction &getStateHasher() {
+  thread_local std::unique_ptr<Botan::HashFunction> hasher(Botan::HashFunction::create("SHA-256"));
+  return *hasher;
 }
 
-void StateNode::makeValue(const contract_ledger_type &contract_ledger) {
-  BytesBuilder state_value_builder;
-  state_value_builder.append(contract_ledger.pid);
-  state_value_builder.append(contract_ledger.var_value);
+} // namespace
 
-  string key = state_value_builder.getString();
-  makeValue(key);
+StateTree::StateTree(StateHashVersion hash_version) : m_hash_version(hash_version) {
+  m_root = allocNode(); // root (dummy)
+  retainNode(m_root);
+  m_size = 0;
 }
 
-void StateNode::makeValue(string &key) {
-  m_hash_value = Sha256::hash(key);
+void StateTree::setWorkerPool(WorkerPool *worker_pool) {
+  m_worker_pool = worker_pool;
 }
 
-// uint32_t StateNode::makePath(LedgerRecord &ledger) {
-//  string value = valueToStr(Sha256::hash(ledger.pid));
-//  value = value.substr(value.length() - _SHA256_SPLIT - 1, value.length());
-//  uint32_t path = (uint32_t)strtoul(value.c_str(), 0, 16);
-//  uint32_t mask = (1 << _TREE_DEPTH) - 1;
-//
-//  return path & mask;
-//}
+// pid의 마지막 바이트부터 LSB 순서로 path의 0번 비트부터 채운다
+path_type StateTree::calPathFromPid(const string &pid) {
+  path_type bin_path;
+  int bit_pos = 0;
 
-void StateNode::reHash() {
-  string l_value = "", r_value = "";
+  for (auto i = pid.rbegin(); i != pid.rend() && bit_pos < _MAX_TREE_DEPTH; ++i) {
+    if (i == pid.rbegin() && *i == 0)
+      continue;
 
-  if (getLeft() != nullptr) {
-    l_value = TypeConverter::encodeBase<64>(getLeft()->getValue());
-  }
-  if (getRight() != nullptr) {
-    r_value = TypeConverter::encodeBase<64>(getRight()->getValue());
+    for (int bit = 0; bit < 8 && bit_pos < _MAX_TREE_DEPTH; ++bit) {
+      bin_path[bit_pos++] = ((*i >> bit) & 0x01) != 0;
+    }
   }
 
-  reHash(l_value, r_value);
+  return bin_path;
 }
 
-void StateNode::reHash(string l_value, string r_value) {
-  if (l_value == "")
-    makeValue(r_value);
-  else if (r_value == "")
-    makeValue(l_value);
-  else {
-    string combined_value = l_value + r_value;
-    makeValue(combined_value);
-  }
+// depth 0 ~ _TREE_DEPTH-1 에서는 path의 (_TREE_DEPTH-1) ~ 0번 비트를, 그 아래에서는 나머지 상위 비트를 위에서부터 사용한다.
+// 앞쪽 _TREE_DEPTH 비트 안에서 구분되는 pid들의 위치는 기존 트리와 같다.
+bool StateTree::getDirectionOf(const path_type &path, int depth) {
+  int bit_pos = (depth < _TREE_DEPTH) ? (_TREE_DEPTH - 1 - depth) : (_MAX_TREE_DEPTH - 1 - (depth - _TREE_DEPTH));
+  return path[bit_pos];
 }
 
-// 노드 삭제 시 부모 노드로 이동하여 변경되는 path 와 suffix, suffix_len 의 내용을 반영
-// 1. path 의 LSB 에서 suffix_len 번째 비트를 저장
-// 2. suffix 의 LSB 에서 suffix_len 번째 비트에 저장된 비트를 넣고 suffix_len 1 증가
-void StateNode::moveToParent() {
-  int bit;
-  // 예외 처리
-  if (m_suffix_len == _TREE_DEPTH) {
-    logger::ERROR("StateNode::moveToParent has some error");
-    return;
+state_node_idx_type StateTree::allocNode() {
+  if (!m_free_nodes.empty()) {
+    state_node_idx_type node_idx = m_free_nodes.back();
+    m_free_nodes.pop_back();
+    m_nodes[node_idx] = StateNode{};
+    return node_idx;
   }
-  path_type tmp = m_bin_path;
-  tmp &= (1 << m_suffix_len);
 
-  bit = tmp != 0 ? 1 : 0;
-  m_suffix |= (bit << m_suffix_len);
-  ++m_suffix_len;
+  m_nodes.emplace_back();
+  return static_cast<state_node_idx_type>(m_nodes.size() - 1);
 }
 
-bool StateNode::isDummy() {
-  return (m_bin_path == 0);
+void StateTree::freeNode(state_node_idx_type node_idx) {
+  m_free_nodes.push_back(node_idx);
 }
 
-path_type StateNode::calPathFromPid(const string &pid) {
-  vector<bool> bool_vector;
-  path_type bin_path;
+void StateTree::retainNode(state_node_idx_type node_idx) {
+  ++m_nodes[node_idx].ref_count;
+}
 
-  for (auto i = pid.rbegin(); i != pid.rend(); ++i) {
-    if (i == pid.rbegin() && *i == 0)
-      continue;
-    bool_vector.emplace_back(*i & 0x01);
-    bool_vector.emplace_back(*i & 0x02);
-    bool_vector.emplace_back(*i & 0x04);
-    bool_vector.emplace_back(*i & 0x08);
-    bool_vector.emplace_back(*i & 0x10);
-    bool_vector.emplace_back(*i & 0x20);
-    bool_vector.emplace_back(*i & 0x40);
-    bool_vector.emplace_back(*i & 0x80);
-  }
+// 참조가 없어진 노드는 자식들의 참조를 놓고 회수한다
+void StateTree::releaseNode(state_node_idx_type node_idx) {
+  StateNode &node = m_nodes[node_idx];
+  if (--node.ref_count > 0)
+    return;
 
-  for (int i = 0; i < bool_vector.size(); ++i) {
-    bin_path[i] = bool_vector[i];
+  if (node.isLeaf()) {
+    freeLeaf(node.ledger_idx);
+  } else {
+    state_node_idx_type left = node.left, right = node.right;
+    if (left != NIL_NODE_IDX)
+      releaseNode(left);
+    if (right != NIL_NODE_IDX)
+      releaseNode(right);
   }
+  freeNode(node_idx);
+}
 
-  return bin_path;
+// 내부 노드를 복사한다. 복사본도 같은 자식을 가리키므로 자식의 참조가 늘어난다
+state_node_idx_type StateTree::copyNode(state_node_idx_type node_idx) {
+  state_node_idx_type new_node_idx = allocNode(); // m_nodes가 재할당될 수 있으므로 참조는 이후에 얻는다
+  StateNode &new_node = m_nodes[new_node_idx];
+  new_node = m_nodes[node_idx];
+  new_node.ref_count = 0;
+  new_node.dirty = false;
+
+  if (new_node.left != NIL_NODE_IDX)
+    retainNode(new_node.left);
+  if (new_node.right != NIL_NODE_IDX)
+    retainNode(new_node.right);
+
+  return new_node_idx;
 }
 
-void StateNode::setLeft(shared_ptr<StateNode> node) {
-  m_left = node;
+state_node_idx_type StateTree::makeWritableRoot() {
+  if (m_nodes[m_root].ref_count == 1)
+    return m_root;
+
+  state_node_idx_type new_root = copyNode(m_root);
+  retainNode(new_root);
+  releaseNode(m_root);
+  m_root = new_root;
+  return m_root;
 }
 
-void StateNode::setRight(shared_ptr<StateNode> node) {
-  m_right = node;
+// 쓰기 가능한 부모 아래의 내부 노드를 쓰기 가능하게 만든다. 다른 version과 공유 중이면 복사해서 부모에 연결한다
+state_node_idx_type StateTree::makeWritableChild(state_node_idx_type parent_idx, bool dir) {
+  state_node_idx_type child_idx = childOf(parent_idx, dir);
+  if (m_nodes[child_idx].ref_count == 1)
+    return child_idx;
+
+  state_node_idx_type new_child_idx = copyNode(child_idx);
+  retainNode(new_child_idx);
+  childOf(parent_idx, dir) = new_child_idx;
+  releaseNode(child_idx);
+  return new_child_idx;
 }
 
-void StateNode::setSuffix(const path_type &path, int pos) {
-  path_type mask;
-  for (int i = 0; i < pos; ++i) {
-    mask[i] = 1;
+template <typename T>
+state_node_idx_type StateTree::newLeafNode(const T &ledger) {
+  state_node_idx_type new_leaf_idx = allocLeaf(ledger);
+  state_node_idx_type new_node_idx = allocNode();
+  m_nodes[new_node_idx].ledger_idx = new_leaf_idx;
+  retainNode(new_node_idx);
+  makeLeafValue(new_node_idx);
+  return new_node_idx;
+}
+
+state_node_idx_type StateTree::allocLeaf(const user_ledger_type &user_ledger) {
+  state_node_idx_type leaf_idx;
+  if (!m_free_user_leaves.empty()) {
+    leaf_idx = m_free_user_leaves.back();
+    m_free_user_leaves.pop_back();
+  } else {
+    m_user_leaves.emplace_back();
+    leaf_idx = static_cast<state_node_idx_type>(m_user_leaves.size() - 1);
   }
 
-  path_type tmp = path;
-  tmp &= mask;
-  m_suffix = tmp;
-  m_suffix_len = pos;
+  m_user_leaves[leaf_idx].path = calPathFromPid(user_ledger.pid);
+  m_user_leaves[leaf_idx].ledger = user_ledger;
+  return leaf_idx;
 }
 
-void StateNode::setBinPath(const string &pid) {
-  m_bin_path = calPathFromPid(pid);
-}
+state_node_idx_type StateTree::allocLeaf(const contract_ledger_type &contract_ledger) {
+  state_node_idx_type leaf_idx;
+  if (!m_free_contract_leaves.empty()) {
+    leaf_idx = m_free_contract_leaves.back();
+    m_free_contract_leaves.pop_back();
+  } else {
+    m_contract_leaves.emplace_back();
+    leaf_idx = static_cast<state_node_idx_type>(m_contract_leaves.size() - 1);
+  }
 
-void StateNode::setNodeInfo(shared_ptr<StateNode> new_node) {
-  shared_ptr<user_ledger_type> new_user_ledger = new_node->getUserLedgerPtr();
-  shared_ptr<contract_ledger_type> new_contract_ledger = new_node->getContractLedgerPtr();
+  m_contract_leaves[leaf_idx].path = calPathFromPid(contract_ledger.pid);
+  m_contract_leaves[leaf_idx].ledger = contract_ledger;
+  return leaf_idx | CONTRACT_LEDGER_FLAG;
+}
 
-  if (new_user_ledger != nullptr) {
-    m_user_ledger = new_user_ledger;
-    makeValue(new_node->getUserLedger());
-  } else if (new_contract_ledger != nullptr) {
-    m_contract_ledger = new_contract_ledger;
-    makeValue(new_node->getContractLedger());
+void StateTree::freeLeaf(state_node_idx_type ledger_idx) {
+  if (ledger_idx & CONTRACT_LEDGER_FLAG) {
+    state_node_idx_type leaf_idx = ledger_idx & ~CONTRACT_LEDGER_FLAG;
+    m_contract_leaves[leaf_idx].ledger = contract_ledger_type{};
+    m_free_contract_leaves.push_back(leaf_idx);
+  } else {
+    m_user_leaves[ledger_idx].ledger = user_ledger_type{};
+    m_free_user_leaves.push_back(ledger_idx);
   }
 }
 
-void StateNode::overwriteNode(shared_ptr<StateNode> node) {
-  m_left = nullptr;
-  m_right = nullptr;
-  m_hash_value = node->getValue();
-  m_suffix = node->getSuffix();
-  m_suffix_len = node->getSuffixLen();
-  m_bin_path = node->getBinPath();
-  m_user_ledger = node->getUserLedgerPtr();
-  m_contract_ledger = node->getContractLedgerPtr();
-  moveToParent(); // suffix, suffix_len, path 값 수정
+void StateTree::setLeafLedger(state_node_idx_type ledger_idx, const user_ledger_type &user_ledger) {
+  m_user_leaves[ledger_idx].ledger = user_ledger;
+}
 
-  node.reset();
+void StateTree::setLeafLedger(state_node_idx_type ledger_idx, const contract_ledger_type &contract_ledger) {
+  m_contract_leaves[ledger_idx & ~CONTRACT_LEDGER_FLAG].ledger = contract_ledger;
 }
 
-string StateNode::getPid() {
-  return m_pid;
+const path_type &StateTree::getLeafPath(state_node_idx_type ledger_idx) const {
+  if (ledger_idx & CONTRACT_LEDGER_FLAG)
+    return m_contract_leaves[ledger_idx & ~CONTRACT_LEDGER_FLAG].path;
+  return m_user_leaves[ledger_idx].path;
 }
 
-shared_ptr<StateNode> StateNode::getLeft() {
-  return m_left;
+const string &StateTree::getLeafPid(state_node_idx_type ledger_idx) const {
+  if (ledger_idx & CONTRACT_LEDGER_FLAG)
+    return m_contract_leaves[ledger_idx & ~CONTRACT_LEDGER_FLAG].ledger.pid;
+  return m_user_leaves[ledger_idx].ledger.pid;
 }
 
-shared_ptr<StateNode> StateNode::getRight() {
-  return m_right;
+const string &StateTree::getLeafValue(state_node_idx_type ledger_idx) const {
+  if (ledger_idx & CONTRACT_LEDGER_FLAG)
+    return m_contract_leaves[ledger_idx & ~CONTRACT_LEDGER_FLAG].ledger.var_value;
+  return m_user_leaves[ledger_idx].ledger.var_value;
 }
 
-path_type StateNode::getSuffix() {
-  return m_suffix;
+state_node_idx_type &StateTree::childOf(state_node_idx_type node_idx, bool dir) {
+  return dir ? m_nodes[node_idx].right : m_nodes[node_idx].left;
 }
 
-int StateNode::getSuffixLen() {
-  return m_suffix_len;
+// leaf의 hash는 sha256(pid + var_value)
+state_hash_type StateTree::hashLeaf(StateHashVersion hash_version, const string &pid, const string &var_value) {
+  state_hash_type hash_value;
+
+  if (hash_version == StateHashVersion::BINARY) {
+    Botan::HashFunction &hasher = getStateHasher();
+    hasher.update(reinterpret_cast<const uint8_t *>(pid.data()), pid.size());
+    hasher.update(reinterpret_cast<const uint8_t *>(var_value.data()), var_value.size());
+    hasher.final(hash_value.data());
+    return hash_value;
+  }
+
+  BytesBuilder state_value_builder;
+  state_value_builder.append(pid);
+  state_value_builder.append(var_value);
+
+  vector<uint8_t> hash_bytes = Sha256::hash(state_value_builder.getString());
+  std::copy(hash_bytes.begin(), hash_bytes.end(), hash_value.begin());
+  return hash_value;
+}
+
+// BASE64_CONCAT : sha256(base64(left) + base64(right)). 한쪽 자식만 있으면 그 자식의 base64만 사용한다
+// BINARY : sha256(left || right). 없는 자식은 32 byte 0으로 채워 항상 64 byte를 hash한다
+// 없는 자식은 nullptr
+state_hash_type StateTree::hashBranch(StateHashVersion hash_version, const state_hash_type *left, const state_hash_type *right) {
+  state_hash_type hash_value;
+
+  if (hash_version == StateHashVersion::BINARY) {
+    static const state_hash_type empty_hash{};
+    Botan::HashFunction &hasher = getStateHasher();
+    hasher.update((left != nullptr ? *left : empty_hash).data(), empty_hash.size());
+    hasher.update((right != nullptr ? *right : empty_hash).data(), empty_hash.size());
+    hasher.final(hash_value.data());
+    return hash_value;
+  }
+
+  string l_value = "", r_value = "";
+
+  if (left != nullptr) {
+    l_value = TypeConverter::encodeBase<64>(*left);
+  }
+  if (right != nullptr) {
+    r_value = TypeConverter::encodeBase<64>(*right);
+  }
+
+  vector<uint8_t> hash_bytes = Sha256::hash(l_value + r_value);
+  std::copy(hash_bytes.begin(), hash_bytes.end(), hash_value.begin());
+  return hash_value;
 }
 
-vector<uint8_t> StateNode::getValue() {
-  return m_hash_value;
+void StateTree::makeLeafValue(state_node_idx_type node_idx) {
+  StateNode &node = m_nodes[node_idx];
+  node.hash_value = hashLeaf(m_hash_version, getLeafPid(node.ledger_idx), getLeafValue(node.ledger_idx));
 }
 
-path_type StateNode::getBinPath() {
-  return m_bin_path;
+void StateTree::reHash(state_node_idx_type node_idx) {
+  StateNode &node = m_nodes[node_idx];
+  node.hash_value = hashBranch(m_hash_version, (node.left != NIL_NODE_IDX) ? &m_nodes[node.left].hash_value : nullptr,
+                               (node.right != NIL_NODE_IDX) ? &m_nodes[node.right].hash_value : nullptr);
 }
 
-const user_ledger_type &StateNode::getUserLedger() const {
-  return *m_user_ledger.get();
+void StateTree::markDirty(const vector<state_node_idx_type> &path_nodes) {
+  for (auto node_idx : path_nodes) {
+    m_nodes[node_idx].dirty = true;
+  }
 }
 
-const contract_ledger_type &StateNode::getContractLedger() const {
-  return *m_contract_ledger.get();
+// dirty인 노드만 따라 내려가서 아래쪽부터 한 번씩 re-hashing
+void StateTree::reHashDirty(state_node_idx_type node_idx) {
+  StateNode &node = m_nodes[node_idx];
+  if (!node.dirty)
+    return;
+
+  if (node.left != NIL_NODE_IDX)
+    reHashDirty(node.left);
+  if (node.right != NIL_NODE_IDX)
+    reHashDirty(node.right);
+
+  reHash(node_idx);
+  m_nodes[node_idx].dirty = false;
 }
 
-shared_ptr<user_ledger_type> StateNode::getUserLedgerPtr() const {
-  return m_user_ledger;
+// split depth의 dirty 노드들은 서로 겹치지 않으므로 각 subtree를 따로 re-hashing 한 뒤, 그 위쪽만 마저 계산한다
+void StateTree::reHashDirtyTree(size_t updated_num) {
+  if (m_worker_pool == nullptr || updated_num < config::STATE_TREE_PARALLEL_MIN_UPDATES) {
+    reHashDirty(m_root);
+    return;
+  }
+
+  vector<state_node_idx_type> split_nodes;
+  collectDirtySplitNodes(m_root, 0, split_nodes);
+  m_worker_pool->parallelFor(split_nodes.size(), [this, &split_nodes](size_t i) { reHashDirty(split_nodes[i]); });
+
+  reHashDirty(m_root);
 }
 
-shared_ptr<contract_ledger_type> StateNode::getContractLedgerPtr() const {
-  return m_contract_ledger;
+void StateTree::collectDirtySplitNodes(state_node_idx_type node_idx, int depth, vector<state_node_idx_type> &split_nodes) const {
+  const StateNode &node = m_nodes[node_idx];
+  if (!node.dirty)
+    return;
+
+  if (depth == config::STATE_TREE_SPLIT_DEPTH) {
+    split_nodes.push_back(node_idx);
+    return;
+  }
+
+  if (node.left != NIL_NODE_IDX)
+    collectDirtySplitNodes(node.left, depth + 1, split_nodes);
+  if (node.right != NIL_NODE_IDX)
+    collectDirtySplitNodes(node.right, depth + 1, split_nodes);
 }
 
-// false: left, true: right
-bool StateTree::getDirectionOf(const path_type &path, int pos) {
-  path_type tmp = path;
-  tmp &= (1 << pos);
-  return tmp != 0;
+// root에서 pid의 path를 따라 내려가며 leaf를 찾는다. path_nodes에는 root부터 leaf의 부모까지가 담긴다
+state_node_idx_type StateTree::findLeaf(const string &pid, vector<state_node_idx_type> &path_nodes) const {
+  return findLeaf(m_root, pid, path_nodes);
 }
 
-void StateTree::visit(shared_ptr<StateNode> node, bool isPrint) {
-  string str_dir = !_debug_dir ? "Left" : "Right";
-  if (!node->isDummy()) {
-    if (isPrint) {
-      printf("%s%s\t", _debug_str_dir.substr(0, _debug_depth).c_str(), str_dir.c_str());
-      printf("[path: %s] suffix_len: %d, suffix: %s,  hash_value: %s\n", node->getBinPath(), node->getSuffixLen(), node->getSuffix(),
-             TypeConverter::encodeBase<64>(node->getValue()).c_str());
-    }
-    stk.push(node);
+state_node_idx_type StateTree::findLeaf(state_node_idx_type root_idx, const string &pid, vector<state_node_idx_type> &path_nodes) const {
+  path_type path = calPathFromPid(pid);
+  path_nodes.clear();
+
+  state_node_idx_type node_idx = root_idx;
+  for (int depth = 0; depth < _MAX_TREE_DEPTH; ++depth) {
+    path_nodes.push_back(node_idx);
+
+    const StateNode &node = m_nodes[node_idx];
+    state_node_idx_type child_idx = getDirectionOf(path, depth) ? node.right : node.left;
+    if (child_idx == NIL_NODE_IDX)
+      return NIL_NODE_IDX;
+
+    if (m_nodes[child_idx].isLeaf())
+      return (getLeafPid(m_nodes[child_idx].ledger_idx) == pid) ? child_idx : NIL_NODE_IDX;
+
+    node_idx = child_idx;
   }
-  --_debug_depth;
+
+  return NIL_NODE_IDX;
 }
-// tree post-order 순회 재귀함수
-void StateTree::postOrder(shared_ptr<StateNode> node, bool isPrint) {
-  if (isPrint) {
-    ++_debug_depth;
-    string str_dir = (!_debug_dir) ? "Left" : "Right";
-    printf("%s[depth %3d] %s\n", _debug_str_depth.substr(0, _debug_depth * 2).c_str(), _debug_depth, str_dir.c_str());
-  }
-  if (node->getLeft() != nullptr) {
-    _debug_dir = false;
-    postOrder(node->getLeft(), isPrint);
-  }
-  if (node->getRight() != nullptr) {
-    _debug_dir = true;
-    postOrder(node->getRight(), isPrint);
+
+template <typename T>
+void StateTree::insertLeaf(const T &ledger) {
+  path_type new_path = calPathFromPid(ledger.pid);
+  vector<state_node_idx_type> path_nodes;
+
+  // 지나가는 내부 노드는 모두 쓰기 가능하게 (공유 중이면 복사) 만든다
+  state_node_idx_type node_idx = makeWritableRoot();
+  int depth = 0;
+
+  // 머클 루트에서 시작하여 삽입하려는 노드의 경로 (new_path) 를 따라 한칸씩 내려감.
+  while (true) {
+    path_nodes.push_back(node_idx);
+
+    bool dir = getDirectionOf(new_path, depth); // false: left, true: right
+    state_node_idx_type child_idx = childOf(node_idx, dir);
+
+    // 내려가려는 위치가 비어 있으면 해당 위치에 노드를 삽입
+    if (child_idx == NIL_NODE_IDX) {
+      state_node_idx_type new_node_idx = newLeafNode(ledger);
+      childOf(node_idx, dir) = new_node_idx;
+      ++m_size;
+      break;
+    }
+
+    if (!m_nodes[child_idx].isLeaf()) {
+      node_idx = makeWritableChild(node_idx, dir);
+      ++depth;
+      continue;
+    }
+
+    // 같은 pid이면 값만 바꾼다. 다른 version과 공유 중인 leaf는 새 leaf로 교체
+    state_node_idx_type old_ledger_idx = m_nodes[child_idx].ledger_idx;
+    if (getLeafPid(old_ledger_idx) == ledger.pid) {
+      if (m_nodes[child_idx].ref_count == 1) {
+        setLeafLedger(old_ledger_idx, ledger);
+        makeLeafValue(child_idx);
+      } else {
+        state_node_idx_type new_node_idx = newLeafNode(ledger);
+        childOf(node_idx, dir) = new_node_idx;
+        releaseNode(child_idx);
+      }
+      break;
+    }
+
+    // 기존 노드와 충돌 -> 두 경로가 갈라질 때까지 dummy 노드를 만들고, 갈라지는 위치에 각각 삽입
+    path_type old_path = getLeafPath(old_ledger_idx);
+    if (old_path == new_path) {
+      logger::ERROR("StateTree::insertNode() collision unsolved.");
+      return;
+    }
+
+    // 기존 leaf는 부모 대신 새 dummy가 가리키므로 참조 수는 그대로
+    state_node_idx_type old_node_idx = child_idx;
+    state_node_idx_type parent_idx = node_idx;
+    bool parent_dir = dir;
+
+    while (true) {
+      ++depth;
+      state_node_idx_type dummy_idx = allocNode();
+      retainNode(dummy_idx);
+      childOf(parent_idx, parent_dir) = dummy_idx;
+      path_nodes.push_back(dummy_idx);
+
+      bool new_dir = getDirectionOf(new_path, depth);
+      if (new_dir != getDirectionOf(old_path, depth)) {
+        state_node_idx_type new_node_idx = newLeafNode(ledger);
+        childOf(dummy_idx, new_dir) = new_node_idx;
+        childOf(dummy_idx, !new_dir) = old_node_idx;
+        ++m_size;
+        break;
+      }
+
+      parent_idx = dummy_idx;
+      parent_dir = new_dir;
+    }
+    break;
   }
-  visit(node, isPrint);
+
+  // 지나온 경로는 나중에 머클 루트까지 re-hashing
+  markDirty(path_nodes);
 }
 
 void StateTree::updateUserState(const vector<user_ledger_type> &user_ledger_list) {
   for (auto &each_ledger : user_ledger_list) {
-    this->insertNode(each_ledger);
+    insertLeaf(each_ledger);
   }
+  reHashDirtyTree(user_ledger_list.size());
 }
 
 void StateTree::updateUserState(const map<string, user_ledger_type> &user_ledger_list) {
   for (auto &each_ledger : user_ledger_list) {
-    this->insertNode(each_ledger.second);
+    insertLeaf(each_ledger.second);
   }
+  reHashDirtyTree(user_ledger_list.size());
 }
 
 void StateTree::updateContractState(const vector<contract_ledger_type> &contract_ledger_list) {
   for (auto &each_ledger : contract_ledger_list) {
-    this->insertNode(each_ledger);
+    insertLeaf(each_ledger);
   }
+  reHashDirtyTree(contract_ledger_list.size());
 }
 
 void StateTree::updateContractState(const map<string, contract_ledger_type> &contract_ledger_list) {
   for (auto &each_ledger : contract_ledger_list) {
-    this->insertNode(each_ledger.second);
+    insertLeaf(each_ledger.second);
   }
+  reHashDirtyTree(contract_ledger_list.size());
 }
 
-template <typename T>
-void StateTree::insertNode(const T &ledger) {
-  string pid = ledger.pid;
-  StateNode new_node(ledger);
-  shared_ptr<StateNode> new_node_ptr = make_shared<StateNode>(new_node);
+void StateTree::insertNode(const user_ledger_type &user_ledger) {
+  insertLeaf(user_ledger);
+  reHashDirty(m_root);
+}
 
-  new_node_ptr->setBinPath(pid);
-  path_type new_path = new_node_ptr->getBinPath();
+void StateTree::insertNode(const contract_ledger_type &contract_ledger) {
+  insertLeaf(contract_ledger);
+  reHashDirty(m_root);
+}
 
-  shared_ptr<StateNode> node = root;
-  shared_ptr<StateNode> prev_node = nullptr;
+void StateTree::removeNode(const string &pid) {
+  vector<state_node_idx_type> path_nodes;
+  state_node_idx_type leaf_node_idx = findLeaf(pid, path_nodes);
+  if (leaf_node_idx == NIL_NODE_IDX)
+    return;
 
-  bool collision = false;
-  bool dir;
-  int dir_pos = _TREE_DEPTH - 1;
-  int depth = 1;
+  // 경로의 노드를 root부터 쓰기 가능하게 만든다
+  path_type path = calPathFromPid(pid);
+  path_nodes[0] = makeWritableRoot();
+  for (int depth = 1; depth < path_nodes.size(); ++depth) {
+    path_nodes[depth] = makeWritableChild(path_nodes[depth - 1], getDirectionOf(path, depth - 1));
+  }
 
-  while (!stk.empty())
-    stk.pop(); // 스택 clear
+  // 해당 노드 삭제
+  childOf(path_nodes.back(), getDirectionOf(path, path_nodes.size() - 1)) = NIL_NODE_IDX;
+  releaseNode(leaf_node_idx);
+  --m_size;
 
-  // 머클 루트에서 시작하여 삽입하려는 노드의 경로 (new_path) 를 따라 한칸씩 내려감.
-  while (true) {
-    // 내려간 노드가 dummy 가 아닌 경우 (데이터를 가진 노드일 경우) 충돌 발샐
-    if (!node->isDummy()) {
-      collision = true;
-      break;
-    }
-    // 노드 삽입 후 해당 노드에서 머클 루트까지 re-hashing 용도
-    stk.push(node);
-
-    // 내려가려는 위치의 노드가 nullptr 인 경우, 해당 위치에 노드를 삽입하고 탈출
-    dir = getDirectionOf(new_path, dir_pos); // false: left, true: right
-    if (!dir && (node->getLeft() == nullptr)) {
-      node->setLeft(new_node_ptr);
-      new_node_ptr->setSuffix(new_path, dir_pos);
-      break;
-    } else if (dir && (node->getRight() == nullptr)) {
-      node->setRight(new_node_ptr);
-      new_node_ptr->setSuffix(new_path, dir_pos);
+  // 머클 루트까지 올라가며 노드 정리. 자식이 없는 dummy는 지우고, leaf 하나만 남은 dummy는 그 leaf로 대체한다
+  while (path_nodes.size() > 1) {
+    state_node_idx_type node_idx = path_nodes.back();
+    StateNode &node = m_nodes[node_idx];
+
+    state_node_idx_type replacement = NIL_NODE_IDX;
+    if (node.left != NIL_NODE_IDX && node.right != NIL_NODE_IDX)
       break;
-    }
-      // path 로 진행하는 방향에 노드가 존재하면 계속해서 내려감
-    else {
-      if (!dir) {
-        prev_node = node;
-        node = node->getLeft();
-      } else {
-        prev_node = node;
-        node = node->getRight();
-      }
+    else if (node.left != NIL_NODE_IDX) {
+      if (!m_nodes[node.left].isLeaf())
+        break;
+      replacement = node.left;
+    } else if (node.right != NIL_NODE_IDX) {
+      if (!m_nodes[node.right].isLeaf())
+        break;
+      replacement = node.right;
     }
 
-    --dir_pos;
-    ++depth;
-  }
-  // case: 기존 노드와 충돌 났을 경우 -> 기존 노드와 새 노드 모두 적절한 위치에 삽입 필요
-  // prev_node : 부모 노드, dummy : 충돌난 곳에 삽입할 더미 노드
-  // old_node : 충돌난 곳에 있던 기존 노드, new_node : 삽입하려는 새 노드
-  // old_path : 기존 노드의 경로, new_path : 새 노드의 경로
-  if (collision) {
-    shared_ptr<StateNode> old_node;
-    path_type old_path;
-    shared_ptr<StateNode> dummy;
-
-    old_node = node;
-    old_path = old_node->getBinPath();
-
-    if (old_node->getPid() == new_node_ptr->getPid())
-      modifyNode(old_node, new_node_ptr);
-
-    // 먼저 충돌난 곳에 dummy 노드 생성해서 연결
-    dummy = make_shared<StateNode>();
-    stk.push(dummy);
-    if (!getDirectionOf(new_path, dir_pos + 1))
-      prev_node->setLeft(dummy);
+    path_nodes.pop_back();
+    state_node_idx_type grand_parent_idx = path_nodes.back();
+    if (m_nodes[grand_parent_idx].left == node_idx)
+      m_nodes[grand_parent_idx].left = replacement;
     else
-      prev_node->setRight(dummy);
-    prev_node = dummy;
+      m_nodes[grand_parent_idx].right = replacement;
 
-    // 경로가 같은 횟수만큼 경로를 따라서 dummy 노드 생성 및 연결
-    while (true) {
-      if (depth > _TREE_DEPTH) {
-        printf("StateTree::insertNode() collision unsolved.\n");
-        break;
-      }
+    // 남은 leaf는 이제 grand parent가 가리킨다
+    if (replacement != NIL_NODE_IDX)
+      retainNode(replacement);
+    releaseNode(node_idx);
+  }
 
-      if (getDirectionOf(new_path, dir_pos) != getDirectionOf(old_path, dir_pos)) {
-        break;
+  markDirty(path_nodes);
+  reHashDirty(m_root);
+}
+
+void StateTree::commitVersion(const base58_type &block_id) {
+  retainNode(m_root);
+
+  auto it = m_versions.find(block_id);
+  if (it != m_versions.end()) {
+    releaseNode(it->second.root);
+    it->second = {m_root, m_size};
+  } else {
+    m_versions.emplace(block_id, StateVersion{m_root, m_size});
+  }
+}
+
+bool StateTree::checkoutVersion(const base58_type &block_id) {
+  auto it = m_versions.find(block_id);
+  if (it == m_versions.end())
+    return false;
+
+  retainNode(it->second.root);
+  releaseNode(m_root);
+  m_root = it->second.root;
+  m_size = it->second.size;
+  return true;
+}
+
+void StateTree::releaseVersion(const base58_type &block_id) {
+  auto it = m_versions.find(block_id);
+  if (it == m_versions.end())
+    return;
+
+  releaseNode(it->second.root);
+  m_versions.erase(it);
+}
+
+bool StateTree::copyVersion(const base58_type &block_id, const base58_type &new_id) {
+  auto it = m_versions.find(block_id);
+  if (it == m_versions.end())
+    return false;
+
+  StateVersion version = it->second;
+  retainNode(version.root);
+  releaseVersion(new_id);
+  m_versions.emplace(new_id, version);
+  return true;
+}
+
+bool StateTree::hasVersion(const base58_type &block_id) const {
+  return m_versions.find(block_id) != m_versions.end();
+}
+
+size_t StateTree::getVersionNum() const {
+  return m_versions.size();
+}
+
+bool StateTree::exportVersion(const base58_type &block_id, const std::function<void(const StateNode &)> &node_sink,
+                              const std::function<void(const user_ledger_type &)> &user_sink,
+                              const std::function<void(const contract_ledger_type &)> &contract_sink) const {
+  auto it = m_versions.find(block_id);
+  if (it == m_versions.end())
+    return false;
+
+  // bfs_order의 위치가 새 번호. 자식은 발견한 순서대로 뒤에 붙는다
+  vector<state_node_idx_type> bfs_order{it->second.root};
+  state_node_idx_type user_leaf_num = 0, contract_leaf_num = 0;
+
+  for (size_t i = 0; i < bfs_order.size(); ++i) {
+    StateNode node = m_nodes[bfs_order[i]];
+    node.ref_count = 1;
+    node.dirty = false; // 저장된 version은 re-hashing이 끝난 상태
+
+    if (node.isLeaf()) {
+      if (node.ledger_idx & CONTRACT_LEDGER_FLAG) {
+        contract_sink(m_contract_leaves[node.ledger_idx & ~CONTRACT_LEDGER_FLAG].ledger);
+        node.ledger_idx = (contract_leaf_num++) | CONTRACT_LEDGER_FLAG;
       } else {
-        dummy = make_shared<StateNode>();
-        stk.push(dummy);
-        if (!getDirectionOf(new_path, dir_pos)) {
-          prev_node->setLeft(dummy);
-        } else {
-          prev_node->setRight(dummy);
-        }
-        prev_node = dummy;
+        user_sink(m_user_leaves[node.ledger_idx].ledger);
+        node.ledger_idx = user_leaf_num++;
       }
-
-      --dir_pos;
-      ++depth;
-    }
-    // 경로가 다른 위치에서 기존 노드, 새 노드 각각 삽입
-    if (!getDirectionOf(new_path, dir_pos)) {
-      prev_node->setLeft(new_node_ptr);
-      prev_node->setRight(old_node);
-      new_node_ptr->setSuffix(new_path, dir_pos);
-      old_node->setSuffix(old_path, dir_pos);
     } else {
-      prev_node->setRight(new_node_ptr);
-      prev_node->setLeft(old_node);
-      new_node_ptr->setSuffix(new_path, dir_pos);
-      old_node->setSuffix(old_path, dir_pos);
+      if (node.left != NIL_NODE_IDX) {
+        bfs_order.push_back(node.left);
+        node.left = static_cast<state_node_idx_type>(bfs_order.size() - 1);
+      }
+      if (node.right != NIL_NODE_IDX) {
+        bfs_order.push_back(node.right);
+        node.right = static_cast<state_node_idx_type>(bfs_order.size() - 1);
+      }
     }
-  } // collision 해결
-
-  // 머클 루트까지 re-hashing
-  shared_ptr<StateNode> tmp;
-  while (!stk.empty()) {
-    tmp = stk.top();
-    stk.pop();
 
-    tmp->reHash();
+    node_sink(node);
   }
 
-  ++m_size;
+  return true;
 }
 
-void StateTree::modifyNode(shared_ptr<StateNode> old_node, shared_ptr<StateNode> new_node) {
-  old_node->setNodeInfo(new_node);
+bool StateTree::importTree(vector<StateNode> &&nodes, vector<user_ledger_type> &&user_ledgers,
+                           vector<contract_ledger_type> &&contract_ledgers) {
+  if (nodes.empty() || nodes[0].isLeaf())
+    return false;
+
+  // exportVersion이 만든 순서인지 확인한다. 자식과 ledger index는 0번 노드부터 차례로 1씩 증가해야 한다
+  state_node_idx_type next_node_idx = 1, next_user_idx = 0, next_contract_idx = 0;
+  for (auto &each_node : nodes) {
+    if (each_node.isLeaf()) {
+      if (each_node.ledger_idx & CONTRACT_LEDGER_FLAG) {
+        if ((each_node.ledger_idx & ~CONTRACT_LEDGER_FLAG) != next_contract_idx++)
+          return false;
+      } else if (each_node.ledger_idx != next_user_idx++) {
+        return false;
+      }
+    } else {
+      if (each_node.left != NIL_NODE_IDX && each_node.left != next_node_idx++)
+        return false;
+      if (each_node.right != NIL_NODE_IDX && each_node.right != next_node_idx++)
+        return false;
+    }
+    each_node.ref_count = 1;
+    each_node.dirty = false;
+  }
 
-  // 머클 루트까지 re-hashing
-  while (!stk.empty()) {
-    old_node = stk.top();
-    stk.pop();
+  if (next_node_idx != nodes.size() || next_user_idx != user_ledgers.size() || next_contract_idx != contract_ledgers.size())
+    return false;
 
-    old_node->reHash();
+  m_nodes = std::move(nodes);
+  m_free_nodes.clear();
+
+  m_user_leaves.clear();
+  m_user_leaves.reserve(user_ledgers.size());
+  for (auto &each_ledger : user_ledgers) {
+    path_type path = calPathFromPid(each_ledger.pid);
+    m_user_leaves.push_back({path, std::move(each_ledger)});
+  }
+  m_free_user_leaves.clear();
+
+  m_contract_leaves.clear();
+  m_contract_leaves.reserve(contract_ledgers.size());
+  for (auto &each_ledger : contract_ledgers) {
+    path_type path = calPathFromPid(each_ledger.pid);
+    m_contract_leaves.push_back({path, std::move(each_ledger)});
   }
+  m_free_contract_leaves.clear();
+
+  // 이전 노드를 모두 버렸으므로 저장된 version도 함께 비운다
+  m_versions.clear();
+  m_root = 0;
+  m_size = m_user_leaves.size() + m_contract_leaves.size();
+  return true;
 }
 
-void StateTree::removeNode(const string &pid) {
-  shared_ptr<StateNode> node;
-  shared_ptr<StateNode> parent, left, right;
+optional<user_ledger_type> StateTree::getUserLedger(const string &pid) const {
+  vector<state_node_idx_type> path_nodes;
+  state_node_idx_type leaf_node_idx = findLeaf(pid, path_nodes);
+  if (leaf_node_idx == NIL_NODE_IDX || (m_nodes[leaf_node_idx].ledger_idx & CONTRACT_LEDGER_FLAG))
+    return nullopt;
+
+  return m_user_leaves[m_nodes[leaf_node_idx].ledger_idx].ledger;
+}
 
-  node = getMerkleNode(pid);
-  parent = stk.top();
-  stk.pop();
+optional<contract_ledger_type> StateTree::getContractLedger(const string &pid) const {
+  vector<state_node_idx_type> path_nodes;
+  state_node_idx_type leaf_node_idx = findLeaf(pid, path_nodes);
+  if (leaf_node_idx == NIL_NODE_IDX || !(m_nodes[leaf_node_idx].ledger_idx & CONTRACT_LEDGER_FLAG))
+    return nullopt;
 
-  // 해당 노드 삭제
-  if (parent->getLeft() == node) {
-    parent->setLeft(nullptr);
-    node.reset();
-  } else if (parent->getRight() == node) {
-    parent->setRight(nullptr);
-    node.reset();
-  }
-
-  // 머클 루트까지 올라가며 노드 정리
-  do {
-    if (parent == root) {
-      parent->reHash();
-      break;
-    }
+  return m_contract_leaves[m_nodes[leaf_node_idx].ledger_idx & ~CONTRACT_LEDGER_FLAG].ledger;
+}
 
-    left = parent->getLeft();
-    right = parent->getRight();
+// depth 0부터 차례로 path 비트를 나열한 key. key 순서로 정렬하면 tree의 왼쪽에서 오른쪽 순서가 된다
+string StateTree::getTraversalKey(const string &pid) {
+  path_type path = calPathFromPid(pid);
+  string key(_MAX_TREE_DEPTH / 8, '\0');
 
-    if (left != nullptr && right != nullptr)
-      break;                     // left, right 가 모두 존재하면 머클 루트까지 rehash 시작
-    else if (right != nullptr) { // right 만 존재하면 parent 를 right 로 덮어씌움
-      if (!right->isDummy())
-        parent->overwriteNode(right);
-      else
-        break;
-    } else if (left != nullptr) { // left 만 존재하면 parent 를 left 로 덮어씌움
-      if (!left->isDummy())
-        parent->overwriteNode(left);
-      else
-        break;
-    }
+  for (int depth = 0; depth < _MAX_TREE_DEPTH; ++depth) {
+    if (getDirectionOf(path, depth))
+      key[depth / 8] = static_cast<char>(key[depth / 8] | (0x80 >> (depth % 8)));
+  }
+  return key;
+}
+
+// proof 형식 : [version 1][hash version 1][pid 수 4] 다음에 root부터 pre-order로 내부 노드마다
+//   [두 자식의 ProofChild (왼쪽: 하위 2 bit, 오른쪽: 그 위 2 bit) 1] + 왼쪽 자식 내용 + 오른쪽 자식 내용
+//   자식 내용은 HASH: 형제 hash 32 byte, LEAF: pids에서의 index 4 byte, BRANCH: 그 노드의 내용, EMPTY: 없음
+bool StateTree::getProof(const base58_type &block_id, const vector<string> &pids, string &proof,
+                         vector<pair<string, string>> &proven_leaves) const {
+  auto it = m_versions.find(block_id);
+  if (it == m_versions.end())
+    return false;
+
+  proof.clear();
+  proven_leaves.clear();
+
+  vector<state_node_idx_type> path_nodes;
+  std::unordered_set<string> proven_pids;
+  for (auto &each_pid : pids) {
+    state_node_idx_type leaf_node_idx = findLeaf(it->second.root, each_pid, path_nodes);
+    if (leaf_node_idx != NIL_NODE_IDX && proven_pids.insert(each_pid).second)
+      proven_leaves.emplace_back(each_pid, getLeafValue(m_nodes[leaf_node_idx].ledger_idx));
+  }
 
-    if (stk.empty())
-      break;
-    else
-      parent = stk.top();
-    stk.pop();
-  } while (true);
+  if (proven_leaves.empty())
+    return true;
 
-  parent->reHash();
-  while (!stk.empty()) {
-    parent = stk.top();
-    stk.pop();
-    parent->reHash();
+  // 어느 노드에서든 그 아래로 내려가는 pid들이 연속된 구간이 되도록 traversal 순서로 정렬한다
+  vector<pair<string, uint32_t>> sorted_pids;
+  sorted_pids.reserve(proven_leaves.size());
+  for (uint32_t i = 0; i < proven_leaves.size(); ++i) {
+    sorted_pids.emplace_back(getTraversalKey(proven_leaves[i].first), i);
   }
-  --m_size;
-}
+  std::sort(sorted_pids.begin(), sorted_pids.end());
 
-shared_ptr<StateNode> StateTree::getMerkleNode(const string &pid) {
-  shared_ptr<StateNode> ret = nullptr;
-  path_type path = ret->calPathFromPid(pid);
+  proof.push_back(static_cast<char>(PROOF_FORMAT_VERSION));
+  proof.push_back(static_cast<char>(m_hash_version));
+  for (int i = 0; i < 4; ++i) {
+    proof.push_back(static_cast<char>((proven_leaves.size() >> (8 * i)) & 0xff));
+  }
 
-  while (!stk.empty()) {
-    stk.pop(); // 스택 clear
+  writeProofNode(it->second.root, 0, sorted_pids, 0, sorted_pids.size(), proof);
+  return true;
+}
+
+// sorted_pids의 [begin, end)는 모두 이 노드 아래의 leaf이다
+void StateTree::writeProofNode(state_node_idx_type node_idx, int depth, const vector<pair<string, uint32_t>> &sorted_pids, size_t begin,
+                               size_t end, string &proof) const {
+  // [begin, mid)는 왼쪽, [mid, end)는 오른쪽으로 내려간다
+  uint8_t mask = 0x80 >> (depth % 8);
+  auto is_left = [depth, mask](const pair<string, uint32_t> &sorted_pid) { return !(sorted_pid.first[depth / 8] & mask); };
+  size_t mid = std::partition_point(sorted_pids.begin() + begin, sorted_pids.begin() + end, is_left) - sorted_pids.begin();
+
+  const StateNode &node = m_nodes[node_idx];
+  const state_node_idx_type children[2] = {node.left, node.right};
+  const size_t ranges[3] = {begin, mid, end};
+  ProofChild kinds[2];
+
+  for (int dir = 0; dir < 2; ++dir) {
+    if (children[dir] == NIL_NODE_IDX)
+      kinds[dir] = ProofChild::EMPTY;
+    else if (ranges[dir] == ranges[dir + 1])
+      kinds[dir] = ProofChild::HASH;
+    else if (m_nodes[children[dir]].isLeaf())
+      kinds[dir] = ProofChild::LEAF;
+    else
+      kinds[dir] = ProofChild::BRANCH;
   }
+  proof.push_back(static_cast<char>(static_cast<uint8_t>(kinds[0]) | (static_cast<uint8_t>(kinds[1]) << 2)));
 
-  // _path 따라 내려가면서 dummy 가 아닌 노드 (실제 정보를 가진 노드)를 발견하면 반환
-  shared_ptr<StateNode> node = root;
-  int dir_pos = _TREE_DEPTH - 1;
-  while (true) {
-    if (!node->isDummy()) {
-      ret = node;
+  for (int dir = 0; dir < 2; ++dir) {
+    switch (kinds[dir]) {
+    case ProofChild::HASH:
+      proof.append(reinterpret_cast<const char *>(m_nodes[children[dir]].hash_value.data()), sizeof(state_hash_type));
       break;
-    }
-
-    if (dir_pos < 0) {
+    case ProofChild::LEAF:
+      // 모두 tree에 있는 서로 다른 pid이므로 leaf에 도착하는 것은 하나뿐이다
+      for (int i = 0; i < 4; ++i) {
+        proof.push_back(static_cast<char>((sorted_pids[ranges[dir]].second >> (8 * i)) & 0xff));
+      }
+      break;
+    case ProofChild::BRANCH:
+      writeProofNode(children[dir], depth + 1, sorted_pids, ranges[dir], ranges[dir + 1], proof);
+      break;
+    default:
       break;
     }
-    stk.push(node);
-    if (!getDirectionOf(path, dir_pos)) {
-      node = node->getLeft();
-    } else {
-      node = node->getRight();
-    }
-    --dir_pos;
   }
-  return ret;
 }
 
-vector<vector<uint8_t>> StateTree::getSiblings(const string &pid) {
-  shared_ptr<StateNode> node = getMerkleNode(pid);
+bool StateTree::verifyProof(const string &proof, const vector<uint8_t> &root_value, const vector<pair<string, string>> &leaves) {
+  // proof를 앞에서부터 읽으며 getProof와 같은 순서로 hash를 다시 계산한다
+  struct ProofVerifier {
+    const string &proof;
+    const vector<pair<string, string>> &leaves;
+    StateHashVersion hash_version;
+    size_t pos;
+    vector<string> leaf_keys;
+    vector<bool> used;
+    string current_key; // 지금 내려온 경로의 방향 비트
+
+    bool readUint32(uint32_t &value) {
+      if (proof.size() - pos < 4)
+        return false;
+      value = 0;
+      for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(proof[pos++])) << (8 * i);
+      }
+      return true;
+    }
 
-  vector<vector<uint8_t>> siblings;
-  vector<uint8_t> value;
+    // leaf의 pid가 지금까지 내려온 경로(0 ~ depth의 방향)와 맞는지
+    bool isOnPath(const string &leaf_key, int depth) const {
+      for (int d = 0; d <= depth; ++d) {
+        uint8_t mask = 0x80 >> (d % 8);
+        if ((leaf_key[d / 8] & mask) != (current_key[d / 8] & mask))
+          return false;
+      }
+      return true;
+    }
 
-  shared_ptr<StateNode> parent_node;
-  siblings.clear();
-  while (!stk.empty()) {
-    parent_node = stk.top();
-    stk.pop();
+    bool verifyNode(int depth, state_hash_type &hash_value) {
+      if (depth >= _MAX_TREE_DEPTH || pos >= proof.size())
+        return false;
+
+      uint8_t kinds = static_cast<uint8_t>(proof[pos++]);
+      state_hash_type child_hashes[2];
+      bool has_child[2] = {true, true};
+
+      for (int dir = 0; dir < 2; ++dir) {
+        uint8_t mask = 0x80 >> (depth % 8);
+        current_key[depth / 8] = static_cast<char>(dir ? (current_key[depth / 8] | mask) : (current_key[depth / 8] & ~mask));
+
+        switch (static_cast<ProofChild>((kinds >> (2 * dir)) & 0x03)) {
+        case ProofChild::EMPTY:
+          has_child[dir] = false;
+          break;
+        case ProofChild::HASH:
+          if (proof.size() - pos < sizeof(state_hash_type))
+            return false;
+          std::copy(proof.begin() + pos, proof.begin() + pos + sizeof(state_hash_type), child_hashes[dir].begin());
+          pos += sizeof(state_hash_type);
+          break;
+        case ProofChild::LEAF: {
+          uint32_t leaf_idx;
+          if (!readUint32(leaf_idx) || leaf_idx >= leaves.size() || used[leaf_idx] || !isOnPath(leaf_keys[leaf_idx], depth))
+            return false;
+          used[leaf_idx] = true;
+          child_hashes[dir] = hashLeaf(hash_version, leaves[leaf_idx].first, leaves[leaf_idx].second);
+          break;
+        }
+        case ProofChild::BRANCH:
+          if (!verifyNode(depth + 1, child_hashes[dir]))
+            return false;
+          break;
+        }
+      }
 
-    value.clear();
-    if (parent_node->getLeft() == node) {
-      if (parent_node->getRight() != nullptr)
-        value = parent_node->getRight()->getValue();
-    } else if (parent_node->getRight() == node) {
-      if (parent_node->getLeft() != nullptr)
-        value = parent_node->getLeft()->getValue();
+      hash_value = hashBranch(hash_version, has_child[0] ? &child_hashes[0] : nullptr, has_child[1] ? &child_hashes[1] : nullptr);
+      return true;
     }
-    // printf("getSiblings::value.size() = %ld\n", value.size());
-    siblings.push_back(value);
+  };
+
+  if (proof.size() < 6 || static_cast<uint8_t>(proof[0]) != PROOF_FORMAT_VERSION || root_value.size() != sizeof(state_hash_type))
+    return false;
+
+  ProofVerifier verifier{proof, leaves, static_cast<StateHashVersion>(proof[1]), 2, {}, vector<bool>(leaves.size(), false),
+                         string(_MAX_TREE_DEPTH / 8, '\0')};
+  if (verifier.hash_version != StateHashVersion::BASE64_CONCAT && verifier.hash_version != StateHashVersion::BINARY)
+    return false;
+
+  uint32_t leaf_num;
+  if (!verifier.readUint32(leaf_num) || leaf_num != leaves.size() || leaves.empty())
+    return false;
+
+  verifier.leaf_keys.reserve(leaves.size());
+  for (auto &each_leaf : leaves) {
+    verifier.leaf_keys.emplace_back(getTraversalKey(each_leaf.first));
   }
-  return siblings;
+
+  state_hash_type root_hash;
+  if (!verifier.verifyNode(0, root_hash) || verifier.pos != proof.size())
+    return false;
+
+  // 모든 leaf가 proof에 한 번씩 들어 있어야 한다
+  for (bool each_used : verifier.used) {
+    if (!each_used)
+      return false;
+  }
+
+  return std::equal(root_hash.begin(), root_hash.end(), root_value.begin());
 }
 
-void StateTree::printTreePostOrder() {
-  bool isPrint = true;
-
-  if (isPrint) {
-    uint64_t size = getSize();
-    cout << "*********** print tree data by using post-order traversal... ************\n" << endl;
-    cout << "node size: " << getSize() << endl;
-    if (size == 0) {
-      cout << "there is nothing to printing!!\n\n";
-      return;
-    }
-    _debug_depth = -1;
-    _debug_dir = false;
-    _debug_str_depth = _debug_str_dir = "";
-    for (int i = 0; i < _TREE_DEPTH * 2; ++i) {
-      _debug_str_depth += " ";
-      _debug_str_dir += "\t";
-    }
+// tree post-order 순회 재귀함수
+void StateTree::postOrder(state_node_idx_type node_idx, int depth, bool dir) {
+  const StateNode &node = m_nodes[node_idx];
+  string str_dir = !dir ? "Left" : "Right";
+
+  printf("%s[depth %3d] %s\n", string(depth * 2, ' ').c_str(), depth, str_dir.c_str());
+  if (node.left != NIL_NODE_IDX)
+    postOrder(node.left, depth + 1, false);
+  if (node.right != NIL_NODE_IDX)
+    postOrder(node.right, depth + 1, true);
+
+  if (node.isLeaf()) {
+    printf("%s%s\t[pid: %s] hash_value: %s\n", string(depth, '\t').c_str(), str_dir.c_str(),
+           TypeConverter::encodeBase<64>(getLeafPid(node.ledger_idx)).c_str(), TypeConverter::encodeBase<64>(node.hash_value).c_str());
   }
+}
 
-  while (!stk.empty()) {
-    stk.pop();
+void StateTree::printTreePostOrder() {
+  cout << "*********** print tree data by using post-order traversal... ************\n" << endl;
+  cout << "node size: " << getSize() << endl;
+  if (getSize() == 0) {
+    cout << "there is nothing to printing!!\n\n";
+    return;
   }
 
-  postOrder(root, isPrint);
+  postOrder(m_root, 0, false);
 
-  if (isPrint) {
-    cout << "root Value: " << TypeConverter::encodeBase<64>(root->getValue()) << endl;
-    cout << "*********** finish traversal ***********" << endl;
-  }
+  cout << "root Value: " << TypeConverter::encodeBase<64>(getRootValue()) << endl;
+  cout << "*********** finish traversal ***********" << endl;
 }
 
-uint64_t StateTree::getSize() {
+StateHashVersion StateTree::getHashVersion() const {
+  return m_hash_version;
+}
+
+uint64_t StateTree::getSize() const {
   return m_size;
 }
 
-vector<uint8_t> StateTree::getRootValue() {
-  return root->getValue();
+size_t StateTree::getNodeCount() const {
+  return m_nodes.size() - m_free_nodes.size();
+}
+
+// 노드와 leaf 저장소가 차지하는 대략적인 메모리 (ledger 내부 문자열의 heap 할당은 제외)
+size_t StateTree::getMemoryUsage() const {
+  return m_nodes.capacity() * sizeof(StateNode) + m_user_leaves.capacity() * sizeof(UserLeaf) +
+         m_contract_leaves.capacity() * sizeof(ContractLeaf) +
+         (m_free_nodes.capacity() + m_free_user_leaves.capacity() + m_free_contract_leaves.capacity()) * sizeof(state_node_idx_type);
 }
 
-shared_ptr<StateNode> StateTree::getRootPtr() {
-  return root;
+// 비어 있는 트리의 root는 빈 값
+vector<uint8_t> StateTree::getRootValue() const {
+  const StateNode &root = m_nodes[m_root];
+  if (root.left == NIL_NODE_IDX && root.right == NIL_NODE_IDX)
+    return vector<uint8_t>();
+
+  return vector<uint8_t>(root.hash_value.begin(), root.hash_value.end());
 }
 
-stack<shared_ptr<StateNode>> StateTree::getStack() {
-  return stk;
+vector<uint8_t> StateTree::getRootValue(const base58_type &block_id) const {
+  auto version_it = m_versions.find(block_id);
+  if (version_it == m_versions.end())
+    return vector<uint8_t>();
+
+  const StateNode &root = m_nodes[version_it->second.root];
+  if (root.left == NIL_NODE_IDX && root.right == NIL_NODE_IDX)
+    return vector<uint8_t>();
+
+  return vector<uint8_t>(root.hash_value.begin(), root.hash_value.end());
 }
 
 } // namespace tethys
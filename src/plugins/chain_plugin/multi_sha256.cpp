@@ -0,0 +1,368 @@
+#include "include/multi_sha256.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TETHYS_MULTI_SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace tethys {
+
+namespace {
+
+constexpr uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+    0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+    0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr uint32_t SHA256_IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadBigEndian(const uint8_t *src) {
+  return (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16) | (static_cast<uint32_t>(src[2]) << 8) |
+         static_cast<uint32_t>(src[3]);
+}
+
+inline void storeBigEndian(uint8_t *dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value >> 24);
+  dst[1] = static_cast<uint8_t>(value >> 16);
+  dst[2] = static_cast<uint8_t>(value >> 8);
+  dst[3] = static_cast<uint8_t>(value);
+}
+
+// 64 byte 메시지의 두 번째 block은 항상 0x80, 0, ..., 길이(512 bit)이므로 K + W를 한 번만 계산해 둔다
+const std::array<uint32_t, 64> &getPaddingKw() {
+  static const std::array<uint32_t, 64> padding_kw = []() {
+    uint32_t w[64] = {0x80000000};
+    w[15] = 512;
+    for (int t = 16; t < 64; ++t) {
+      uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+      uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+      w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+
+    std::array<uint32_t, 64> kw;
+    for (int t = 0; t < 64; ++t) {
+      kw[t] = SHA256_K[t] + w[t];
+    }
+    return kw;
+  }();
+
+  return padding_kw;
+}
+
+void roundsScalar(uint32_t state[8], const uint32_t kw[64]) {
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (int t = 0; t < 64; ++t) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kw[t];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void hash64Scalar(const uint8_t *input, size_t num, uint8_t *output) {
+  const auto &padding_kw = getPaddingKw();
+
+  for (size_t i = 0; i < num; ++i) {
+    const uint8_t *block = input + i * 64;
+
+    uint32_t w[64];
+    for (int t = 0; t < 16; ++t) {
+      w[t] = loadBigEndian(block + t * 4);
+    }
+    for (int t = 16; t < 64; ++t) {
+      uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+      uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+      w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    for (int t = 0; t < 64; ++t) {
+      w[t] += SHA256_K[t];
+    }
+
+    uint32_t state[8];
+    std::memcpy(state, SHA256_IV, sizeof(state));
+    roundsScalar(state, w);
+    roundsScalar(state, padding_kw.data());
+
+    for (int j = 0; j < 8; ++j) {
+      storeBigEndian(output + i * 32 + j * 4, state[j]);
+    }
+  }
+}
+
+#ifdef TETHYS_MULTI_SHA256_X86
+
+// AVX2: 8개의 메시지를 32bit lane 하나씩에 나눠 담고 동시에 계산한다
+
+#define TETHYS_AVX2 __attribute__((target("avx2")))
+
+TETHYS_AVX2 inline __m256i rotrAvx2(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+TETHYS_AVX2 inline void roundsAvx2(__m256i state[8], const __m256i kw[64]) {
+  __m256i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (int t = 0; t < 64; ++t) {
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotrAvx2(e, 6), rotrAvx2(e, 11)), rotrAvx2(e, 25));
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1), _mm256_add_epi32(ch, kw[t]));
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotrAvx2(a, 2), rotrAvx2(a, 13)), rotrAvx2(a, 22));
+    __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+  }
+
+  state[0] = _mm256_add_epi32(state[0], a);
+  state[1] = _mm256_add_epi32(state[1], b);
+  state[2] = _mm256_add_epi32(state[2], c);
+  state[3] = _mm256_add_epi32(state[3], d);
+  state[4] = _mm256_add_epi32(state[4], e);
+  state[5] = _mm256_add_epi32(state[5], f);
+  state[6] = _mm256_add_epi32(state[6], g);
+  state[7] = _mm256_add_epi32(state[7], h);
+}
+
+TETHYS_AVX2 void hash64Avx2(const uint8_t *input, size_t num, uint8_t *output) {
+  const __m256i bswap_mask = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6,
+                                             7, 0, 1, 2, 3);
+  // lane l이 l번째 메시지의 같은 위치 word를 읽도록 하는 gather index (word 단위)
+  const __m256i gather_idx = _mm256_set_epi32(7 * 16, 6 * 16, 5 * 16, 4 * 16, 3 * 16, 2 * 16, 16, 0);
+
+  __m256i padding_kw[64];
+  const auto &padding_kw_scalar = getPaddingKw();
+  for (int t = 0; t < 64; ++t) {
+    padding_kw[t] = _mm256_set1_epi32(static_cast<int>(padding_kw_scalar[t]));
+  }
+
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    const int *block = reinterpret_cast<const int *>(input + i * 64);
+
+    __m256i w[64];
+    for (int t = 0; t < 16; ++t) {
+      w[t] = _mm256_shuffle_epi8(_mm256_i32gather_epi32(block + t, gather_idx, 4), bswap_mask);
+    }
+    for (int t = 16; t < 64; ++t) {
+      __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotrAvx2(w[t - 15], 7), rotrAvx2(w[t - 15], 18)), _mm256_srli_epi32(w[t - 15], 3));
+      __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotrAvx2(w[t - 2], 17), rotrAvx2(w[t - 2], 19)), _mm256_srli_epi32(w[t - 2], 10));
+      w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+    for (int t = 0; t < 64; ++t) {
+      w[t] = _mm256_add_epi32(w[t], _mm256_set1_epi32(static_cast<int>(SHA256_K[t])));
+    }
+
+    __m256i state[8];
+    for (int j = 0; j < 8; ++j) {
+      state[j] = _mm256_set1_epi32(static_cast<int>(SHA256_IV[j]));
+    }
+    roundsAvx2(state, w);
+    roundsAvx2(state, padding_kw);
+
+    // state[j]의 lane l은 l번째 hash의 j번째 word이므로 8x8 전치해서 hash 하나씩 쓴다
+    for (int j = 0; j < 8; ++j) {
+      state[j] = _mm256_shuffle_epi8(state[j], bswap_mask);
+    }
+    __m256i t0 = _mm256_unpacklo_epi32(state[0], state[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(state[0], state[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(state[2], state[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(state[2], state[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(state[4], state[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(state[4], state[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(state[6], state[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(state[6], state[7]);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    __m256i *out = reinterpret_cast<__m256i *>(output + i * 32);
+    _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256(out + 4, _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256(out + 5, _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256(out + 6, _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256(out + 7, _mm256_permute2x128_si256(u3, u7, 0x31));
+  }
+
+  // 8개가 안 되는 나머지
+  hash64Scalar(input + i * 64, num - i, output + i * 32);
+}
+
+// SHA-NI: 메시지 하나씩이지만 round 자체를 명령어로 처리한다. state는 ABEF / CDGH 순서로 들고 다닌다
+
+#define TETHYS_SHA_NI __attribute__((target("sha,sse4.1,ssse3")))
+
+TETHYS_SHA_NI inline void roundsShaNi(__m128i &abef, __m128i &cdgh, __m128i kw) {
+  cdgh = _mm_sha256rnds2_epu32(cdgh, abef, kw);
+  abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(kw, 0x0E));
+}
+
+TETHYS_SHA_NI void hash64ShaNi(const uint8_t *input, size_t num, uint8_t *output) {
+  const __m128i bswap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i padding_kw[16];
+  const auto &padding_kw_scalar = getPaddingKw();
+  for (int g = 0; g < 16; ++g) {
+    padding_kw[g] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(padding_kw_scalar.data() + g * 4));
+  }
+
+  __m128i iv_cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SHA256_IV)), 0xB1);
+  __m128i iv_efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SHA256_IV + 4)), 0x1B);
+  const __m128i iv_abef = _mm_alignr_epi8(iv_cdab, iv_efgh, 8);
+  const __m128i iv_cdgh = _mm_blend_epi16(iv_efgh, iv_cdab, 0xF0);
+
+  for (size_t i = 0; i < num; ++i) {
+    const __m128i *block = reinterpret_cast<const __m128i *>(input + i * 64);
+    __m128i abef = iv_abef;
+    __m128i cdgh = iv_cdgh;
+
+    __m128i msg[4];
+    for (int m = 0; m < 4; ++m) {
+      msg[m] = _mm_shuffle_epi8(_mm_loadu_si128(block + m), bswap_mask);
+    }
+
+    // round 4개마다 다음 message schedule을 sha256msg1 / sha256msg2로 미리 계산한다
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+      __m128i kw = _mm_add_epi32(msg[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHA256_K + g * 4)));
+      cdgh = _mm_sha256rnds2_epu32(cdgh, abef, kw);
+      if (g >= 3 && g <= 14) {
+        __m128i next = _mm_add_epi32(msg[(g + 1) & 3], _mm_alignr_epi8(msg[g & 3], msg[(g - 1) & 3], 4));
+        msg[(g + 1) & 3] = _mm_sha256msg2_epu32(next, msg[g & 3]);
+      }
+      abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(kw, 0x0E));
+      if (g >= 1 && g <= 12) {
+        msg[(g - 1) & 3] = _mm_sha256msg1_epu32(msg[(g - 1) & 3], msg[g & 3]);
+      }
+    }
+    abef = _mm_add_epi32(abef, iv_abef);
+    cdgh = _mm_add_epi32(cdgh, iv_cdgh);
+
+    const __m128i block_abef = abef;
+    const __m128i block_cdgh = cdgh;
+    for (int g = 0; g < 16; ++g) {
+      roundsShaNi(abef, cdgh, padding_kw[g]);
+    }
+    abef = _mm_add_epi32(abef, block_abef);
+    cdgh = _mm_add_epi32(cdgh, block_cdgh);
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    __m128i *out = reinterpret_cast<__m128i *>(output + i * 32);
+    _mm_storeu_si128(out, _mm_shuffle_epi8(_mm_blend_epi16(feba, dchg, 0xF0), bswap_mask));
+    _mm_storeu_si128(out + 1, _mm_shuffle_epi8(_mm_alignr_epi8(dchg, feba, 8), bswap_mask));
+  }
+}
+
+bool hasShaNi() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    return false;
+
+  return (ebx & (1u << 29)) && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3");
+}
+
+#endif
+
+} // namespace
+
+MultiSha256::Kernel MultiSha256::getKernel() {
+  static const Kernel kernel = []() {
+    if (isSupported(Kernel::SHA_NI))
+      return Kernel::SHA_NI;
+    if (isSupported(Kernel::AVX2))
+      return Kernel::AVX2;
+    return Kernel::SCALAR;
+  }();
+
+  return kernel;
+}
+
+bool MultiSha256::isSupported(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::SCALAR:
+    return true;
+#ifdef TETHYS_MULTI_SHA256_X86
+  case Kernel::AVX2:
+    return __builtin_cpu_supports("avx2");
+  case Kernel::SHA_NI:
+    return hasShaNi();
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *MultiSha256::getKernelName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::SCALAR:
+    return "scalar";
+  case Kernel::AVX2:
+    return "avx2";
+  case Kernel::SHA_NI:
+    return "sha-ni";
+  default:
+    return "unknown";
+  }
+}
+
+void MultiSha256::hash64(const uint8_t *input, size_t num, uint8_t *output) {
+  hash64(getKernel(), input, num, output);
+}
+
+void MultiSha256::hash64(Kernel kernel, const uint8_t *input, size_t num, uint8_t *output) {
+  switch (kernel) {
+#ifdef TETHYS_MULTI_SHA256_X86
+  case Kernel::SHA_NI:
+    hash64ShaNi(input, num, output);
+    return;
+  case Kernel::AVX2:
+    hash64Avx2(input, num, output);
+    return;
+#endif
+  default:
+    hash64Scalar(input, num, output);
+    return;
+  }
+}
+
+} // namespace tethys
@@ -0,0 +1,176 @@
+#include "include/persistence_stage.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace tethys {
+
+PersistenceStage::PersistenceStage(size_t queue_capacity, commit_function_type commit_function, block_height_type durable_height)
+    : m_queue_capacity(std::max<size_t>(1, queue_capacity)), m_commit_function(std::move(commit_function)),
+      m_durable_height(durable_height) {}
+
+PersistenceStage::~PersistenceStage() {
+  stop();
+}
+
+void PersistenceStage::start() {
+  if (m_worker.joinable())
+    return;
+
+  m_stopping = false;
+  m_worker = std::thread([this]() { run(); });
+  logger::INFO("Persistence stage is started");
+}
+
+// queue에 남은 블록을 모두 commit한 뒤 worker를 종료한다
+void PersistenceStage::stop() {
+  {
+    std::lock_guard<std::mutex> guard(m_queue_mutex);
+    m_stopping = true;
+  }
+  m_not_empty.notify_all();
+
+  if (m_worker.joinable()) {
+    m_worker.join();
+    logger::INFO("Persistence stage is stopped");
+  }
+}
+
+bool PersistenceStage::canPush() {
+  std::lock_guard<std::mutex> guard(m_queue_mutex);
+  return !m_stopping && !m_failed && m_pending_blocks.size() < m_queue_capacity;
+}
+
+// 받지 않은 블록은 backup에 남아 있어 재시작 시 pool로 복구된다
+bool PersistenceStage::push(const UnresolvedBlock &resolved_block) {
+  std::unique_lock<std::mutex> lock(m_queue_mutex);
+
+  if (m_stopping || m_failed) {
+    logger::ERROR("Persistence stage is {}. Block {} (height {}) is not committed and will be restored from backup",
+                  m_failed ? "failed" : "stopping", resolved_block.block.getBlockId(), resolved_block.block.getHeight());
+    return false;
+  }
+  if (m_pending_blocks.size() >= m_queue_capacity) {
+    logger::ERROR("Persistence queue is full ({}). Block {} (height {}) is not committed", m_pending_blocks.size(),
+                  resolved_block.block.getBlockId(), resolved_block.block.getHeight());
+    return false;
+  }
+
+  m_pending_blocks.push_back(resolved_block);
+  lock.unlock();
+
+  m_not_empty.notify_one();
+  return true;
+}
+
+bool PersistenceStage::hasFailed() const {
+  return m_failed.load();
+}
+
+block_height_type PersistenceStage::getDurableHeight() const {
+  return m_durable_height.load();
+}
+
+size_t PersistenceStage::getPendingSize() {
+  std::lock_guard<std::mutex> guard(m_queue_mutex);
+  return m_pending_blocks.size();
+}
+
+vector<base58_type> PersistenceStage::getPendingBlockIds() {
+  std::lock_guard<std::mutex> guard(m_queue_mutex);
+
+  vector<base58_type> block_ids;
+  for (auto &each_block : m_pending_blocks) {
+    block_ids.emplace_back(each_block.block.getBlockId());
+  }
+  return block_ids;
+}
+
+vector<base58_type> PersistenceStage::takeDurableBlockIds() {
+  std::lock_guard<std::mutex> guard(m_queue_mutex);
+
+  vector<base58_type> block_ids;
+  block_ids.swap(m_durable_block_ids);
+  return block_ids;
+}
+
+bool PersistenceStage::findUserLedger(const string &pid, user_ledger_type &found_ledger) {
+  bool found = false;
+  visitPendingBlocks([&](const UnresolvedBlock &each_block) {
+    auto it = each_block.user_ledger_list.find(pid);
+    if (it == each_block.user_ledger_list.end())
+      return true;
+
+    found_ledger = it->second;
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+bool PersistenceStage::findContractLedger(const string &pid, contract_ledger_type &found_ledger) {
+  bool found = false;
+  visitPendingBlocks([&](const UnresolvedBlock &each_block) {
+    auto it = each_block.contract_ledger_list.find(pid);
+    if (it == each_block.contract_ledger_list.end())
+      return true;
+
+    found_ledger = it->second;
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+void PersistenceStage::run() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    m_not_empty.wait(lock, [this]() { return !m_pending_blocks.empty() || m_stopping; });
+
+    if (m_pending_blocks.empty())
+      return; // stopping
+
+    // front는 worker만 pop하므로, lock을 풀어도 참조가 유효하다
+    const UnresolvedBlock &resolved_block = m_pending_blocks.front();
+    lock.unlock();
+
+    bool committed = commitWithRetry(resolved_block);
+
+    lock.lock();
+    if (!committed) {
+      // 순서를 지켜야 하므로 뒤의 블록들도 commit하지 않는다. backup이 남아있으므로 재시작 시 pool로 복구된다.
+      // 그때까지 조회가 pool -> pending -> rdb 순서로 이 블록들의 ledger를 찾을 수 있도록 queue에서 지우지 않는다
+      logger::ERROR("Persistence stage gave up {} blocks from height {}. They stay pending until restart", m_pending_blocks.size(),
+                    m_durable_height.load() + 1);
+      m_failed = !m_stopping;
+      return;
+    }
+
+    m_durable_height = resolved_block.block.getHeight();
+    m_durable_block_ids.emplace_back(resolved_block.block.getBlockId());
+    m_pending_blocks.pop_front();
+  }
+}
+
+// 실패하면 간격을 늘려가며 PERSISTENCE_MAX_RETRY_NUM번까지 다시 시도한다. 종료 중에 실패하면 바로 포기
+bool PersistenceStage::commitWithRetry(const UnresolvedBlock &resolved_block) {
+  auto retry_interval = std::chrono::milliseconds(100);
+  const auto max_retry_interval = std::chrono::milliseconds(5000);
+
+  for (uint32_t retry_num = 0; !m_commit_function(resolved_block); ++retry_num) {
+    if (m_stopping || retry_num >= config::PERSISTENCE_MAX_RETRY_NUM) {
+      logger::ERROR("Failed to commit block {} (height {}) after {} retries", resolved_block.block.getBlockId(),
+                    resolved_block.block.getHeight(), retry_num);
+      return false;
+    }
+
+    logger::ERROR("Failed to commit block {} (height {}). Retry after {}ms", resolved_block.block.getBlockId(),
+                  resolved_block.block.getHeight(), retry_interval.count());
+
+    std::this_thread::sleep_for(retry_interval);
+    retry_interval = std::min(retry_interval * 2, max_retry_interval);
+  }
+  return true;
+}
+
+} // namespace tethys
@@ -7,9 +7,76 @@ using namespace std;
 
 namespace tethys {
 
+namespace {
+
+// MySQL backend는 vector로 bind해도 row마다 statement를 실행하므로, 여러 row를 하나의 SQL 문장에 담아 한 번에 보낸다.
+// placeholder는 bind한 순서대로 채워지므로 SQL 문장도 bind 순서와 같은 순서로 만들어야 한다
+class MultiRowStatement {
+public:
+  explicit MultiRowStatement(soci::session &db_session) : m_statement(db_session) {}
+
+  // bind한 값은 execute가 끝날 때까지 살아 있어야 한다
+  template <typename T>
+  string bind(const T &value) {
+    m_statement.exchange(soci::use(value));
+    return ":p" + to_string(m_bind_num++);
+  }
+
+  // "(:p0, :p1, ...)"
+  template <typename... Values>
+  string bindRow(const Values &... values) {
+    string row;
+    ((row += (row.empty() ? "(" : ", ") + bind(values)), ...);
+    return row + ")";
+  }
+
+  // " WHEN :p0 THEN :p1"
+  template <typename Key, typename Value>
+  string bindWhen(const Key &key, const Value &value) {
+    string when = " WHEN " + bind(key);
+    return when + " THEN " + bind(value);
+  }
+
+  // IN 절에 들어갈 "(:p0, :p1, ...)"
+  template <typename Row, typename GetKey>
+  string bindList(const vector<Row> &rows, size_t begin, size_t end, GetKey &&get_key) {
+    string list;
+    for (size_t i = begin; i < end; ++i) {
+      list += (i == begin ? "(" : ", ") + bind(get_key(rows[i]));
+    }
+    return list + ")";
+  }
+
+  void execute(const string &sql) {
+    m_statement.alloc();
+    m_statement.prepare(sql);
+    m_statement.define_and_bind();
+    m_statement.execute(true);
+  }
+
+private:
+  soci::statement m_statement;
+  int m_bind_num{0};
+};
+
+// row_num개의 row를 RDB_MULTI_ROW_CHUNK_SIZE개씩 나누어 make_sql(statement, begin, end)이 만든 문장으로 실행한다
+template <typename MakeSql>
+void executeInChunks(soci::session &db_session, size_t row_num, MakeSql &&make_sql) {
+  for (size_t begin = 0; begin < row_num; begin += config::RDB_MULTI_ROW_CHUNK_SIZE) {
+    size_t end = std::min(row_num, begin + config::RDB_MULTI_ROW_CHUNK_SIZE);
+    MultiRowStatement st(db_session);
+    st.execute(make_sql(st, begin, end));
+  }
+}
+
+} // namespace
+
 RdbController::RdbController(string_view dbms, string_view table_name, string_view db_user_id, string_view db_password)
     : m_dbms(dbms), m_table_name(table_name), m_db_user_id(db_user_id), m_db_password(db_password),
-      m_db_pool(config::DB_SESSION_POOL_SIZE) {
+      m_db_pool(config::DB_SESSION_POOL_SIZE), m_user_scope_cache(config::RDB_LEDGER_CACHE_SIZE, config::RDB_CACHE_SHARD_NUM),
+      m_contract_scope_cache(config::RDB_LEDGER_CACHE_SIZE, config::RDB_CACHE_SHARD_NUM),
+      m_var_type_cache(config::RDB_LEDGER_CACHE_SIZE, config::RDB_CACHE_SHARD_NUM),
+      m_user_cert_cache(config::RDB_CERT_CACHE_SIZE, config::RDB_CACHE_SHARD_NUM) {
   for (int i = 0; i != config::DB_SESSION_POOL_SIZE; ++i) {
     soci::session &sql = m_db_pool.at(i);
     sql.open(m_dbms, "service=" + m_table_name + " user=" + m_db_user_id + " password=" + m_db_password);
@@ -476,6 +543,8 @@ bool RdbController::applyUserLedgerToRDB(const map<string, user_ledger_type> &us
       // clang-format on
 
       st.execute(true);
+
+      cacheUserLedger(each_ledger.second);
     }
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
@@ -537,6 +606,8 @@ bool RdbController::applyContractLedgerToRDB(const map<string, contract_ledger_t
       // clang-format on
 
       st.execute(true);
+
+      cacheContractLedger(each_ledger.second);
     }
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
@@ -626,6 +697,9 @@ bool RdbController::applyUserCertToRDB(const map<base58_type, user_cert_type> &u
       // clang-format on
 
       st.execute(true);
+
+      // 한 uid에 인증서가 여럿일 수 있으므로, 새로 채우지 않고 다음 조회 때 rdb에서 다시 읽게 한다
+      m_user_cert_cache.erase(uid);
     }
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
@@ -693,6 +767,312 @@ bool RdbController::applyContractToRDB(const map<contract_id_type, contract_type
   return true;
 }
 
+// 블록 하나가 확정되었을 때 필요한 모든 쓰기를 하나의 DB transaction으로 처리한다.
+// 테이블과 query 종류마다 RDB_MULTI_ROW_CHUNK_SIZE개의 row를 하나의 multi-row 문장으로 묶어 실행한다.
+bool RdbController::commitResolvedBlock(const UnresolvedBlock &resolved_block) {
+  logger::INFO("commit resolved block {}", resolved_block.block.getBlockId());
+
+  try {
+    soci::session db_session(RdbController::pool());
+    soci::transaction tr(db_session);
+
+    insertBlock(db_session, resolved_block.block);
+    insertTransactions(db_session, resolved_block.block);
+    writeUserLedgers(db_session, resolved_block.user_ledger_list);
+    writeContractLedgers(db_session, resolved_block.contract_ledger_list);
+    writeUserAttributes(db_session, resolved_block.user_attribute_list);
+    writeUserCerts(db_session, resolved_block.user_cert_list);
+    writeContracts(db_session, resolved_block.contract_list);
+
+    tr.commit();
+  } catch (soci::mysql_soci_error const &e) {
+    logger::ERROR("MySQL error: {}", e.what());
+    return false;
+  } catch (...) {
+    logger::ERROR("Unexpected error at `commitResolvedBlock`");
+    return false;
+  }
+
+  // commit이 성공한 뒤에만 cache에 반영한다
+  for (auto &each_ledger : resolved_block.user_ledger_list) {
+    cacheUserLedger(each_ledger.second);
+  }
+  for (auto &each_ledger : resolved_block.contract_ledger_list) {
+    cacheContractLedger(each_ledger.second);
+  }
+  for (auto &each_cert : resolved_block.user_cert_list) {
+    m_user_cert_cache.erase(each_cert.second.uid);
+  }
+
+  return true;
+}
+
+void RdbController::insertBlock(soci::session &db_session, const Block &block) {
+  string block_id = block.getBlockId();
+  block_height_type block_height = block.getHeight();
+  string block_hash = block.getBlockHash();
+  timestamp_t block_time = block.getBlockTime();
+  timestamp_t block_pub_time = block.getBlockPubTime();
+  string prev_block_id = block.getPrevBlockId();
+  string pre_block_sig = block.getPrevBlockSig();
+  string block_prod_id = block.getBlockProdId();
+  string block_pro_sig = block.getBlockProdSig();
+  string tx_id = block.getTransactions().empty() ? string() : block.getTransactions()[0].getTxId();
+  string tx_root = block.getTxRoot();
+  string user_state_root = block.getUserStateRoot();
+  string contract_state_root = block.getContractStateRoot();
+  string sig_root = block.getSgRoot();
+  string block_cert = block.getBlockCert();
+
+  // clang-format off
+  soci::statement st = (db_session.prepare << "INSERT INTO blocks (block_id, block_height, block_hash, block_time, block_pub_time, block_prev_id, block_link, producer_id, producer_sig, txs, tx_root, us_state_root, cs_state_root, sg_root, certificate) VALUES (:block_id, :block_height, :block_hash, :block_time, :block_pub_time, :block_prev_id, :block_link, :producer_id, :producer_sig, :txs, :tx_root, :us_state_root, :cs_state_root, :sg_root, :certificate)",
+      soci::use(block_id), soci::use(block_height), soci::use(block_hash),
+      soci::use(block_time), soci::use(block_pub_time), soci::use(prev_block_id),
+      soci::use(pre_block_sig), soci::use(block_prod_id),
+      soci::use(block_pro_sig), soci::use(tx_id),
+      soci::use(tx_root), soci::use(user_state_root),
+      soci::use(contract_state_root), soci::use(sig_root),
+      soci::use(block_cert));
+  // clang-format on
+  st.execute(true);
+}
+
+void RdbController::insertTransactions(soci::session &db_session, const Block &block) {
+  const vector<Transaction> &transactions = block.getTransactions();
+  if (transactions.empty())
+    return;
+
+  vector<string> tx_ids, tx_contract_ids, tx_users, tx_user_pks, tx_receivers, tx_inputs, tx_agg_cbors;
+  vector<timestamp_t> tx_times;
+  vector<int> tx_fees, tx_positions;
+  string block_id = block.getBlockId();
+
+  for (auto &each_transaction : transactions) {
+    tx_ids.emplace_back(each_transaction.getTxId());
+    tx_times.emplace_back(each_transaction.getTxTime());
+    tx_contract_ids.emplace_back(each_transaction.getContractId());
+    tx_fees.emplace_back(each_transaction.getFee());
+    tx_users.emplace_back(each_transaction.getUserId());
+    tx_user_pks.emplace_back(each_transaction.getTxUserPk());
+    tx_receivers.emplace_back(each_transaction.getReceiverId());
+    tx_inputs.emplace_back(TypeConverter::bytesToString(each_transaction.getTxInputCbor()));
+    tx_agg_cbors.emplace_back(each_transaction.getTxAggCbor());
+    tx_positions.emplace_back(each_transaction.getTxPos());
+  }
+
+  executeInChunks(db_session, tx_ids.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO transactions (tx_id, tx_time, tx_contract_id, tx_fee_author, tx_fee_user, tx_user, tx_user_pk, tx_receiver, "
+                 "tx_input, tx_agg_cbor, block_id, tx_pos) VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(tx_ids[i], tx_times[i], tx_contract_ids[i], tx_fees[i], tx_fees[i], tx_users[i], tx_user_pks[i], tx_receivers[i],
+                        tx_inputs[i], tx_agg_cbors[i], block_id, tx_positions[i]);
+    }
+    return sql;
+  });
+}
+
+void RdbController::writeUserLedgers(soci::session &db_session, const map<string, user_ledger_type> &user_ledger_list) {
+  vector<const user_ledger_type *> ins_ledgers, upd_ledgers, del_ledgers;
+
+  for (auto &each_ledger : user_ledger_list) {
+    const user_ledger_type &ledger = each_ledger.second;
+    if (ledger.query_type == QueryType::INSERT) {
+      ins_ledgers.emplace_back(&ledger);
+    } else if (ledger.query_type == QueryType::UPDATE) {
+      upd_ledgers.emplace_back(&ledger);
+    } else if ((ledger.query_type == QueryType::DELETE) && (ledger.var_value.empty())) {
+      del_ledgers.emplace_back(&ledger);
+    } else
+      logger::ERROR("Error at writeUserLedgers");
+  }
+
+  executeInChunks(db_session, ins_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO user_scope (var_name, var_value, var_type, var_owner, up_time, up_block, tag, pid) VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      const user_ledger_type &ledger = *ins_ledgers[i];
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(ledger.var_name, ledger.var_value, ledger.var_type, ledger.uid, ledger.up_time, ledger.up_block, ledger.tag,
+                        ledger.pid);
+    }
+    return sql;
+  });
+
+  executeInChunks(db_session, upd_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "UPDATE user_scope SET var_value = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->var_value);
+    sql += " END, up_time = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->up_time);
+    sql += " END, up_block = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->up_block);
+    sql += " END WHERE pid IN ";
+    return sql + st.bindList(upd_ledgers, begin, end, [](const user_ledger_type *ledger) -> const string & { return ledger->pid; });
+  });
+
+  executeInChunks(db_session, del_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "DELETE FROM user_scope WHERE pid IN ";
+    return sql + st.bindList(del_ledgers, begin, end, [](const user_ledger_type *ledger) -> const string & { return ledger->pid; });
+  });
+}
+
+void RdbController::writeContractLedgers(soci::session &db_session, const map<string, contract_ledger_type> &contract_ledger_list) {
+  vector<const contract_ledger_type *> ins_ledgers, upd_ledgers, del_ledgers;
+
+  for (auto &each_ledger : contract_ledger_list) {
+    const contract_ledger_type &ledger = each_ledger.second;
+    if (ledger.query_type == QueryType::INSERT) {
+      ins_ledgers.emplace_back(&ledger);
+    } else if (ledger.query_type == QueryType::UPDATE) {
+      upd_ledgers.emplace_back(&ledger);
+    } else if ((ledger.query_type == QueryType::DELETE) && (ledger.var_value.empty())) {
+      del_ledgers.emplace_back(&ledger);
+    } else
+      logger::ERROR("Error at writeContractLedgers");
+  }
+
+  executeInChunks(db_session, ins_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO contract_scope (contract_id, var_name, var_value, var_type, var_info, up_time, up_block, pid) VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      const contract_ledger_type &ledger = *ins_ledgers[i];
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(ledger.cid, ledger.var_name, ledger.var_value, ledger.var_type, ledger.var_info, ledger.up_time, ledger.up_block,
+                        ledger.pid);
+    }
+    return sql;
+  });
+
+  executeInChunks(db_session, upd_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "UPDATE contract_scope SET var_value = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->var_value);
+    sql += " END, up_time = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->up_time);
+    sql += " END, up_block = CASE pid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_ledgers[i]->pid, upd_ledgers[i]->up_block);
+    sql += " END WHERE pid IN ";
+    return sql + st.bindList(upd_ledgers, begin, end, [](const contract_ledger_type *ledger) -> const string & { return ledger->pid; });
+  });
+
+  executeInChunks(db_session, del_ledgers.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "DELETE FROM contract_scope WHERE pid IN ";
+    return sql + st.bindList(del_ledgers, begin, end, [](const contract_ledger_type *ledger) -> const string & { return ledger->pid; });
+  });
+}
+
+void RdbController::writeUserAttributes(soci::session &db_session, const map<base58_type, user_attribute_type> &user_attribute_list) {
+  vector<const user_attribute_type *> attributes;
+  for (auto &each_attribute : user_attribute_list) {
+    attributes.emplace_back(&each_attribute.second);
+  }
+
+  executeInChunks(db_session, attributes.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO user_attributes (uid, register_day, register_code, gender, isc_type, isc_code, location, age_limit, sigma) "
+                 "VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      const user_attribute_type &attribute = *attributes[i];
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(attribute.uid, attribute.register_day, attribute.register_code, attribute.gender, attribute.isc_type,
+                        attribute.isc_code, attribute.location, attribute.age_limit, attribute.sigma);
+    }
+    sql += " ON DUPLICATE KEY UPDATE register_day = VALUES(register_day), register_code = VALUES(register_code), gender = VALUES(gender), "
+           "isc_type = VALUES(isc_type), isc_code = VALUES(isc_code), location = VALUES(location), age_limit = VALUES(age_limit), "
+           "sigma = VALUES(sigma)";
+    return sql;
+  });
+}
+
+void RdbController::writeUserCerts(soci::session &db_session, const map<base58_type, user_cert_type> &user_cert_list) {
+  vector<const user_cert_type *> certs;
+  for (auto &each_cert : user_cert_list) {
+    certs.emplace_back(&each_cert.second);
+  }
+
+  executeInChunks(db_session, certs.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO user_certificates (uid, sn, nvbefore, nvafter, x509) VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(certs[i]->uid, certs[i]->sn, certs[i]->nvbefore, certs[i]->nvafter, certs[i]->x509);
+    }
+    return sql;
+  });
+}
+
+void RdbController::writeContracts(soci::session &db_session, const map<contract_id_type, contract_type> &contract_list) {
+  vector<const contract_type *> ins_contracts, upd_contracts;
+
+  for (auto &each_contract : contract_list) {
+    const contract_type &contract = each_contract.second;
+    if (contract.query_type == QueryType::INSERT) {
+      ins_contracts.emplace_back(&contract);
+    } else if (contract.query_type == QueryType::UPDATE) {
+      upd_contracts.emplace_back(&contract);
+    } else
+      logger::ERROR("Error at writeContracts");
+  }
+
+  executeInChunks(db_session, ins_contracts.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "INSERT INTO contracts (cid, `after`, `before`, author, friends, contract, `desc`, sigma) VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      const contract_type &contract = *ins_contracts[i];
+      sql += (i == begin ? "" : ", ");
+      sql += st.bindRow(contract.cid, contract.after, contract.before, contract.author, contract.friends, contract.contract, contract.desc,
+                        contract.sigma);
+    }
+    return sql;
+  });
+
+  executeInChunks(db_session, upd_contracts.size(), [&](MultiRowStatement &st, size_t begin, size_t end) {
+    string sql = "UPDATE contracts SET `before` = CASE cid";
+    for (size_t i = begin; i < end; ++i)
+      sql += st.bindWhen(upd_contracts[i]->cid, upd_contracts[i]->before);
+    sql += " END WHERE cid IN ";
+    return sql + st.bindList(upd_contracts, begin, end, [](const contract_type *contract) -> const string & { return contract->cid; });
+  });
+}
+
+void RdbController::cacheUserLedger(const user_ledger_type &user_ledger) {
+  if (user_ledger.query_type == QueryType::INSERT) {
+    user_ledger_type cached_ledger = user_ledger;
+    cached_ledger.is_empty = false;
+    m_user_scope_cache.put(user_ledger.pid, cached_ledger);
+  } else if (user_ledger.query_type == QueryType::UPDATE) {
+    m_user_scope_cache.update(user_ledger.pid, [&](user_ledger_type &cached_ledger) {
+      cached_ledger.var_value = user_ledger.var_value;
+      cached_ledger.up_time = user_ledger.up_time;
+      cached_ledger.up_block = user_ledger.up_block;
+    });
+  } else if ((user_ledger.query_type == QueryType::DELETE) && (user_ledger.var_value.empty())) {
+    m_user_scope_cache.put(user_ledger.pid, user_ledger_type{});
+  }
+
+  if (user_ledger.query_type != QueryType::UPDATE && user_ledger.tag.empty())
+    m_var_type_cache.erase(varTypeCacheKey(user_ledger.uid, user_ledger.var_name));
+}
+
+void RdbController::cacheContractLedger(const contract_ledger_type &contract_ledger) {
+  if (contract_ledger.query_type == QueryType::INSERT) {
+    contract_ledger_type cached_ledger = contract_ledger;
+    cached_ledger.is_empty = false;
+    m_contract_scope_cache.put(contract_ledger.pid, cached_ledger);
+  } else if (contract_ledger.query_type == QueryType::UPDATE) {
+    m_contract_scope_cache.update(contract_ledger.pid, [&](contract_ledger_type &cached_ledger) {
+      cached_ledger.var_value = contract_ledger.var_value;
+      cached_ledger.up_time = contract_ledger.up_time;
+      cached_ledger.up_block = contract_ledger.up_block;
+    });
+  } else if ((contract_ledger.query_type == QueryType::DELETE) && (contract_ledger.var_value.empty())) {
+    m_contract_scope_cache.put(contract_ledger.pid, contract_ledger_type{});
+  }
+
+  if (contract_ledger.query_type != QueryType::UPDATE && contract_ledger.var_info.empty())
+    m_var_type_cache.erase(varTypeCacheKey(contract_ledger.cid, contract_ledger.var_name));
+}
+
 vector<Block> RdbController::getBlocks(const int from, const int to) {
   try {
     stringstream condition;
@@ -760,12 +1140,17 @@ Block RdbController::rowToBlock(const soci::row &r) {
 
 string RdbController::getUserCert(const base58_type &user_id) {
   // TODO: 위의 queryCertGet과 동일한 동작을 한다. 통합 검토.
+  string user_cert = {};
+  if (m_user_cert_cache.get(user_id, user_cert))
+    return user_cert;
+
+  uint64_t cache_generation = m_user_cert_cache.getGeneration(user_id);
   try {
-    string user_cert = {};
     soci::session db_session(RdbController::pool());
     soci::statement st = (db_session.prepare << "SELECT x509 FROM user_certificates WHERE uid = " + user_id, soci::into(user_cert));
     st.execute(true);
 
+    m_user_cert_cache.fill(user_id, user_cert, cache_generation);
     return user_cert;
   } catch (const std::exception &e) {
     logger::ERROR("Failed to get user_cert: {}", e.what());
@@ -773,6 +1158,61 @@ string RdbController::getUserCert(const base58_type &user_id) {
   }
 }
 
+map<base58_type, string> RdbController::getUserCerts(const vector<base58_type> &user_ids) {
+  map<base58_type, string> user_certs;
+  map<base58_type, uint64_t> missed_ids; // uid -> 조회 전 cache generation. 같은 signer가 여러 번 있어도 한 번만 조회한다
+  for (auto &each_id : user_ids) {
+    string user_cert;
+    if (user_certs.count(each_id) > 0 || missed_ids.count(each_id) > 0)
+      continue;
+
+    if (m_user_cert_cache.get(each_id, user_cert))
+      user_certs[each_id] = user_cert;
+    else
+      missed_ids.emplace(each_id, m_user_cert_cache.getGeneration(each_id));
+  }
+
+  if (missed_ids.empty())
+    return user_certs;
+
+  // 문자열로 조건을 만들므로 base58 문자로만 된 uid만 조회한다
+  static const string base58_chars = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+  stringstream condition;
+  size_t condition_num = 0;
+  for (auto &[each_id, cache_generation] : missed_ids) {
+    if (each_id.empty() || each_id.find_first_not_of(base58_chars) != string::npos) {
+      logger::ERROR("Invalid uid for user_cert: {}", each_id);
+      continue;
+    }
+    condition << (condition_num++ == 0 ? "'" : ", '") << each_id << "'";
+  }
+
+  if (condition_num == 0)
+    return user_certs;
+
+  try {
+    soci::session db_session(RdbController::pool());
+    soci::rowset<soci::row> rs = (db_session.prepare << "SELECT uid, x509 FROM user_certificates WHERE uid IN (" + condition.str() + ")");
+
+    // 한 uid에 인증서가 여럿이면 getUserCert처럼 처음 읽은 것을 쓴다
+    map<base58_type, string> found_certs;
+    for (auto &row : rs) {
+      found_certs.emplace(row.get<string>(0), row.get<string>(1));
+    }
+
+    for (auto &[each_id, cache_generation] : missed_ids) {
+      auto found_it = found_certs.find(each_id);
+      string user_cert = (found_it != found_certs.end()) ? found_it->second : string();
+      m_user_cert_cache.fill(each_id, user_cert, cache_generation);
+      user_certs[each_id] = user_cert;
+    }
+  } catch (const std::exception &e) {
+    logger::ERROR("Failed to get user_certs: {}", e.what());
+  }
+
+  return user_certs;
+}
+
 // bool RdbController::queryRunQuery(std::vector<LedgerRecord> &mem_ledger, nlohmann::json &option, result_query_info_type &result_info) {
 //  string type = json::get<string>(option, "type").value();
 //  nlohmann::json query = option["query"];
@@ -797,6 +1237,13 @@ string RdbController::getUserCert(const base58_type &user_id) {
 //}
 
 int RdbController::getVarTypeFromRDB(const string &var_owner, const string &var_name) {
+  int cached_var_type;
+  string cache_key = varTypeCacheKey(var_owner, var_name);
+  if (m_var_type_cache.get(cache_key, cached_var_type))
+    return cached_var_type;
+
+  // 조회하는 동안 persistence stage가 블록을 commit 했으면, 조회 결과(NO_VALUE 등)를 cache에 남기지 않는다
+  uint64_t cache_generation = m_var_type_cache.getGeneration(cache_key);
   try {
     short var_type = 0;
     soci::row result;
@@ -815,11 +1262,14 @@ int RdbController::getVarTypeFromRDB(const string &var_owner, const string &var_
 
     int num_rows = (int)st.get_affected_rows();
     if (num_rows == 1)
-      return var_type;
+      cached_var_type = var_type;
     else if (num_rows == 0)
-      return (int)UniqueCheck::NO_VALUE;
+      cached_var_type = (int)UniqueCheck::NO_VALUE;
     else
-      return (int)UniqueCheck::NOT_UNIQUE;
+      cached_var_type = (int)UniqueCheck::NOT_UNIQUE;
+
+    m_var_type_cache.fill(cache_key, cached_var_type, cache_generation);
+    return cached_var_type;
 
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
@@ -832,6 +1282,10 @@ int RdbController::getVarTypeFromRDB(const string &var_owner, const string &var_
 
 user_ledger_type RdbController::findUserScopeFromRDB(const string &pid) {
   user_ledger_type user_ledger;
+  if (m_user_scope_cache.get(pid, user_ledger))
+    return user_ledger;
+
+  uint64_t cache_generation = m_user_scope_cache.getGeneration(pid);
   try {
     string var_name, var_value, var_owner, tag;
     short var_type;
@@ -859,6 +1313,8 @@ user_ledger_type RdbController::findUserScopeFromRDB(const string &pid) {
       user_ledger.pid = pid;
       user_ledger.is_empty = false;
     }
+
+    m_user_scope_cache.fill(pid, user_ledger, cache_generation);
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
   } catch (...) {
@@ -869,6 +1325,10 @@ user_ledger_type RdbController::findUserScopeFromRDB(const string &pid) {
 
 contract_ledger_type RdbController::findContractScopeFromRDB(const string &pid) {
   contract_ledger_type contract_ledger;
+  if (m_contract_scope_cache.get(pid, contract_ledger))
+    return contract_ledger;
+
+  uint64_t cache_generation = m_contract_scope_cache.getGeneration(pid);
   try {
     string var_name, var_value, contract_id, var_info;
     short var_type;
@@ -896,6 +1356,8 @@ contract_ledger_type RdbController::findContractScopeFromRDB(const string &pid)
       contract_ledger.pid = pid;
       contract_ledger.is_empty = false;
     }
+
+    m_contract_scope_cache.fill(pid, contract_ledger, cache_generation);
   } catch (soci::mysql_soci_error const &e) {
     logger::ERROR("MySQL error: {}", e.what());
   } catch (...) {
@@ -980,6 +1442,31 @@ vector<contract_ledger_type> RdbController::getAllContractLedger() {
   return contract_ledger_list;
 }
 
+nlohmann::json RdbController::getCacheStats() {
+  auto cacheStat = [](auto &cache) {
+    nlohmann::json stat;
+    uint64_t hit_count = cache.getHitCount();
+    uint64_t miss_count = cache.getMissCount();
+
+    stat["size"] = cache.size();
+    stat["hit"] = hit_count;
+    stat["miss"] = miss_count;
+    stat["hit_rate"] = (hit_count + miss_count == 0) ? 0.0 : (double)hit_count / (double)(hit_count + miss_count);
+    return stat;
+  };
+
+  nlohmann::json stats;
+  stats["user_scope"] = cacheStat(m_user_scope_cache);
+  stats["contract_scope"] = cacheStat(m_contract_scope_cache);
+  stats["var_type"] = cacheStat(m_var_type_cache);
+  stats["user_cert"] = cacheStat(m_user_cert_cache);
+  return stats;
+}
+
+string RdbController::varTypeCacheKey(const string &var_owner, const string &var_name) {
+  return var_owner + '\x1f' + var_name;
+}
+
 bool RdbController::isUserId(const string &id) {
   const auto BASE58_REGEX = "^[A-HJ-NP-Za-km-z1-9]*$";
   regex rgx(BASE58_REGEX);
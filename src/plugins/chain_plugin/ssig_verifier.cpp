@@ -0,0 +1,52 @@
+#include "include/ssig_verifier.hpp"
+#include "../../../lib/tethys-utils/src/ags.hpp"
+#include "config/storage_config.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace tethys {
+
+SSigBatchVerifier::SSigBatchVerifier(WorkerPool &worker_pool) : m_worker_pool(worker_pool) {}
+
+bool SSigBatchVerifier::verifyAll(const std::string &message, const std::vector<std::pair<std::string, std::string>> &cert_sigs) {
+  size_t chunk_num = (cert_sigs.size() + config::SSIG_VERIFY_CHUNK_SIZE - 1) / config::SSIG_VERIFY_CHUNK_SIZE;
+  std::atomic<bool> failed{false};
+
+  m_worker_pool.parallelFor(chunk_num, [&](size_t chunk_idx) {
+    AGS ags;
+    size_t begin = chunk_idx * config::SSIG_VERIFY_CHUNK_SIZE;
+    size_t end = std::min(begin + config::SSIG_VERIFY_CHUNK_SIZE, cert_sigs.size());
+    for (size_t i = begin; i < end; ++i) {
+      if (failed.load(std::memory_order_relaxed))
+        return;
+
+      if (!ags.verifyPEM(cert_sigs[i].first, message, cert_sigs[i].second)) {
+        failed = true;
+        return;
+      }
+    }
+  });
+
+  return !failed;
+}
+
+std::vector<bool> SSigBatchVerifier::verifyEach(const std::string &message,
+                                                const std::vector<std::pair<std::string, std::string>> &cert_sigs) {
+  // vector<bool>은 원소끼리 같은 byte를 공유하므로 worker에서는 따로 담는다
+  std::vector<uint8_t> results(cert_sigs.size(), 0);
+  size_t chunk_num = (cert_sigs.size() + config::SSIG_VERIFY_CHUNK_SIZE - 1) / config::SSIG_VERIFY_CHUNK_SIZE;
+
+  m_worker_pool.parallelFor(chunk_num, [&](size_t chunk_idx) {
+    AGS ags;
+    size_t begin = chunk_idx * config::SSIG_VERIFY_CHUNK_SIZE;
+    size_t end = std::min(begin + config::SSIG_VERIFY_CHUNK_SIZE, cert_sigs.size());
+    for (size_t i = begin; i < end; ++i) {
+      results[i] = ags.verifyPEM(cert_sigs[i].first, message, cert_sigs[i].second) ? 1 : 0;
+    }
+  });
+
+  return std::vector<bool>(results.begin(), results.end());
+}
+
+} // namespace tethys
@@ -0,0 +1,427 @@
+#include "include/state_checkpoint.hpp"
+#include "include/binary_codec.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
+namespace tethys {
+
+namespace {
+
+const string SNAPSHOT_META_KEY = "snapshot_meta";
+const base58_type SNAPSHOT_VERSION_ID = "state_snapshot"; // 기록하는 동안 잡아두는 version. base58이 아니므로 block id와 겹치지 않는다
+constexpr int CHECKPOINT_FORMAT_VERSION = 1;
+
+void appendNode(string &out, const StateNode &node) {
+  out.append(reinterpret_cast<const char *>(node.hash_value.data()), node.hash_value.size());
+  appendUint(out, node.left, 4);
+  appendUint(out, node.right, 4);
+  appendUint(out, node.ledger_idx, 4);
+}
+
+bool readNode(BinaryReader &reader, StateNode &node) {
+  uint64_t left, right, ledger_idx;
+  if (!reader.readBytes(node.hash_value.data(), node.hash_value.size()) || !reader.readUint(left, 4) || !reader.readUint(right, 4) ||
+      !reader.readUint(ledger_idx, 4))
+    return false;
+
+  node.left = static_cast<state_node_idx_type>(left);
+  node.right = static_cast<state_node_idx_type>(right);
+  node.ledger_idx = static_cast<state_node_idx_type>(ledger_idx);
+  return true;
+}
+
+uint64_t getChunkNum(uint64_t item_num, uint64_t chunk_size) {
+  return (item_num + chunk_size - 1) / chunk_size;
+}
+
+// chunk들을 차례로 읽어 item_num개의 항목을 꺼낸다
+template <typename T, typename KeyMaker>
+bool loadItems(KvController &kv_controller, uint64_t item_num, uint64_t chunk_size, KeyMaker &&make_key, vector<T> &items,
+               bool (*read_item)(BinaryReader &, T &)) {
+  items.reserve(item_num);
+
+  for (uint64_t chunk_idx = 0; chunk_idx < getChunkNum(item_num, chunk_size); ++chunk_idx) {
+    string chunk = kv_controller.loadStateCheckpoint(make_key(chunk_idx));
+    BinaryReader reader(chunk);
+    while (!reader.atEnd()) {
+      T item;
+      if (!read_item(reader, item))
+        return false;
+      items.emplace_back(std::move(item));
+    }
+  }
+
+  return items.size() == item_num;
+}
+
+nlohmann::json treeMetaToJson(uint64_t node_num, uint64_t user_ledger_num, uint64_t contract_ledger_num, const string &root_value) {
+  nlohmann::json tree_json;
+  tree_json["node_num"] = to_string(node_num);
+  tree_json["user_ledger_num"] = to_string(user_ledger_num);
+  tree_json["contract_ledger_num"] = to_string(contract_ledger_num);
+  tree_json["root"] = TypeConverter::encodeBase<64>(root_value);
+  return tree_json;
+}
+
+} // namespace
+
+StateCheckpoint::StateCheckpoint(KvController &kv_controller) : m_kv_controller(kv_controller) {
+  loadMeta();
+}
+
+StateCheckpoint::~StateCheckpoint() {
+  stopSnapshot();
+}
+
+string StateCheckpoint::makeDiffKey(block_height_type height) {
+  // height 순서대로 정렬되도록 자리수를 맞춘다
+  std::stringstream key;
+  key << "diff_" << std::setw(20) << std::setfill('0') << height;
+  return key.str();
+}
+
+string StateCheckpoint::makeChunkKey(block_height_type height, const string &tree_name, const string &part_name, uint64_t chunk_idx) {
+  return "snapshot_" + to_string(height) + "_" + tree_name + "_" + part_name + "_" + to_string(chunk_idx);
+}
+
+bool StateCheckpoint::saveDiff(const UnresolvedBlock &resolved_block) {
+  string serialized_diff;
+  appendUint(serialized_diff, CHECKPOINT_FORMAT_VERSION, 1);
+
+  appendUint(serialized_diff, resolved_block.user_ledger_list.size(), 4);
+  for (auto &each_ledger : resolved_block.user_ledger_list) {
+    appendLedger(serialized_diff, each_ledger.second);
+  }
+
+  appendUint(serialized_diff, resolved_block.contract_ledger_list.size(), 4);
+  for (auto &each_ledger : resolved_block.contract_ledger_list) {
+    appendLedger(serialized_diff, each_ledger.second);
+  }
+
+  return m_kv_controller.saveStateCheckpoint(makeDiffKey(resolved_block.block.getHeight()), serialized_diff, true);
+}
+
+bool StateCheckpoint::loadDiff(block_height_type height, vector<user_ledger_type> &user_ledgers,
+                               vector<contract_ledger_type> &contract_ledgers) {
+  string serialized_diff = m_kv_controller.loadStateCheckpoint(makeDiffKey(height));
+  BinaryReader reader(serialized_diff);
+
+  uint64_t format_version, ledger_num;
+  if (!reader.readUint(format_version, 1) || format_version != CHECKPOINT_FORMAT_VERSION || !reader.readUint(ledger_num, 4))
+    return false;
+
+  user_ledgers.resize(ledger_num);
+  for (auto &each_ledger : user_ledgers) {
+    if (!readLedger(reader, each_ledger))
+      return false;
+  }
+
+  if (!reader.readUint(ledger_num, 4))
+    return false;
+
+  contract_ledgers.resize(ledger_num);
+  for (auto &each_ledger : contract_ledgers) {
+    if (!readLedger(reader, each_ledger))
+      return false;
+  }
+
+  return reader.atEnd();
+}
+
+bool StateCheckpoint::saveTree(const StateTree &tree, std::shared_mutex &tree_mutex, block_height_type height, const string &tree_name,
+                               TreeMeta &tree_meta) {
+  const uint64_t chunk_size = config::STATE_CHECKPOINT_CHUNK_SIZE;
+  bool save_result = true;
+  string node_chunk, user_chunk, contract_chunk;
+
+  // chunk가 가득 차면 바로 기록한다. 기록하는 동안은 lock을 풀어 io thread가 tree를 갱신할 수 있게 한다
+  std::shared_lock<std::shared_mutex> lock(tree_mutex);
+  auto count_item = [&](string &chunk, uint64_t &item_num, const string &part_name) {
+    if (++item_num % chunk_size != 0)
+      return;
+
+    lock.unlock();
+    if (m_stopping)
+      save_result = false;
+    else
+      save_result &= m_kv_controller.saveStateCheckpoint(makeChunkKey(height, tree_name, part_name, item_num / chunk_size - 1), chunk);
+    chunk.clear();
+    lock.lock();
+  };
+
+  tree_meta = TreeMeta{};
+  bool exported = tree.exportVersion(
+      SNAPSHOT_VERSION_ID,
+      [&](const StateNode &node) {
+        // 첫 노드가 root. 자식이 없으면 빈 tree
+        if (tree_meta.node_num == 0 && (node.left != NIL_NODE_IDX || node.right != NIL_NODE_IDX))
+          tree_meta.root_value.assign(node.hash_value.begin(), node.hash_value.end());
+
+        appendNode(node_chunk, node);
+        count_item(node_chunk, tree_meta.node_num, "node");
+      },
+      [&](const user_ledger_type &ledger) {
+        appendLedger(user_chunk, ledger);
+        count_item(user_chunk, tree_meta.user_ledger_num, "user");
+      },
+      [&](const contract_ledger_type &ledger) {
+        appendLedger(contract_chunk, ledger);
+        count_item(contract_chunk, tree_meta.contract_ledger_num, "contract");
+      });
+  lock.unlock();
+
+  if (!exported) {
+    logger::ERROR("State snapshot: {} tree has no version of height {}", tree_name, height);
+    return false;
+  }
+
+  if (!save_result || m_stopping)
+    return false;
+
+  // 마지막 chunk
+  if (!node_chunk.empty())
+    save_result &=
+        m_kv_controller.saveStateCheckpoint(makeChunkKey(height, tree_name, "node", tree_meta.node_num / chunk_size), node_chunk);
+  if (!user_chunk.empty())
+    save_result &=
+        m_kv_controller.saveStateCheckpoint(makeChunkKey(height, tree_name, "user", tree_meta.user_ledger_num / chunk_size), user_chunk);
+  if (!contract_chunk.empty())
+    save_result &= m_kv_controller.saveStateCheckpoint(
+        makeChunkKey(height, tree_name, "contract", tree_meta.contract_ledger_num / chunk_size), contract_chunk);
+
+  return save_result;
+}
+
+bool StateCheckpoint::startSnapshot(StateTree &us_tree, StateTree &cs_tree, std::shared_mutex &tree_mutex, const base58_type &block_id,
+                                    block_height_type height) {
+  if (m_saving)
+    return false;
+
+  // 이전에 기록을 마친 thread를 정리한다
+  if (m_snapshot_worker.joinable())
+    m_snapshot_worker.join();
+
+  {
+    std::unique_lock<std::shared_mutex> lock(tree_mutex);
+    if (!us_tree.copyVersion(block_id, SNAPSHOT_VERSION_ID) || !cs_tree.copyVersion(block_id, SNAPSHOT_VERSION_ID)) {
+      us_tree.releaseVersion(SNAPSHOT_VERSION_ID);
+      logger::ERROR("State snapshot: no version of {}", block_id);
+      return false;
+    }
+  }
+
+  m_saving = true;
+  m_stopping = false;
+  m_snapshot_worker = std::thread([this, &us_tree, &cs_tree, &tree_mutex, block_id, height]() {
+    saveSnapshot(us_tree, cs_tree, tree_mutex, block_id, height);
+
+    {
+      std::unique_lock<std::shared_mutex> lock(tree_mutex);
+      us_tree.releaseVersion(SNAPSHOT_VERSION_ID);
+      cs_tree.releaseVersion(SNAPSHOT_VERSION_ID);
+    }
+    m_saving = false;
+  });
+  return true;
+}
+
+bool StateCheckpoint::isSaving() const {
+  return m_saving;
+}
+
+void StateCheckpoint::waitSnapshot() {
+  if (m_snapshot_worker.joinable())
+    m_snapshot_worker.join();
+}
+
+void StateCheckpoint::stopSnapshot() {
+  m_stopping = true;
+  waitSnapshot();
+}
+
+bool StateCheckpoint::saveSnapshot(const StateTree &us_tree, const StateTree &cs_tree, std::shared_mutex &tree_mutex,
+                                   const base58_type &block_id, block_height_type height) {
+  auto start_time = std::chrono::steady_clock::now();
+
+  TreeMeta us_meta, cs_meta;
+  if (!saveTree(us_tree, tree_mutex, height, "us", us_meta) || !saveTree(cs_tree, tree_mutex, height, "cs", cs_meta)) {
+    if (m_stopping)
+      logger::INFO("State snapshot at height {} is stopped", height);
+    else
+      logger::ERROR("Failed to save state snapshot at height {}", height);
+    return false;
+  }
+
+  nlohmann::json meta_json;
+  meta_json["format"] = CHECKPOINT_FORMAT_VERSION;
+  meta_json["height"] = to_string(height);
+  meta_json["block_id"] = block_id;
+  meta_json["hash_version"] = static_cast<int>(us_tree.getHashVersion());
+  meta_json["chunk_size"] = to_string(config::STATE_CHECKPOINT_CHUNK_SIZE);
+  meta_json["us"] = treeMetaToJson(us_meta.node_num, us_meta.user_ledger_num, us_meta.contract_ledger_num, us_meta.root_value);
+  meta_json["cs"] = treeMetaToJson(cs_meta.node_num, cs_meta.user_ledger_num, cs_meta.contract_ledger_num, cs_meta.root_value);
+
+  // meta를 마지막에 sync로 기록한다. 그 전에 멈추면 이전 snapshot이 그대로 유효하다
+  if (!m_kv_controller.saveStateCheckpoint(SNAPSHOT_META_KEY, TypeConverter::bytesToString(nlohmann::json::to_cbor(meta_json)), true)) {
+    logger::ERROR("Failed to save state snapshot meta at height {}", height);
+    return false;
+  }
+
+  // 이전 snapshot의 chunk와 새 snapshot에 이미 반영된 diff를 지운다. 같은 height에 다시 쓴 경우 새 chunk는 남긴다
+  vector<string> obsolete_keys;
+  if (m_has_snapshot) {
+    vector<string> new_keys = getSnapshotKeys(height, config::STATE_CHECKPOINT_CHUNK_SIZE, "us", us_meta);
+    vector<string> new_cs_keys = getSnapshotKeys(height, config::STATE_CHECKPOINT_CHUNK_SIZE, "cs", cs_meta);
+    std::unordered_set<string> new_key_set(new_keys.begin(), new_keys.end());
+    new_key_set.insert(new_cs_keys.begin(), new_cs_keys.end());
+
+    for (auto &tree_keys : {getSnapshotKeys(m_snapshot_height, m_snapshot_chunk_size, "us", m_us_meta),
+                            getSnapshotKeys(m_snapshot_height, m_snapshot_chunk_size, "cs", m_cs_meta)}) {
+      for (auto &each_key : tree_keys) {
+        if (new_key_set.count(each_key) == 0)
+          obsolete_keys.emplace_back(each_key);
+      }
+    }
+
+    for (block_height_type diff_height = m_snapshot_height + 1; diff_height <= height; ++diff_height) {
+      obsolete_keys.emplace_back(makeDiffKey(diff_height));
+    }
+  }
+  m_kv_controller.delStateCheckpoint(obsolete_keys);
+
+  {
+    std::lock_guard<std::mutex> guard(m_meta_mutex);
+    m_has_snapshot = true;
+    m_snapshot_height = height;
+    m_snapshot_block_id = block_id;
+    m_snapshot_chunk_size = config::STATE_CHECKPOINT_CHUNK_SIZE;
+    m_snapshot_hash_version = us_tree.getHashVersion();
+    m_us_meta = us_meta;
+    m_cs_meta = cs_meta;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed_ms = std::chrono::steady_clock::now() - start_time;
+  logger::INFO("State snapshot at height {} is saved ({} user / {} contract ledgers, {} ms)", height, us_meta.user_ledger_num,
+               cs_meta.contract_ledger_num, elapsed_ms.count());
+  return true;
+}
+
+bool StateCheckpoint::loadTree(StateTree &tree, const string &tree_name, const TreeMeta &tree_meta) {
+  vector<StateNode> nodes;
+  vector<user_ledger_type> user_ledgers;
+  vector<contract_ledger_type> contract_ledgers;
+
+  auto make_key = [this, &tree_name](const string &part_name) {
+    return [this, &tree_name, part_name](uint64_t chunk_idx) { return makeChunkKey(m_snapshot_height, tree_name, part_name, chunk_idx); };
+  };
+
+  if (!loadItems<StateNode>(m_kv_controller, tree_meta.node_num, m_snapshot_chunk_size, make_key("node"), nodes, readNode) ||
+      !loadItems<user_ledger_type>(m_kv_controller, tree_meta.user_ledger_num, m_snapshot_chunk_size, make_key("user"), user_ledgers,
+                                   readLedger) ||
+      !loadItems<contract_ledger_type>(m_kv_controller, tree_meta.contract_ledger_num, m_snapshot_chunk_size, make_key("contract"),
+                                       contract_ledgers, readLedger)) {
+    logger::ERROR("State snapshot: {} tree chunks at height {} are broken", tree_name, m_snapshot_height);
+    return false;
+  }
+
+  if (!tree.importTree(std::move(nodes), std::move(user_ledgers), std::move(contract_ledgers))) {
+    logger::ERROR("State snapshot: {} tree at height {} has invalid structure", tree_name, m_snapshot_height);
+    return false;
+  }
+
+  vector<uint8_t> root_value = tree.getRootValue();
+  if (string(root_value.begin(), root_value.end()) != tree_meta.root_value) {
+    logger::ERROR("State snapshot: {} tree root at height {} does not match", tree_name, m_snapshot_height);
+    return false;
+  }
+
+  return true;
+}
+
+bool StateCheckpoint::loadSnapshot(StateTree &us_tree, StateTree &cs_tree, WorkerPool &worker_pool, base58_type &block_id,
+                                   block_height_type &height) {
+  if (!m_has_snapshot)
+    return false;
+
+  if (us_tree.getHashVersion() != m_snapshot_hash_version || cs_tree.getHashVersion() != m_snapshot_hash_version) {
+    logger::ERROR("State snapshot: hash version is different from the current setting");
+    return false;
+  }
+
+  bool us_result = false, cs_result = false;
+  worker_pool.parallelFor(2, [&](size_t tree_idx) {
+    if (tree_idx == 0)
+      us_result = loadTree(us_tree, "us", m_us_meta);
+    else
+      cs_result = loadTree(cs_tree, "cs", m_cs_meta);
+  });
+
+  if (!us_result || !cs_result)
+    return false;
+
+  block_id = m_snapshot_block_id;
+  height = m_snapshot_height;
+  return true;
+}
+
+bool StateCheckpoint::hasSnapshot() const {
+  std::lock_guard<std::mutex> guard(m_meta_mutex);
+  return m_has_snapshot;
+}
+
+block_height_type StateCheckpoint::getSnapshotHeight() const {
+  std::lock_guard<std::mutex> guard(m_meta_mutex);
+  return m_snapshot_height;
+}
+
+vector<string> StateCheckpoint::getSnapshotKeys(block_height_type height, uint64_t chunk_size, const string &tree_name,
+                                                const TreeMeta &tree_meta) {
+  vector<string> keys;
+  for (auto &[part_name, item_num] :
+       {std::make_pair("node", tree_meta.node_num), std::make_pair("user", tree_meta.user_ledger_num),
+        std::make_pair("contract", tree_meta.contract_ledger_num)}) {
+    for (uint64_t chunk_idx = 0; chunk_idx < getChunkNum(item_num, chunk_size); ++chunk_idx) {
+      keys.emplace_back(makeChunkKey(height, tree_name, part_name, chunk_idx));
+    }
+  }
+  return keys;
+}
+
+void StateCheckpoint::loadMeta() {
+  string serialized_meta = m_kv_controller.loadStateCheckpoint(SNAPSHOT_META_KEY);
+  if (serialized_meta.empty())
+    return;
+
+  try {
+    nlohmann::json meta_json = nlohmann::json::from_cbor(serialized_meta);
+    if (meta_json["format"].get<int>() != CHECKPOINT_FORMAT_VERSION) {
+      logger::ERROR("State snapshot: unknown format {}", meta_json["format"].get<int>());
+      return;
+    }
+
+    auto tree_meta_from_json = [](const nlohmann::json &tree_json) {
+      TreeMeta tree_meta;
+      tree_meta.node_num = stoull(tree_json["node_num"].get<string>());
+      tree_meta.user_ledger_num = stoull(tree_json["user_ledger_num"].get<string>());
+      tree_meta.contract_ledger_num = stoull(tree_json["contract_ledger_num"].get<string>());
+      tree_meta.root_value = TypeConverter::decodeBase<64>(tree_json["root"].get<string>());
+      return tree_meta;
+    };
+
+    m_snapshot_height = stoull(meta_json["height"].get<string>());
+    m_snapshot_block_id = meta_json["block_id"].get<string>();
+    m_snapshot_hash_version = static_cast<StateHashVersion>(meta_json["hash_version"].get<int>());
+    m_snapshot_chunk_size = stoull(meta_json["chunk_size"].get<string>());
+    m_us_meta = tree_meta_from_json(meta_json["us"]);
+    m_cs_meta = tree_meta_from_json(meta_json["cs"]);
+    m_has_snapshot = (m_snapshot_chunk_size > 0);
+  } catch (...) {
+    logger::ERROR("State snapshot: failed to parse meta");
+    m_has_snapshot = false;
+  }
+}
+
+} // namespace tethys
@@ -152,14 +152,18 @@ public:
 
   bool setTransaction(std::vector<txagg_cbor_b64> &txagg) {
     m_transactions.clear();
+    m_transactions.reserve(txagg.size());
     for (auto &each_txagg : txagg) {
-      nlohmann::json each_txs_json;
-      each_txs_json = nlohmann::json::from_cbor(TypeConverter::decodeBase<64>(each_txagg));
+      string txagg_cbor = TypeConverter::decodeBase<64>(each_txagg);
 
+      // txagg마다 json DOM을 만들지 않고 CBOR에서 바로 읽는다. 예상과 다른 형태일 때만 DOM을 거쳐 예전과 같이 처리
       Transaction each_tx;
-      block_info_type block_info(each_txagg, getBlockId());
-      each_tx.inputMsgTxAgg(each_txs_json, block_info);
-      m_transactions.emplace_back(each_tx);
+      block_info_type block_info(each_txagg, m_block_id);
+      if (!each_tx.inputTxAggCbor(txagg_cbor, block_info)) {
+        each_tx = Transaction();
+        each_tx.inputMsgTxAgg(nlohmann::json::from_cbor(txagg_cbor), block_info);
+      }
+      m_transactions.emplace_back(std::move(each_tx));
     }
     return true;
   }
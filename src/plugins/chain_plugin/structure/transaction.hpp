@@ -8,11 +8,13 @@
 #include "../../../../lib/tethys-utils/src/sha256.hpp"
 #include "../../../../lib/tethys-utils/src/type_converter.hpp"
 #include "../config/storage_type.hpp"
+#include "../include/cbor_reader.hpp"
 #include "endorser.hpp"
 
 #include <array>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tethys {
@@ -127,6 +129,211 @@ public:
     }
   }
 
+  bool inputTxAggCbor(std::string_view txagg_cbor, const block_info_type &block_info) {
+    if (!inputTxAggCbor(txagg_cbor))
+      return false;
+
+    m_tx_agg_cbor = block_info.tx_agg_cbor;
+    m_block_id = block_info.block_id;
+    return true;
+  }
+
+  // inputMsgTxAgg(nlohmann::json::from_cbor(txagg_cbor))와 같은 값을 json DOM 없이 CBOR에서 바로 채운다.
+  // 필드가 빠졌거나 예상과 다른 형태이면 false를 돌려주고, 이때는 DOM을 거치는 inputMsgTxAgg로 처리해야 한다
+  bool inputTxAggCbor(std::string_view txagg_cbor) {
+    enum : uint32_t {
+      TXID = 1 << 0,
+      TIME = 1 << 1,
+      CID = 1 << 2,
+      RECEIVER = 1 << 3,
+      FEE = 1 << 4,
+      INPUT = 1 << 5,
+      USER_ID = 1 << 6,
+      USER_PK = 1 << 7,
+      USER_A = 1 << 8,
+      USER_Z = 1 << 9,
+      ENDORSER = 1 << 10,
+      BODY_FIELDS = CID | RECEIVER | FEE | INPUT,
+      USER_FIELDS = USER_ID | USER_PK | USER_A | USER_Z,
+      ALL_FIELDS = TXID | TIME | BODY_FIELDS | USER_FIELDS | ENDORSER
+    };
+
+    try {
+      CborReader reader(txagg_cbor);
+      uint32_t found = 0;
+      std::string_view time, fee;
+      const uint8_t *input_begin = nullptr;
+      const uint8_t *input_end = nullptr;
+
+      // 같은 key가 여러 번 나오면 DOM처럼 마지막 값만 남긴다
+      auto read_text_field = [&](uint32_t field, std::string_view &value) {
+        if (!reader.readText(value))
+          return false;
+        found |= field;
+        return true;
+      };
+
+      size_t top_size;
+      if (!reader.readMapSize(top_size))
+        return false;
+
+      for (size_t i = 0; i < top_size; ++i) {
+        std::string_view key, value;
+        if (!reader.readText(key))
+          return false;
+
+        if (key == "txid") {
+          if (!read_text_field(TXID, value))
+            return false;
+          m_txid = value;
+        } else if (key == "time") {
+          if (!read_text_field(TIME, time))
+            return false;
+        } else if (key == "body") {
+          size_t body_size;
+          if (!reader.readMapSize(body_size))
+            return false;
+          found &= ~BODY_FIELDS;
+
+          for (size_t j = 0; j < body_size; ++j) {
+            if (!reader.readText(key))
+              return false;
+
+            bool canonical = true;
+            if (key == "cid") {
+              if (!read_text_field(CID, value))
+                return false;
+              m_contract_id = value;
+            } else if (key == "receiver") {
+              if (!read_text_field(RECEIVER, value))
+                return false;
+              m_receiver_id = value;
+            } else if (key == "fee") {
+              if (!read_text_field(FEE, fee))
+                return false;
+            } else if (key == "input") {
+              // to_cbor로 다시 만든 것과 같은 형태라면 원래 byte를 그대로 쓴다
+              input_begin = reader.position();
+              if (!reader.skip(canonical) || !canonical)
+                return false;
+              input_end = reader.position();
+              found |= INPUT;
+            } else if (!reader.skip(canonical) || !canonical) {
+              return false;
+            }
+          }
+        } else if (key == "user") {
+          size_t user_size;
+          if (!reader.readMapSize(user_size))
+            return false;
+          found &= ~USER_FIELDS;
+
+          for (size_t j = 0; j < user_size; ++j) {
+            if (!reader.readText(key))
+              return false;
+
+            bool canonical = true;
+            if (key == "id") {
+              if (!read_text_field(USER_ID, value))
+                return false;
+              m_tx_user_id = value;
+            } else if (key == "pk") {
+              if (!read_text_field(USER_PK, value))
+                return false;
+              m_tx_user_pk = value;
+            } else if (key == "a") {
+              if (!read_text_field(USER_A, value))
+                return false;
+              m_tx_user_agga = value;
+            } else if (key == "z") {
+              if (!read_text_field(USER_Z, value))
+                return false;
+              m_tx_user_aggz = value;
+            } else if (!reader.skip(canonical) || !canonical) {
+              return false;
+            }
+          }
+        } else if (key == "endorser") {
+          if (!inputEndorsersCbor(reader))
+            return false;
+          found |= ENDORSER;
+        } else {
+          bool canonical = true;
+          if (!reader.skip(canonical) || !canonical)
+            return false;
+        }
+      }
+
+      if (!reader.atEnd() || found != ALL_FIELDS)
+        return false;
+
+      m_tx_time = static_cast<tethys::timestamp_t>(stoll(string(time)));
+      m_fee = stoi(string(fee));
+      m_tx_input_cbor.assign(input_begin, input_end);
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  bool inputEndorsersCbor(CborReader &reader) {
+    size_t endorser_num;
+    if (!reader.readArraySize(endorser_num))
+      return false;
+
+    m_tx_endorsers.clear();
+    m_tx_endorsers.reserve(endorser_num);
+    for (size_t i = 0; i < endorser_num; ++i) {
+      size_t field_num;
+      if (!reader.readMapSize(field_num))
+        return false;
+
+      std::string_view id, pk, sig, agga, aggz;
+      bool has_id = false, has_pk = false, has_sig = false, has_agga = false, has_aggz = false;
+      for (size_t j = 0; j < field_num; ++j) {
+        std::string_view key;
+        if (!reader.readText(key))
+          return false;
+
+        bool canonical = true;
+        if (key == "id") {
+          has_id = reader.readText(id);
+          if (!has_id)
+            return false;
+        } else if (key == "pk") {
+          has_pk = reader.readText(pk);
+          if (!has_pk)
+            return false;
+        } else if (key == "sig") {
+          has_sig = reader.readText(sig);
+          if (!has_sig)
+            return false;
+        } else if (key == "a") {
+          has_agga = reader.readText(agga);
+          if (!has_agga)
+            return false;
+        } else if (key == "z") {
+          has_aggz = reader.readText(aggz);
+          if (!has_aggz)
+            return false;
+        } else if (!reader.skip(canonical) || !canonical) {
+          return false;
+        }
+      }
+
+      if (!has_id || !has_pk)
+        return false;
+
+      if (has_sig)
+        m_tx_endorsers.emplace_back(string(id), string(pk), string(sig));
+      else if (has_agga && has_aggz)
+        m_tx_endorsers.emplace_back(string(id), string(pk), string(agga), string(aggz));
+      else
+        return false;
+    }
+    return true;
+  }
+
   void setTxInputCbor(const nlohmann::json &input_array) {
     m_tx_input_cbor = nlohmann::json::to_cbor(input_array);
   }
@@ -1,26 +1,133 @@
-#include "include/transacton_pool.hpp"
-
-namespace tethys {
-
-void TransactionPool::add(const Transaction &tx) {
-  {
-    unique_lock<shared_mutex> writerLock(pool_mutex);
-
-    tx_pool.try_emplace(tx.getTxId(), tx);
-  }
-}
-
-vector<Transaction> TransactionPool::fetchAll() {
-  {
-    shared_lock<shared_mutex> readerLock(pool_mutex);
-
-    vector<Transaction> v;
-    v.reserve(tx_pool.size());
-
-    std::transform(tx_pool.begin(), tx_pool.end(), std::back_inserter(v), [](auto &kv) { return kv.second; });
-
-    return v;
-  }
-}
-
-}
\ No newline at end of file
+#include "include/transacton_pool.hpp"
+
+namespace tethys {
+
+TransactionPool::TransactionPool(size_t max_size, std::chrono::seconds max_age, size_t shard_num)
+    : m_max_size(max_size), m_max_age(max_age) {
+  for (size_t i = 0; i < std::max<size_t>(1, shard_num); ++i) {
+    m_shards.emplace_back(std::make_unique<Shard>());
+  }
+}
+
+bool TransactionPool::add(const Transaction &tx) {
+  // 자리를 먼저 잡아 두어 동시에 add 하더라도 max_size를 넘지 않게 한다
+  if (m_size.fetch_add(1) >= m_max_size) {
+    --m_size;
+    return false;
+  }
+
+  base58_type tx_id = tx.getTxId();
+  Shard &shard = getShard(tx_id);
+  {
+    unique_lock<shared_mutex> writerLock(shard.mutex);
+
+    bool inserted = shard.txs.try_emplace(tx_id, PoolEntry{tx, std::chrono::steady_clock::now()}).second;
+    if (!inserted)
+      --m_size;
+
+    return inserted;
+  }
+}
+
+vector<Transaction> TransactionPool::fetchAll() {
+  vector<shared_lock<shared_mutex>> readerLocks;
+  readerLocks.reserve(m_shards.size());
+  for (auto &shard : m_shards) {
+    readerLocks.emplace_back(shard->mutex);
+  }
+
+  vector<Transaction> v;
+  v.reserve(m_size.load());
+
+  for (auto &shard : m_shards) {
+    std::transform(shard->txs.begin(), shard->txs.end(), std::back_inserter(v), [](auto &kv) { return kv.second.tx; });
+  }
+
+  return v;
+}
+
+vector<Transaction> TransactionPool::fetchTop(size_t n) {
+  n = std::min<size_t>(n, config::MAX_COLLECT_TRANSACTION_SIZE);
+
+  // add는 shard 하나의 lock만 잡으므로, 모든 shard를 같은 순서로 잡아도 교착되지 않는다
+  vector<shared_lock<shared_mutex>> readerLocks;
+  readerLocks.reserve(m_shards.size());
+  for (auto &shard : m_shards) {
+    readerLocks.emplace_back(shard->mutex);
+  }
+
+  // 정렬은 tx를 가리키는 포인터로만 하고, 뽑힌 n개만 복사한다
+  struct Candidate {
+    int fee;
+    timestamp_t tx_time;
+    const Transaction *tx;
+  };
+
+  auto now = std::chrono::steady_clock::now();
+  vector<Candidate> candidates;
+  candidates.reserve(m_size.load());
+  for (auto &shard : m_shards) {
+    for (auto &[tx_id, entry] : shard->txs) {
+      if (now - entry.arrival_time > m_max_age)
+        continue;
+      candidates.push_back({entry.tx.getFee(), entry.tx.getTxTime(), &entry.tx});
+    }
+  }
+
+  auto higher_priority = [](const Candidate &a, const Candidate &b) {
+    if (a.fee != b.fee)
+      return a.fee > b.fee;
+    return a.tx_time < b.tx_time;
+  };
+
+  if (candidates.size() > n) {
+    std::nth_element(candidates.begin(), candidates.begin() + n, candidates.end(), higher_priority);
+    candidates.resize(n);
+  }
+  std::sort(candidates.begin(), candidates.end(), higher_priority);
+
+  vector<Transaction> top_txs;
+  top_txs.reserve(candidates.size());
+  for (auto &each_candidate : candidates) {
+    top_txs.push_back(*each_candidate.tx);
+  }
+
+  return top_txs;
+}
+
+void TransactionPool::remove(const vector<Transaction> &txs) {
+  for (auto &each_tx : txs) {
+    base58_type tx_id = each_tx.getTxId();
+    Shard &shard = getShard(tx_id);
+
+    unique_lock<shared_mutex> writerLock(shard.mutex);
+    m_size -= shard.txs.erase(tx_id);
+  }
+}
+
+size_t TransactionPool::removeExpired() {
+  auto now = std::chrono::steady_clock::now();
+  size_t removed_num = 0;
+
+  for (auto &shard : m_shards) {
+    unique_lock<shared_mutex> writerLock(shard->mutex);
+
+    for (auto it = shard->txs.begin(); it != shard->txs.end();) {
+      if (now - it->second.arrival_time > m_max_age) {
+        it = shard->txs.erase(it);
+        ++removed_num;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  m_size -= removed_num;
+  return removed_num;
+}
+
+size_t TransactionPool::size() const {
+  return m_size.load();
+}
+
+}
@@ -1,7 +1,70 @@
 #include "include/unresolved_block_pool.hpp"
+#include "include/binary_codec.hpp"
 
 namespace tethys {
 
+namespace {
+
+constexpr int BACKUP_FORMAT_VERSION = 1;
+
+// 목록의 key는 보통 항목 자신의 pid / uid / sn / cid와 같다
+const string &getNaturalKey(const user_ledger_type &ledger) {
+  return ledger.pid;
+}
+
+const string &getNaturalKey(const contract_ledger_type &ledger) {
+  return ledger.pid;
+}
+
+const string &getNaturalKey(const user_attribute_type &user_attribute) {
+  return user_attribute.uid;
+}
+
+const string &getNaturalKey(const user_cert_type &user_cert) {
+  return user_cert.sn;
+}
+
+const string &getNaturalKey(const contract_type &contract) {
+  return contract.cid;
+}
+
+// map의 key와 값을 key 순서대로 기록한다. key가 항목의 natural key와 같으면 key는 생략하고 표시만 남긴다
+template <typename T>
+void appendLedgerMap(string &out, const std::map<string, T> &ledger_map) {
+  appendUint(out, ledger_map.size(), 4);
+  for (auto &[key, value] : ledger_map) {
+    bool is_natural_key = (key == getNaturalKey(value));
+    appendUint(out, is_natural_key ? 0 : 1, 1);
+    if (!is_natural_key)
+      appendString(out, key);
+    appendLedger(out, value);
+  }
+}
+
+// key 순서대로 기록되어 있으므로 항상 map의 끝에 붙이면 된다
+template <typename T>
+bool readLedgerMap(BinaryReader &reader, std::map<string, T> &ledger_map) {
+  uint64_t item_num;
+  if (!reader.readUint(item_num, 4))
+    return false;
+
+  ledger_map.clear();
+  for (uint64_t i = 0; i < item_num; ++i) {
+    uint64_t has_key;
+    string key;
+    T value;
+    if (!reader.readUint(has_key, 1) || (has_key != 0 && !reader.readString(key)) || !readLedger(reader, value))
+      return false;
+
+    if (has_key == 0)
+      key = getNaturalKey(value);
+    ledger_map.emplace_hint(ledger_map.end(), std::move(key), std::move(value));
+  }
+  return true;
+}
+
+} // namespace
+
 UnresolvedBlockPool::UnresolvedBlockPool() {
   logger::INFO("Unresolved block pool is created");
   m_block_pool.clear();
@@ -26,6 +89,11 @@ inline bool UnresolvedBlockPool::empty() {
 
 inline void UnresolvedBlockPool::clear() {
   m_block_pool.clear();
+  m_block_index.clear();
+  m_orphan_blocks.clear();
+  m_orphan_children.clear();
+  m_orphan_arrival_order.clear();
+  m_orphan_tx_num = 0;
 }
 
 base58_type UnresolvedBlockPool::getLatestConfirmedId() {
@@ -51,11 +119,7 @@ base58_type UnresolvedBlockPool::getLatestConfiremdPrevId() {
 // 블록이 push될 때마다 실행되는 함수. pool이 되는 deque를 resize 하는 등의 컨트롤을 한다.
 bool UnresolvedBlockPool::prepareDeque(block_height_type t_height) {
   std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
-  if (m_latest_confirmed_height >= t_height) {
-    return false;
-  }
-
-  if ((TimeUtil::nowBigInt() - m_latest_confirmed_time) < (t_height - m_latest_confirmed_height - 1) * config::BP_INTERVAL) {
+  if (!isPushableHeight(t_height)) {
     return false;
   }
 
@@ -67,6 +131,19 @@ bool UnresolvedBlockPool::prepareDeque(block_height_type t_height) {
   return true;
 }
 
+// 이미 확정된 height이거나, 지금까지 흐른 시간으로는 만들어질 수 없는 height의 블록은 받지 않는다
+bool UnresolvedBlockPool::isPushableHeight(block_height_type t_height) {
+  if (m_latest_confirmed_height >= t_height) {
+    return false;
+  }
+
+  if ((TimeUtil::nowBigInt() - m_latest_confirmed_time) < (t_height - m_latest_confirmed_height - 1) * config::BP_INTERVAL) {
+    return false;
+  }
+
+  return true;
+}
+
 block_push_result_type UnresolvedBlockPool::pushBlock(Block &new_block) {
   logger::INFO("Unresolved block pool: pushBlock called");
   block_push_result_type ret_val;
@@ -79,28 +156,30 @@ block_push_result_type UnresolvedBlockPool::pushBlock(Block &new_block) {
   block_height_type block_height = new_block.getHeight();
 
   int deq_idx = static_cast<int>(block_height - m_latest_confirmed_height) - 1; // e.g., 0 = 2 - 1 - 1
-  if (!prepareDeque(block_height))
+  if (!isPushableHeight(block_height))
     return ret_val;
 
-  for (auto &each_block : m_block_pool[deq_idx]) {
-    if (each_block.block == new_block) {
-      ret_val.block_height = block_height;
-      ret_val.duplicated = true;
-      return ret_val;
-    }
+  int found_deq_idx, found_vec_idx;
+  if (findBlockIdx(new_block.getBlockId(), block_height, found_deq_idx, found_vec_idx) ||
+      m_orphan_blocks.count(new_block.getBlockId()) > 0) {
+    ret_val.block_height = block_height;
+    ret_val.duplicated = true;
+    return ret_val;
   }
 
   int prev_vec_idx = -1; // no previous
 
   if (deq_idx > 0) { // if there is previous bin
-    int idx = 0;
-    for (auto &each_block : m_block_pool[deq_idx - 1]) {
-      if (each_block.block.getBlockId() == new_block.getPrevBlockId()) {
-        prev_vec_idx = static_cast<int>(idx);
-        break;
-      }
-      ++idx;
+    if (!findBlockIdx(new_block.getPrevBlockId(), block_height - 1, found_deq_idx, found_vec_idx)) {
+      // 부모가 들어오면 함께 연결되도록 orphan pool에서 기다린다
+      addOrphan(new_block, ret_val.evicted_orphan_ids);
+      ret_val.block_id = new_block.getBlockId();
+      ret_val.block_height = block_height;
+      ret_val.deq_idx = -1;
+      ret_val.vec_idx = -1;
+      return ret_val;
     }
+    prev_vec_idx = found_vec_idx;
   } else { // no previous
     if (new_block.getPrevBlockId() == m_latest_confirmed_id) {
       prev_vec_idx = 0;
@@ -110,37 +189,157 @@ block_push_result_type UnresolvedBlockPool::pushBlock(Block &new_block) {
     }
   }
 
+  block_pool_info_type placed_info;
+  placeBlock(new_block, prev_vec_idx, placed_info);
+  ret_val.block_id = placed_info.block_id;
+  ret_val.block_height = placed_info.block_height;
+  ret_val.deq_idx = placed_info.deq_idx;
+  ret_val.vec_idx = placed_info.vec_idx;
+  ret_val.linked = true;
+
+  linkOrphans(ret_val.block_id, ret_val.linked_orphans);
+
+  return ret_val;
+}
+
+void UnresolvedBlockPool::placeBlock(Block &new_block, int prev_vec_idx, block_pool_info_type &placed_info) {
+  block_height_type block_height = new_block.getHeight();
+  int deq_idx = static_cast<int>(block_height - m_latest_confirmed_height) - 1;
+  if (m_block_pool.size() < deq_idx + 1) {
+    m_block_pool.resize(deq_idx + 1);
+  }
+
   int vec_idx = m_block_pool[deq_idx].size();
 
   m_block_pool[deq_idx].emplace_back(new_block, vec_idx, prev_vec_idx); // pool에 블록 추가
-  ret_val.block_id = new_block.getBlockId();
-  ret_val.block_height = block_height;
-  ret_val.deq_idx = deq_idx;
-  ret_val.vec_idx = vec_idx;
-
-  if (deq_idx + 1 < m_block_pool.size()) { // if there is next bin
-    for (auto &each_block : m_block_pool[deq_idx + 1]) {
-      if (each_block.block.getPrevBlockId() == new_block.getBlockId()) {
-        if (each_block.prev_vec_idx < 0) {
-          each_block.prev_vec_idx = vec_idx;
-        }
+  m_block_index[new_block.getBlockId()] = {block_height, vec_idx};
+  buildLedgerIndex(deq_idx, vec_idx);
+  addSSigToAncestors(deq_idx, vec_idx);
+
+  placed_info.block_id = new_block.getBlockId();
+  placed_info.block_height = block_height;
+  placed_info.deq_idx = deq_idx;
+  placed_info.vec_idx = vec_idx;
+}
+
+void UnresolvedBlockPool::addOrphan(Block &new_block, vector<base58_type> &evicted_ids) {
+  base58_type block_id = new_block.getBlockId();
+
+  m_orphan_tx_num += new_block.getNumTransaction();
+  m_orphan_children[new_block.getPrevBlockId()].push_back(block_id);
+  m_orphan_arrival_order.emplace_back(m_orphan_seq, block_id);
+  m_orphan_blocks.emplace(block_id, OrphanBlock{new_block, m_orphan_seq++, std::chrono::steady_clock::now()});
+
+  // 상한을 넘으면 가장 오래 기다린 블록부터 버린다. 방금 들어온 블록은 남긴다
+  while ((m_orphan_blocks.size() > config::ORPHAN_POOL_MAX_SIZE || m_orphan_tx_num > config::ORPHAN_POOL_MAX_TX_NUM) &&
+         m_orphan_blocks.size() > 1) {
+    auto [arrival_seq, oldest_id] = m_orphan_arrival_order.front();
+    m_orphan_arrival_order.pop_front();
+
+    auto orphan_it = m_orphan_blocks.find(oldest_id);
+    if (orphan_it == m_orphan_blocks.end() || orphan_it->second.arrival_seq != arrival_seq)
+      continue; // 이미 연결되었거나 버려진 블록
+
+    logger::ERROR("drop orphan block -- orphan pool is full " + oldest_id);
+    evicted_ids.push_back(oldest_id);
+    takeOrphan(orphan_it);
+    ++m_orphan_evicted_num;
+  }
+}
+
+// parent_id 블록을 기다리던 orphan들을 pool에 넣고, 그 orphan을 기다리던 블록들도 이어서 넣는다
+void UnresolvedBlockPool::linkOrphans(const base58_type &parent_id, vector<block_pool_info_type> &linked_infos) {
+  vector<base58_type> parent_ids = {parent_id};
+
+  while (!parent_ids.empty()) {
+    base58_type each_parent_id = std::move(parent_ids.back());
+    parent_ids.pop_back();
+
+    auto children_it = m_orphan_children.find(each_parent_id);
+    if (children_it == m_orphan_children.end())
+      continue;
+
+    vector<base58_type> child_ids = std::move(children_it->second);
+    m_orphan_children.erase(children_it);
+
+    for (auto &each_child_id : child_ids) {
+      auto orphan_it = m_orphan_blocks.find(each_child_id);
+      if (orphan_it == m_orphan_blocks.end())
+        continue;
+
+      OrphanBlock orphan = takeOrphan(orphan_it);
+
+      int parent_deq_idx, parent_vec_idx;
+      if (!findBlockIdx(each_parent_id, orphan.block.getHeight() - 1, parent_deq_idx, parent_vec_idx)) {
+        // 부모의 다음 height가 아닌 블록
+        logger::ERROR("drop orphan block -- this is not linkable block! " + each_child_id);
+        ++m_orphan_expired_num;
+        continue;
       }
+
+      block_pool_info_type placed_info;
+      placeBlock(orphan.block, parent_vec_idx, placed_info);
+      linked_infos.push_back(placed_info);
+      parent_ids.push_back(each_child_id);
+
+      double link_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - orphan.arrival_time).count();
+      ++m_orphan_linked_num;
+      m_orphan_link_ms_sum += link_ms;
+      m_orphan_link_ms_max = std::max(m_orphan_link_ms_max, link_ms);
     }
   }
 
-  return ret_val;
+  trimOrphanArrivalOrder();
+}
+
+// orphan pool에서 꺼내며 기다리던 부모의 목록에서도 지운다
+OrphanBlock UnresolvedBlockPool::takeOrphan(std::unordered_map<base58_type, OrphanBlock>::iterator orphan_it) {
+  m_orphan_tx_num -= orphan_it->second.block.getNumTransaction();
+
+  auto children_it = m_orphan_children.find(orphan_it->second.block.getPrevBlockId());
+  if (children_it != m_orphan_children.end()) {
+    auto &child_ids = children_it->second;
+    child_ids.erase(std::remove(child_ids.begin(), child_ids.end(), orphan_it->first), child_ids.end());
+    if (child_ids.empty())
+      m_orphan_children.erase(children_it);
+  }
+
+  OrphanBlock orphan = std::move(orphan_it->second);
+  m_orphan_blocks.erase(orphan_it);
+  return orphan;
+}
+
+// 확정된 height 바로 위까지의 orphan은 부모가 더 이상 들어올 수 없으므로 버린다
+void UnresolvedBlockPool::dropDeadOrphans(vector<base58_type> &dropped_block_id) {
+  for (auto orphan_it = m_orphan_blocks.begin(); orphan_it != m_orphan_blocks.end();) {
+    auto next_it = std::next(orphan_it);
+    if (orphan_it->second.block.getHeight() <= m_latest_confirmed_height + 1) {
+      dropped_block_id.push_back(orphan_it->first);
+      takeOrphan(orphan_it);
+      ++m_orphan_expired_num;
+    }
+    orphan_it = next_it;
+  }
+
+  trimOrphanArrivalOrder();
+}
+
+// 연결되거나 버려진 블록이 앞에 쌓이지 않도록 정리한다
+void UnresolvedBlockPool::trimOrphanArrivalOrder() {
+  while (!m_orphan_arrival_order.empty()) {
+    auto &[arrival_seq, block_id] = m_orphan_arrival_order.front();
+    auto orphan_it = m_orphan_blocks.find(block_id);
+    if (orphan_it != m_orphan_blocks.end() && orphan_it->second.arrival_seq == arrival_seq)
+      break;
+    m_orphan_arrival_order.pop_front();
+  }
 }
 
 bool UnresolvedBlockPool::resolveBlock(Block &new_block, UnresolvedBlock &resolved_result, vector<base58_type> &dropped_block_id) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
   dropped_block_id.clear();
 
-  //  if (!lateStage(new_block)) {
-  //    return false;
-  //  }
-
   if (new_block.getHeight() - m_latest_confirmed_height > config::BLOCK_CONFIRM_LEVEL) {
-    updateTotalNumSSig();
-
     if (m_block_pool.size() < 2 || m_block_pool[0].empty() || m_block_pool[1].empty()) {
       return false;
     }
@@ -177,63 +376,98 @@ bool UnresolvedBlockPool::resolveBlock(Block &new_block, UnresolvedBlock &resolv
     m_latest_confirmed_hash = m_block_pool[0][resolved_block_idx].block.getBlockHash();
     m_latest_confirmed_height = m_block_pool[0][resolved_block_idx].block.getHeight();
 
-    UnresolvedBlock resolved_block = m_block_pool[0][resolved_block_idx];
     for (auto &each_block : m_block_pool[0]) {
       dropped_block_id.push_back(each_block.block.getBlockId());
+      m_block_index.erase(each_block.block.getBlockId());
     }
 
-    // TODO: pop되기 전에 반복문을 사용하면 선택받지 못한 block branch를 전부 지울 수 있을 것이나,
-    //  그 후에 만약 해당 블록에 연결된 블록이 들어와서 지웠던 블록을 다시 요청하는 경우가 생길 수 있는것은 아닐지 고려.
-
+    // 확정된 블록은 복사하지 않고 꺼낸다. 같은 height의 나머지 블록은 level과 함께 지워진다
+    resolved_result = std::move(m_block_pool[0][resolved_block_idx]);
     m_block_pool.pop_front();
+    dropDeadOrphans(dropped_block_id);
 
-    if (m_block_pool.empty()) {
-      resolved_result = resolved_block;
-      return true;
-    }
+    // 선택받지 못한 블록의 후손은 더 이상 확정될 수 없으므로 지운다.
+    // 지운 블록에 연결되는 블록이 나중에 들어오면 orphan으로 기다리다가 그 height가 확정될 때 버려진다
+    pruneUnlinkedBlocks(dropped_block_id);
 
-    for (auto &each_block : m_block_pool[0]) {
-      if (each_block.block.getPrevBlockId() == m_latest_confirmed_id) {
-        each_block.prev_vec_idx = 0;
-      } else {
-        // this block is unlinkable => to be deleted
-        each_block.prev_vec_idx = -1;
-      }
+    // 남은 블록들의 index에 들어 있는 확정된 조상의 ledger는 persistence stage나 rdb에서 찾은 값과 같으므로 그대로 둔다.
+    // 확정된 ledger가 계속 쌓이지 않도록 LEDGER_INDEX_COMPACT_INTERVAL번 확정할 때마다 빈 base에서 다시 만든다
+    if (++m_resolved_num_since_compaction >= config::LEDGER_INDEX_COMPACT_INTERVAL) {
+      m_resolved_num_since_compaction = 0;
+      rebuildAllLedgerIndex();
     }
-    resolved_result = resolved_block;
+
     return true;
   } else {
     return false;
   }
 }
 
-void UnresolvedBlockPool::updateTotalNumSSig() {
-  if (m_block_pool.empty())
-    return;
+// latest confirmed block에 연결되지 않은 블록과 그 후손을 모두 지운다. 남은 블록의 vec_idx는 level마다 앞에서부터 다시 매긴다
+void UnresolvedBlockPool::pruneUnlinkedBlocks(vector<base58_type> &dropped_block_id) {
+  vector<int> prev_level_new_idx; // 이전 level의 vec_idx -> 새 vec_idx. 지워진 블록은 -1
+
+  for (int deq_idx = 0; deq_idx < static_cast<int>(m_block_pool.size()); ++deq_idx) {
+    auto &each_level = m_block_pool[deq_idx];
+    vector<int> new_idx(each_level.size(), -1);
+    int kept_num = 0;
+
+    for (int vec_idx = 0; vec_idx < static_cast<int>(each_level.size()); ++vec_idx) {
+      UnresolvedBlock &each_block = each_level[vec_idx];
+      base58_type block_id = each_block.block.getBlockId();
+
+      int prev_vec_idx = -1;
+      if (deq_idx == 0) {
+        if (each_block.block.getPrevBlockId() == m_latest_confirmed_id)
+          prev_vec_idx = 0;
+      } else if (each_block.prev_vec_idx >= 0 && each_block.prev_vec_idx < static_cast<int>(prev_level_new_idx.size())) {
+        prev_vec_idx = prev_level_new_idx[each_block.prev_vec_idx];
+      }
 
-  for (auto &each_level : m_block_pool) {
-    for (auto &each_block : each_level) {
-      each_block.ssig_sum = each_block.block.getNumSigners();
+      if (prev_vec_idx < 0) {
+        dropped_block_id.push_back(block_id);
+        m_block_index.erase(block_id);
+        continue;
+      }
+
+      each_block.prev_vec_idx = prev_vec_idx;
+      each_block.cur_vec_idx = kept_num;
+      m_block_index[block_id].vec_idx = kept_num;
+      new_idx[vec_idx] = kept_num;
+
+      if (kept_num != vec_idx)
+        each_level[kept_num] = std::move(each_block);
+      ++kept_num;
     }
+
+    each_level.erase(each_level.begin() + kept_num, each_level.end());
+    prev_level_new_idx = std::move(new_idx);
   }
 
-  for (int i = (int)m_block_pool.size() - 1; i > 0; --i) {
-    for (auto &each_block : m_block_pool[i]) { // for vector
-      if (each_block.prev_vec_idx >= 0 && m_block_pool[i - 1].size() > each_block.prev_vec_idx) {
-        m_block_pool[i - 1][each_block.prev_vec_idx].ssig_sum += each_block.ssig_sum;
-      }
-    }
+  // 부모가 모두 지워진 level부터는 비어 있다
+  while (!m_block_pool.empty() && m_block_pool.back().empty()) {
+    m_block_pool.pop_back();
   }
 }
 
-UnresolvedBlock UnresolvedBlockPool::getUnresolvedBlock(const base58_type &block_id, const block_height_type block_height) {
-  // TODO: Refactoring. height와 cur_vec_idx를 이용하면 순회 안 하고도 찾을 수 있음
-  for (auto &each_level : m_block_pool) {
-    for (auto &each_block : each_level) {
-      if ((each_block.block.getBlockId() == block_id) && (each_block.block.getHeight() == block_height))
-        return each_block;
-    }
+// 새 블록의 SSig 수를 자신과 조상 블록들의 ssig_sum에 더한다. pool 전체가 아니라 depth만큼만 거슬러 올라간다
+void UnresolvedBlockPool::addSSigToAncestors(int pool_deq_idx, int pool_vec_idx) {
+  int32_t num_signers = m_block_pool[pool_deq_idx][pool_vec_idx].block.getNumSigners();
+
+  while (isValidIdx(pool_deq_idx, pool_vec_idx)) {
+    UnresolvedBlock &each_block = m_block_pool[pool_deq_idx][pool_vec_idx];
+    each_block.ssig_sum += num_signers;
+
+    pool_vec_idx = each_block.prev_vec_idx;
+    --pool_deq_idx;
   }
+}
+
+UnresolvedBlock UnresolvedBlockPool::getUnresolvedBlock(const base58_type &block_id, const block_height_type block_height) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  int pool_deq_idx, pool_vec_idx;
+  if (findBlockIdx(block_id, block_height, pool_deq_idx, pool_vec_idx))
+    return m_block_pool[pool_deq_idx][pool_vec_idx];
 
   logger::ERROR("Cannot found block in pool " + block_id + " " + to_string(block_height));
   return UnresolvedBlock{};
@@ -243,15 +477,148 @@ UnresolvedBlock UnresolvedBlockPool::getUnresolvedBlock(int pool_deq_idx, int po
   return m_block_pool[pool_deq_idx][pool_vec_idx];
 }
 
-void UnresolvedBlockPool::setUnresolvedBlock(const UnresolvedBlock &unresolved_block) {
-  int pool_deq_idx = static_cast<int>(unresolved_block.block.getHeight() - m_latest_confirmed_height) - 1;
-  int pool_vec_idx = unresolved_block.cur_vec_idx;
+int UnresolvedBlockPool::getPrevVecIdx(int pool_deq_idx, int pool_vec_idx) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  return m_block_pool[pool_deq_idx][pool_vec_idx].prev_vec_idx;
+}
+
+bool UnresolvedBlockPool::findUserLedger(int pool_deq_idx, int pool_vec_idx, const string &pid, user_ledger_type &found_ledger) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  if (!isValidIdx(pool_deq_idx, pool_vec_idx))
+    return false;
 
-  m_block_pool[pool_deq_idx][pool_vec_idx] = unresolved_block;
-  m_block_pool[pool_deq_idx][pool_vec_idx].is_processed = true;
+  const user_ledger_type *ledger = m_block_pool[pool_deq_idx][pool_vec_idx].user_ledger_index.find(pid);
+  if (ledger == nullptr)
+    return false;
+
+  found_ledger = *ledger;
+  return true;
+}
+
+bool UnresolvedBlockPool::findContractLedger(int pool_deq_idx, int pool_vec_idx, const string &pid, contract_ledger_type &found_ledger) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  if (!isValidIdx(pool_deq_idx, pool_vec_idx))
+    return false;
+
+  const contract_ledger_type *ledger = m_block_pool[pool_deq_idx][pool_vec_idx].contract_ledger_index.find(pid);
+  if (ledger == nullptr)
+    return false;
+
+  found_ledger = *ledger;
+  return true;
+}
+
+bool UnresolvedBlockPool::getBlockPoolInfo(const base58_type &block_id, block_height_type block_height, block_pool_info_type &pool_info) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  int pool_deq_idx, pool_vec_idx;
+  if (!findBlockIdx(block_id, block_height, pool_deq_idx, pool_vec_idx))
+    return false;
+
+  pool_info.block_id = block_id;
+  pool_info.block_height = block_height;
+  pool_info.deq_idx = pool_deq_idx;
+  pool_info.vec_idx = pool_vec_idx;
+  return true;
+}
+
+block_pool_info_type UnresolvedBlockPool::getDeepestBlockInfo() {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  block_pool_info_type pool_info;
+  if (m_block_pool.empty() || m_block_pool.back().empty())
+    return pool_info;
+
+  pool_info.deq_idx = static_cast<int>(m_block_pool.size()) - 1;
+  pool_info.vec_idx = 0;
+  pool_info.block_id = m_block_pool.back().front().block.getBlockId();
+  pool_info.block_height = m_block_pool.back().front().block.getHeight();
+  return pool_info;
+}
+
+bool UnresolvedBlockPool::findBlockIdx(const base58_type &block_id, block_height_type block_height, int &pool_deq_idx,
+                                       int &pool_vec_idx) {
+  auto it = m_block_index.find(block_id);
+  if (it == m_block_index.end() || it->second.block_height != block_height)
+    return false;
+
+  int deq_idx = static_cast<int>(block_height - m_latest_confirmed_height) - 1;
+  if (!isValidIdx(deq_idx, it->second.vec_idx))
+    return false;
+
+  pool_deq_idx = deq_idx;
+  pool_vec_idx = it->second.vec_idx;
+  return true;
+}
+
+bool UnresolvedBlockPool::isValidIdx(int pool_deq_idx, int pool_vec_idx) {
+  return (pool_deq_idx >= 0 && pool_deq_idx < static_cast<int>(m_block_pool.size()) && pool_vec_idx >= 0 &&
+          pool_vec_idx < static_cast<int>(m_block_pool[pool_deq_idx].size()));
+}
+
+// 부모 블록의 index 위에 이 블록의 ledger만 얹는다. 부모가 latest confirmed block이거나 연결되지 않았으면 빈 index에서 시작
+void UnresolvedBlockPool::buildLedgerIndex(int pool_deq_idx, int pool_vec_idx) {
+  UnresolvedBlock &current_block = m_block_pool[pool_deq_idx][pool_vec_idx];
+
+  PersistentLedgerIndex<user_ledger_type> user_base;
+  PersistentLedgerIndex<contract_ledger_type> contract_base;
+  if (pool_deq_idx > 0 && isValidIdx(pool_deq_idx - 1, current_block.prev_vec_idx)) {
+    const UnresolvedBlock &prev_block = m_block_pool[pool_deq_idx - 1][current_block.prev_vec_idx];
+    user_base = prev_block.user_ledger_index;
+    contract_base = prev_block.contract_ledger_index;
+  }
+
+  current_block.user_ledger_index = user_base.insert(current_block.user_ledger_list);
+  current_block.contract_ledger_index = contract_base.insert(current_block.contract_ledger_list);
+}
+
+// 해당 블록과 그 블록에 연결된 후손 블록들의 index만 다시 만든다
+void UnresolvedBlockPool::rebuildLedgerIndexFrom(int pool_deq_idx, int pool_vec_idx) {
+  buildLedgerIndex(pool_deq_idx, pool_vec_idx);
+
+  vector<int> changed_vec_idx = {pool_vec_idx};
+  for (int deq_idx = pool_deq_idx + 1; deq_idx < static_cast<int>(m_block_pool.size()) && !changed_vec_idx.empty(); ++deq_idx) {
+    vector<int> next_changed_vec_idx;
+    for (auto &each_block : m_block_pool[deq_idx]) {
+      if (std::find(changed_vec_idx.begin(), changed_vec_idx.end(), each_block.prev_vec_idx) != changed_vec_idx.end()) {
+        buildLedgerIndex(deq_idx, each_block.cur_vec_idx);
+        next_changed_vec_idx.push_back(each_block.cur_vec_idx);
+      }
+    }
+    changed_vec_idx = std::move(next_changed_vec_idx);
+  }
+}
+
+void UnresolvedBlockPool::rebuildAllLedgerIndex() {
+  for (int deq_idx = 0; deq_idx < static_cast<int>(m_block_pool.size()); ++deq_idx) {
+    for (int vec_idx = 0; vec_idx < static_cast<int>(m_block_pool[deq_idx].size()); ++vec_idx) {
+      buildLedgerIndex(deq_idx, vec_idx);
+    }
+  }
+}
+
+bool UnresolvedBlockPool::setUnresolvedBlock(const UnresolvedBlock &unresolved_block) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
+  // 복사해 간 뒤에 resolve로 pool이 정리되면 caller가 가진 vec_idx는 다른 블록을 가리킬 수 있으므로 block id로 찾는다
+  int pool_deq_idx, pool_vec_idx;
+  if (!findBlockIdx(unresolved_block.block.getBlockId(), unresolved_block.block.getHeight(), pool_deq_idx, pool_vec_idx)) {
+    logger::ERROR("Cannot set block which is not in pool (resolved or pruned) " + unresolved_block.block.getBlockId());
+    return false;
+  }
+
+  // pool에서 관리하는 위치와, 복사해 간 뒤에 연결된 후손 블록의 SSig가 빠지지 않도록 ssig_sum은 pool에 있던 값을 유지한다
+  UnresolvedBlock &pool_block = m_block_pool[pool_deq_idx][pool_vec_idx];
+  int32_t prev_vec_idx = pool_block.prev_vec_idx;
+  int32_t ssig_sum = pool_block.ssig_sum;
+  pool_block = unresolved_block;
+  pool_block.cur_vec_idx = pool_vec_idx;
+  pool_block.prev_vec_idx = prev_vec_idx;
+  pool_block.ssig_sum = ssig_sum;
+  pool_block.is_processed = true;
+  rebuildLedgerIndexFrom(pool_deq_idx, pool_vec_idx);
+  return true;
 }
 
 vector<int> UnresolvedBlockPool::getPath(const base58_type &block_id, const block_height_type block_height) {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
   vector<int> path;
   if (!block_id.empty()) {
     // latest_confirmed의 height가 10이었고, 현재 line을 구하려는 블록의 height가 12라면 vector size는 2이다
@@ -265,11 +632,9 @@ vector<int> UnresolvedBlockPool::getPath(const base58_type &block_id, const bloc
         return path;
     }
 
-    for (int i = 0; i < m_block_pool[current_deq_idx].size(); ++i) {
-      if (block_id == m_block_pool[current_deq_idx][i].block.getBlockId()) {
-        current_vec_idx = static_cast<int>(i);
-        break;
-      }
+    if (!findBlockIdx(block_id, block_height, current_deq_idx, current_vec_idx)) {
+      logger::ERROR("Cannot found block in pool " + block_id + " " + to_string(block_height));
+      return vector<int>();
     }
 
     path[current_deq_idx] = current_vec_idx;
@@ -315,6 +680,7 @@ Block &UnresolvedBlockPool::getLowestUnprocessedBlock(const block_pool_info_type
 }
 
 nlohmann::json UnresolvedBlockPool::getPoolBlockIds() {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
   nlohmann::json id_array = nlohmann::json::array();
 
   for (auto &each_level : m_block_pool) {
@@ -323,119 +689,59 @@ nlohmann::json UnresolvedBlockPool::getPoolBlockIds() {
       id_array.push_back(block_id);
     }
   }
-  return id_array;
-}
-
-string UnresolvedBlockPool::serializeUserLedgerList(const UnresolvedBlock &unresolved_block) {
-  nlohmann::json ledger_list_json = nlohmann::json::array();
-  string serialized_list;
-
-  for (auto &each_ledger : unresolved_block.user_ledger_list) {
-    nlohmann::json json;
-    json["var_name"] = each_ledger.second.var_name;
-    json["var_value"] = each_ledger.second.var_value;
-    json["var_type"] = to_string(each_ledger.second.var_type);
-    json["uid"] = each_ledger.second.uid;
-    json["up_time"] = to_string(each_ledger.second.up_time);
-    json["up_block"] = to_string(each_ledger.second.up_block);
-    json["tag"] = each_ledger.second.tag;
-    json["pid"] = each_ledger.second.pid;
-    json["query_type"] = each_ledger.second.query_type;
-    json["is_empty"] = each_ledger.second.is_empty;
-
-    ledger_list_json.push_back(json);
-  }
-
-  serialized_list = TypeConverter::bytesToString(nlohmann::json::to_cbor(ledger_list_json));
-  return serialized_list;
-}
-
-string UnresolvedBlockPool::serializeContractLedgerList(const UnresolvedBlock &unresolved_block) {
-  nlohmann::json ledger_list_json = nlohmann::json::array();
-  string serialized_list;
 
-  for (auto &each_ledger : unresolved_block.contract_ledger_list) {
-    nlohmann::json json;
-    json["var_name"] = each_ledger.second.var_name;
-    json["var_value"] = each_ledger.second.var_value;
-    json["var_type"] = to_string(each_ledger.second.var_type);
-    json["cid"] = each_ledger.second.cid;
-    json["up_time"] = to_string(each_ledger.second.up_time);
-    json["up_block"] = to_string(each_ledger.second.up_block);
-    json["var_info"] = each_ledger.second.var_info;
-    json["pid"] = each_ledger.second.pid;
-    json["query_type"] = each_ledger.second.query_type;
-    json["is_empty"] = each_ledger.second.is_empty;
-
-    ledger_list_json.push_back(json);
+  // 재시작 후에도 부모를 기다릴 수 있도록 orphan 블록은 pool의 블록 뒤에 붙인다
+  for (auto &[block_id, orphan] : m_orphan_blocks) {
+    id_array.push_back(block_id);
   }
-
-  serialized_list = TypeConverter::bytesToString(nlohmann::json::to_cbor(ledger_list_json));
-  return serialized_list;
+  return id_array;
 }
 
-string UnresolvedBlockPool::serializeUserAttributeList(const UnresolvedBlock &unresolved_block) {
-  nlohmann::json ledger_list_json = nlohmann::json::array();
-  string serialized_list;
-
-  for (auto &each_user : unresolved_block.user_attribute_list) {
-    nlohmann::json json;
-    json["uid"] = each_user.second.uid;
-    json["register_day"] = to_string(each_user.second.register_day);
-    json["register_code"] = each_user.second.register_code;
-    json["gender"] = to_string(each_user.second.gender);
-    json["isc_type"] = each_user.second.isc_type;
-    json["isc_code"] = each_user.second.isc_code;
-    json["location"] = each_user.second.location;
-    json["age_limit"] = to_string(each_user.second.age_limit);
-    json["sigma"] = each_user.second.sigma;
-
-    ledger_list_json.push_back(json);
-  }
+nlohmann::json UnresolvedBlockPool::getOrphanStats() {
+  std::lock_guard<std::recursive_mutex> guard(m_push_mutex);
 
-  serialized_list = TypeConverter::bytesToString(nlohmann::json::to_cbor(ledger_list_json));
-  return serialized_list;
+  nlohmann::json stats;
+  stats["size"] = m_orphan_blocks.size();
+  stats["tx_num"] = m_orphan_tx_num;
+  stats["linked"] = m_orphan_linked_num;
+  stats["evicted"] = m_orphan_evicted_num;
+  stats["expired"] = m_orphan_expired_num;
+  stats["avg_time_to_link_ms"] = (m_orphan_linked_num == 0) ? 0.0 : m_orphan_link_ms_sum / (double)m_orphan_linked_num;
+  stats["max_time_to_link_ms"] = m_orphan_link_ms_max;
+  return stats;
 }
 
-string UnresolvedBlockPool::serializeUserCertList(const UnresolvedBlock &unresolved_block) {
-  nlohmann::json ledger_list_json = nlohmann::json::array();
-  string serialized_list;
-
-  for (auto &each_cert : unresolved_block.user_cert_list) {
-    nlohmann::json json;
-    json["uid"] = each_cert.second.uid;
-    json["sn"] = each_cert.second.sn;
-    json["nvbefore"] = to_string(each_cert.second.nvbefore);
-    json["nvafter"] = to_string(each_cert.second.nvafter);
-    json["x509"] = each_cert.second.x509;
+string UnresolvedBlockPool::serializeBackupResult(const UnresolvedBlock &unresolved_block) {
+  string serialized_result;
+  appendUint(serialized_result, BACKUP_FORMAT_VERSION, 1);
+  appendString(serialized_result, unresolved_block.block.getBlockId());
+  appendUint(serialized_result, unresolved_block.block.getHeight(), 8);
 
-    ledger_list_json.push_back(json);
-  }
+  appendLedgerMap(serialized_result, unresolved_block.user_ledger_list);
+  appendLedgerMap(serialized_result, unresolved_block.contract_ledger_list);
+  appendLedgerMap(serialized_result, unresolved_block.user_attribute_list);
+  appendLedgerMap(serialized_result, unresolved_block.user_cert_list);
+  appendLedgerMap(serialized_result, unresolved_block.contract_list);
 
-  serialized_list = TypeConverter::bytesToString(nlohmann::json::to_cbor(ledger_list_json));
-  return serialized_list;
+  return serialized_result;
 }
 
-string UnresolvedBlockPool::serializeContractList(const UnresolvedBlock &unresolved_block) {
-  nlohmann::json ledger_list_json = nlohmann::json::array();
-  string serialized_list;
+bool UnresolvedBlockPool::deserializeBackupResult(std::string_view serialized_result, UnresolvedBlock &unresolved_block) {
+  BinaryReader reader(serialized_result);
 
-  for (auto &each_contract : unresolved_block.contract_list) {
-    nlohmann::json json;
-    json["cid"] = each_contract.second.cid;
-    json["after"] = to_string(each_contract.second.after);
-    json["before"] = to_string(each_contract.second.before);
-    json["author"] = each_contract.second.author;
-    json["friends"] = each_contract.second.friends;
-    json["contract"] = each_contract.second.contract;
-    json["desc"] = each_contract.second.desc;
-    json["sigma"] = each_contract.second.sigma;
+  uint64_t format_version, height;
+  std::string_view block_id;
+  if (!reader.readUint(format_version, 1) || format_version != BACKUP_FORMAT_VERSION || !reader.readStringView(block_id) ||
+      !reader.readUint(height, 8))
+    return false;
 
-    ledger_list_json.push_back(json);
-  }
+  // 다른 블록의 record를 잘못 읽는 일이 없도록 block id와 height를 확인한다
+  if (block_id != unresolved_block.block.getBlockId() || height != unresolved_block.block.getHeight())
+    return false;
 
-  serialized_list = TypeConverter::bytesToString(nlohmann::json::to_cbor(ledger_list_json));
-  return serialized_list;
+  return readLedgerMap(reader, unresolved_block.user_ledger_list) && readLedgerMap(reader, unresolved_block.contract_ledger_list) &&
+         readLedgerMap(reader, unresolved_block.user_attribute_list) && readLedgerMap(reader, unresolved_block.user_cert_list) &&
+         readLedgerMap(reader, unresolved_block.contract_list) && reader.atEnd();
 }
 
 } // namespace tethys
@@ -0,0 +1,98 @@
+#include "include/worker_pool.hpp"
+
+namespace tethys {
+
+WorkerPool::WorkerPool(size_t thread_num) {
+  for (size_t i = 0; i < thread_num; ++i) {
+    m_workers.emplace_back([this]() { run(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> guard(m_batch_mutex);
+    m_stopping = true;
+  }
+  m_batch_cv.notify_all();
+
+  for (auto &each_worker : m_workers) {
+    each_worker.join();
+  }
+}
+
+size_t WorkerPool::getThreadNum() const {
+  return m_workers.size();
+}
+
+void WorkerPool::parallelFor(size_t task_num, const std::function<void(size_t)> &task) {
+  if (task_num == 0)
+    return;
+
+  if (task_num == 1 || m_workers.empty()) {
+    for (size_t i = 0; i < task_num; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->task = &task;
+  batch->task_num = task_num;
+
+  {
+    std::lock_guard<std::mutex> guard(m_batch_mutex);
+    m_batches.push_back(batch);
+  }
+  m_batch_cv.notify_all();
+
+  // 호출한 thread도 같이 실행
+  while (runOneTask(*batch)) {
+  }
+
+  // 다른 thread가 가져간 작업이 끝날 때까지 대기
+  std::unique_lock<std::mutex> lock(batch->done_mutex);
+  batch->done_cv.wait(lock, [&batch]() { return batch->done_num.load() == batch->task_num; });
+}
+
+void WorkerPool::run() {
+  while (true) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(m_batch_mutex);
+      m_batch_cv.wait(lock, [this]() { return !m_batches.empty() || m_stopping; });
+
+      if (m_batches.empty())
+        return; // stopping
+
+      batch = m_batches.front();
+    }
+
+    while (runOneTask(*batch)) {
+    }
+  }
+}
+
+// batch에서 작업 하나를 가져와 실행한다. 남은 작업이 없으면 batch를 queue에서 빼고 false
+bool WorkerPool::runOneTask(Batch &batch) {
+  size_t task_idx = batch.next_idx.fetch_add(1);
+  if (task_idx >= batch.task_num) {
+    std::lock_guard<std::mutex> guard(m_batch_mutex);
+    for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+      if (it->get() == &batch) {
+        m_batches.erase(it);
+        break;
+      }
+    }
+    return false;
+  }
+
+  (*batch.task)(task_idx);
+
+  if (batch.done_num.fetch_add(1) + 1 == batch.task_num) {
+    std::lock_guard<std::mutex> guard(batch.done_mutex);
+    batch.done_cv.notify_all();
+  }
+  return true;
+}
+
+} // namespace tethys